@@ -93,6 +93,7 @@ public:
 	void SortDesc(asUINT startAt, asUINT count);
 	void Sort(asUINT startAt, asUINT count, bool asc);
 	void Sort(asIScriptFunction *less, asUINT startAt, asUINT count);
+	void SortByKey(void *keys, int keysTypeId, bool asc);
 	void Reverse();
 	int  Find(void *value) const;
 	int  Find(asUINT startAt, void *value) const;
@@ -142,6 +143,12 @@ protected:
 
 void RegisterScriptArray(asIScriptEngine *engine, bool defaultArray);
 
+// Lets the application run the chunks of large primitive sorts on its own thread pool instead of
+// threads spawned for every sort. The callback must call job(param, i) once for each i below count
+// and only return once all of those calls have. Without one, threads are spawned as needed.
+typedef void (*asARRAYPARALLELRUN)(asUINT count, void (*job)(void *param, asUINT index), void *param);
+void SetArrayParallelRun(asARRAYPARALLELRUN run);
+
 END_AS_NAMESPACE
 
 #endif
@@ -5,6 +5,9 @@
 #include <stdio.h> // sprintf
 #include <string>
 #include <algorithm> // std::sort
+#include <stdint.h>
+#include <thread>
+#include <vector>
 
 #include "scriptarray.h"
 
@@ -357,6 +360,7 @@ static void RegisterScriptArray_Native(asIScriptEngine *engine)
 	// Sort with callback for comparison
 	r = engine->RegisterFuncdef("bool array<T>::less(const T&in if_handle_then_const a, const T&in if_handle_then_const b)"); assert( r >= 0 );
 	r = engine->RegisterObjectMethod("array<T>", "void sort(const less &in, uint startAt = 0, uint count = uint(-1))", asMETHODPR(CScriptArray, Sort, (asIScriptFunction*, asUINT, asUINT), void), asCALL_THISCALL); assert(r >= 0);
+	r = engine->RegisterObjectMethod("array<T>", "void sort_by_key(const ?&in keys, bool ascending = true)", asMETHOD(CScriptArray, SortByKey), asCALL_THISCALL); assert(r >= 0);
 
 #if AS_USE_STLNAMES != 1 && AS_USE_ACCESSORS == 1
 	// Register virtual properties
@@ -1457,6 +1461,245 @@ void *CScriptArray::GetDataPointer(void *buf)
 }
 
 
+// internal
+// Specialized sort kernels for arrays of primitives. Every primitive value is first mapped onto an
+// unsigned integer key with the same ordering (sign bit flipped for signed integers, the usual
+// IEEE trick for floats), which gives floats a total order so NaNs can't upset the sort, and lets
+// large ranges be sorted with an LSD radix sort instead of a comparison sort.
+static const asUINT RADIX_SORT_THRESHOLD = 256;
+static const asUINT PARALLEL_SORT_THRESHOLD = 1 << 17;
+static const asUINT PARALLEL_SORT_MIN_CHUNK = 1 << 15;
+
+template<typename T, typename K, bool isSigned> struct SIntSortTraits
+{
+	typedef K KeyType;
+	static K Flip() { return isSigned ? K(K(1) << (sizeof(K) * 8 - 1)) : K(0); }
+	static K ToKey(T v) { return K(K(v) ^ Flip()); }
+	static T FromKey(K k) { return T(K(k ^ Flip())); }
+};
+template<typename T> struct SSortTraits;
+template<> struct SSortTraits<asINT8>  : SIntSortTraits<asINT8,  uint8_t,  true> {};
+template<> struct SSortTraits<asINT16> : SIntSortTraits<asINT16, uint16_t, true> {};
+template<> struct SSortTraits<asINT32> : SIntSortTraits<asINT32, uint32_t, true> {};
+template<> struct SSortTraits<asINT64> : SIntSortTraits<asINT64, uint64_t, true> {};
+template<> struct SSortTraits<asBYTE>  : SIntSortTraits<asBYTE,  uint8_t,  false> {};
+template<> struct SSortTraits<asWORD>  : SIntSortTraits<asWORD,  uint16_t, false> {};
+template<> struct SSortTraits<asDWORD> : SIntSortTraits<asDWORD, uint32_t, false> {};
+template<> struct SSortTraits<asQWORD> : SIntSortTraits<asQWORD, uint64_t, false> {};
+template<> struct SSortTraits<bool>
+{
+	typedef uint8_t KeyType;
+	static KeyType ToKey(bool v) { return v ? 1 : 0; }
+	static bool FromKey(KeyType k) { return k != 0; }
+};
+template<typename T, typename K> struct SFloatSortTraits
+{
+	typedef K KeyType;
+	static K SignBit() { return K(K(1) << (sizeof(K) * 8 - 1)); }
+	static K ToKey(T v)
+	{
+		K bits;
+		memcpy(&bits, &v, sizeof(K));
+		return (bits & SignBit()) ? K(~bits) : K(bits | SignBit());
+	}
+	static T FromKey(K k)
+	{
+		K bits = (k & SignBit()) ? K(k ^ SignBit()) : K(~k);
+		T v;
+		memcpy(&v, &bits, sizeof(K));
+		return v;
+	}
+};
+template<> struct SSortTraits<float>  : SFloatSortTraits<float, uint32_t> {};
+template<> struct SSortTraits<double> : SFloatSortTraits<double, uint64_t> {};
+
+// A key paired with the index it came from, used when the array being reordered isn't the one holding the keys
+template<typename K> struct SSortKeyIndex
+{
+	K      key;
+	asUINT index;
+};
+template<typename K> inline K SortKeyOf(K k) { return k; }
+template<typename K> inline K SortKeyOf(const SSortKeyIndex<K> &k) { return k.key; }
+
+struct SSortKeyLess
+{
+	template<typename Item> bool operator()(const Item &a, const Item &b) const { return SortKeyOf(a) < SortKeyOf(b); }
+};
+
+// Stable LSD radix sort, one byte per pass. Passes where every key shares the same byte are skipped,
+// so for example small integers stored in a 64 bit array only cost a pass or two.
+template<typename Item> static void RadixSortItems(Item *items, Item *scratch, asUINT n)
+{
+	typedef decltype(SortKeyOf(*items)) K;
+	const int passes = sizeof(K);
+	std::vector<asUINT> counts(passes * 256, 0);
+	for( asUINT i = 0; i < n; i++ )
+	{
+		K k = SortKeyOf(items[i]);
+		for( int p = 0; p < passes; p++ )
+			counts[p * 256 + asUINT((k >> (p * 8)) & 0xFF)]++;
+	}
+
+	Item *src = items, *dst = scratch;
+	for( int p = 0; p < passes; p++ )
+	{
+		asUINT *offsets = &counts[p * 256];
+		if( offsets[asUINT((SortKeyOf(src[0]) >> (p * 8)) & 0xFF)] == n )
+			continue;
+		asUINT offset = 0;
+		for( int b = 0; b < 256; b++ )
+		{
+			asUINT c = offsets[b];
+			offsets[b] = offset;
+			offset += c;
+		}
+		for( asUINT i = 0; i < n; i++ )
+			dst[offsets[asUINT((SortKeyOf(src[i]) >> (p * 8)) & 0xFF)]++] = src[i];
+		std::swap(src, dst);
+	}
+	if( src != items )
+		std::copy(src, src + n, items);
+}
+
+static asARRAYPARALLELRUN g_parallelRun = 0;
+
+void SetArrayParallelRun(asARRAYPARALLELRUN run)
+{
+	g_parallelRun = run;
+}
+
+template<typename F> static void CallSortJob(void *job, asUINT index)
+{
+	(*static_cast<F*>(job))(index);
+}
+
+// Runs job(0) .. job(count - 1) through the application's thread pool if it provided one, otherwise
+// each on its own thread except the first which runs on the caller
+template<typename F> static void RunSortJobs(asUINT count, F job)
+{
+	if( g_parallelRun )
+	{
+		g_parallelRun(count, CallSortJob<F>, &job);
+		return;
+	}
+	std::vector<std::thread> workers;
+	for( asUINT i = 1; i < count; i++ )
+	{
+		try
+		{
+			workers.emplace_back(job, i);
+		}
+		catch( ... )
+		{
+			job(i);
+		}
+	}
+	job(0);
+	for( size_t i = 0; i < workers.size(); i++ )
+		workers[i].join();
+}
+
+// Sorts evenly sized chunks on separate threads, then merges neighbouring chunks in parallel until one sorted run remains
+template<typename Item> static void ParallelSortItems(Item *items, Item *scratch, asUINT n)
+{
+	asUINT chunks = std::thread::hardware_concurrency();
+	if( chunks > 16 ) chunks = 16;
+	if( chunks > n / PARALLEL_SORT_MIN_CHUNK ) chunks = n / PARALLEL_SORT_MIN_CHUNK;
+	if( chunks < 2 )
+	{
+		RadixSortItems(items, scratch, n);
+		return;
+	}
+
+	std::vector<asUINT> bounds(chunks + 1);
+	for( asUINT i = 0; i <= chunks; i++ )
+		bounds[i] = asUINT(asQWORD(n) * i / chunks);
+	RunSortJobs(chunks, [&](asUINT c) { RadixSortItems(items + bounds[c], scratch + bounds[c], bounds[c + 1] - bounds[c]); });
+
+	Item *src = items, *dst = scratch;
+	for( asUINT width = 1; width < chunks; width *= 2 )
+	{
+		asUINT merges = (chunks + width * 2 - 1) / (width * 2);
+		RunSortJobs(merges, [&](asUINT m)
+		{
+			asUINT first = m * width * 2;
+			asUINT lo = bounds[first];
+			asUINT mid = bounds[std::min(first + width, chunks)];
+			asUINT hi = bounds[std::min(first + width * 2, chunks)];
+			std::merge(src + lo, src + mid, src + mid, src + hi, dst + lo, SSortKeyLess());
+		});
+		std::swap(src, dst);
+	}
+	if( src != items )
+		std::copy(src, src + n, items);
+}
+
+template<typename Item> static void SortItems(Item *items, asUINT n)
+{
+	if( n < RADIX_SORT_THRESHOLD )
+	{
+		std::stable_sort(items, items + n, SSortKeyLess());
+		return;
+	}
+	std::vector<Item> scratch(n);
+	if( n >= PARALLEL_SORT_THRESHOLD )
+		ParallelSortItems(items, &scratch[0], n);
+	else
+		RadixSortItems(items, &scratch[0], n);
+}
+
+template<typename T> static void SortPrimitives(void *buf, asUINT n, bool asc)
+{
+	typedef SSortTraits<T> Traits;
+	typedef typename Traits::KeyType K;
+	T *data = reinterpret_cast<T*>(buf);
+	// Descending order is an ascending sort of the inverted keys, which keeps equal values in their original order
+	const K invert = asc ? K(0) : K(~K(0));
+	std::vector<K> keys(n);
+	for( asUINT i = 0; i < n; i++ )
+		keys[i] = K(Traits::ToKey(data[i]) ^ invert);
+	SortItems(&keys[0], n);
+	for( asUINT i = 0; i < n; i++ )
+		data[i] = Traits::FromKey(K(keys[i] ^ invert));
+}
+
+template<typename T> static void SortIndicesByKey(const void *buf, asUINT n, bool asc, std::vector<asUINT> &order)
+{
+	typedef SSortTraits<T> Traits;
+	typedef typename Traits::KeyType K;
+	const T *data = reinterpret_cast<const T*>(buf);
+	const K invert = asc ? K(0) : K(~K(0));
+	std::vector< SSortKeyIndex<K> > items(n);
+	for( asUINT i = 0; i < n; i++ )
+	{
+		items[i].key = K(Traits::ToKey(data[i]) ^ invert);
+		items[i].index = i;
+	}
+	SortItems(&items[0], n);
+	order.resize(n);
+	for( asUINT i = 0; i < n; i++ )
+		order[i] = items[i].index;
+}
+
+// Calls the given kernel with the C++ type matching a primitive type id, mirroring the types handled by Less()
+#define DISPATCH_PRIMITIVE_SORT(typeId, FUNC, ...) \
+	switch( typeId ) \
+	{ \
+		case asTYPEID_BOOL:   FUNC<bool>(__VA_ARGS__); break; \
+		case asTYPEID_INT8:   FUNC<asINT8>(__VA_ARGS__); break; \
+		case asTYPEID_INT16:  FUNC<asINT16>(__VA_ARGS__); break; \
+		case asTYPEID_INT32:  FUNC<asINT32>(__VA_ARGS__); break; \
+		case asTYPEID_INT64:  FUNC<asINT64>(__VA_ARGS__); break; \
+		case asTYPEID_UINT8:  FUNC<asBYTE>(__VA_ARGS__); break; \
+		case asTYPEID_UINT16: FUNC<asWORD>(__VA_ARGS__); break; \
+		case asTYPEID_UINT32: FUNC<asDWORD>(__VA_ARGS__); break; \
+		case asTYPEID_UINT64: FUNC<asQWORD>(__VA_ARGS__); break; \
+		case asTYPEID_FLOAT:  FUNC<float>(__VA_ARGS__); break; \
+		case asTYPEID_DOUBLE: FUNC<double>(__VA_ARGS__); break; \
+		default:              FUNC<asINT32>(__VA_ARGS__); break; /* All enums fall in this case, see Less() */ \
+	}
+
 // Sort ascending
 void CScriptArray::SortAsc()
 {
@@ -1616,25 +1859,43 @@ void CScriptArray::Sort(asUINT startAt, asUINT count, bool asc)
 	}
 	else
 	{
-		// TODO: Use std::sort for primitive types too
-
-		// Insertion sort
-		asBYTE tmp[16];
-		for( int i = start + 1; i < end; i++ )
-		{
-			Copy(tmp, GetArrayItemPointer(i));
+		DISPATCH_PRIMITIVE_SORT(subTypeId, SortPrimitives, GetArrayItemPointer(start), asUINT(end - start), asc)
+	}
+}
 
-			int j = i - 1;
+// Reorder the elements to match the sorted order of a parallel array of primitive keys, without calling into the script
+void CScriptArray::SortByKey(void *ref, int refTypeId, bool asc)
+{
+	asIScriptContext *ctx = asGetActiveContext();
+	asIScriptEngine *engine = objType->GetEngine();
+	const CScriptArray *keys = 0;
+	asITypeInfo *keysType = engine->GetTypeInfoById(refTypeId);
+	if( keysType && (keysType->GetFlags() & asOBJ_TEMPLATE) && strcmp(keysType->GetName(), objType->GetName()) == 0 )
+		keys = (refTypeId & asTYPEID_OBJHANDLE) ? *reinterpret_cast<CScriptArray**>(ref) : reinterpret_cast<CScriptArray*>(ref);
+	if( !keys || (keys->GetElementTypeId() & ~asTYPEID_MASK_SEQNBR) )
+	{
+		if( ctx )
+			ctx->SetException("sort_by_key expects an array of primitive keys");
+		return;
+	}
+	asUINT n = GetSize();
+	if( keys->GetSize() != n )
+	{
+		if( ctx )
+			ctx->SetException("Key array length does not match the array being sorted");
+		return;
+	}
+	if( n < 2 )
+		return;
 
-			while( j >= start && Less(GetDataPointer(tmp), At(j), asc) )
-			{
-				Copy(GetArrayItemPointer(j + 1), GetArrayItemPointer(j));
-				j--;
-			}
+	std::vector<asUINT> order;
+	DISPATCH_PRIMITIVE_SORT(keys->GetElementTypeId(), SortIndicesByKey, keys->buffer->data, n, asc, order)
 
-			Copy(GetArrayItemPointer(j + 1), tmp);
-		}
-	}
+	// Elements are only moved around, so handles and object pointers keep their references without any bookkeeping
+	std::vector<asBYTE> sorted(asQWORD(n) * elementSize);
+	for( asUINT i = 0; i < n; i++ )
+		memcpy(&sorted[asQWORD(i) * elementSize], GetArrayItemPointer(order[i]), elementSize);
+	memcpy(buffer->data, &sorted[0], sorted.size());
 }
 
 // Sort with script callback for comparing elements
@@ -2226,6 +2487,15 @@ static void ScriptArraySortCallback_Generic(asIScriptGeneric *gen)
 	self->Sort(callback, startAt, count);
 }
 
+static void ScriptArraySortByKey_Generic(asIScriptGeneric *gen)
+{
+	void *ref = gen->GetArgAddress(0);
+	int refTypeId = gen->GetArgTypeId(0);
+	bool asc = gen->GetArgByte(1) != 0;
+	CScriptArray *self = (CScriptArray*)gen->GetObject();
+	self->SortByKey(ref, refTypeId, asc);
+}
+
 static void ScriptArrayAddRef_Generic(asIScriptGeneric *gen)
 {
 	CScriptArray *self = (CScriptArray*)gen->GetObject();
@@ -2316,6 +2586,7 @@ static void RegisterScriptArray_Generic(asIScriptEngine *engine)
 	r = engine->RegisterObjectMethod("array<T>", "bool is_empty() const", asFUNCTION(ScriptArrayIsEmpty_Generic), asCALL_GENERIC); assert( r >= 0 );
 	r = engine->RegisterFuncdef("bool array<T>::less(const T&in if_handle_then_const a, const T&in if_handle_then_const b)"); assert( r >= 0 );
 	r = engine->RegisterObjectMethod("array<T>", "void sort(const less &in, uint startAt = 0, uint count = uint(-1))", asFUNCTION(ScriptArraySortCallback_Generic), asCALL_GENERIC); assert(r >= 0);
+	r = engine->RegisterObjectMethod("array<T>", "void sort_by_key(const ?&in keys, bool ascending = true)", asFUNCTION(ScriptArraySortByKey_Generic), asCALL_GENERIC); assert(r >= 0);
 #if AS_USE_STLNAMES != 1 && AS_USE_ACCESSORS == 1
 	r = engine->RegisterObjectMethod("array<T>", "uint get_length() const property", asFUNCTION(ScriptArrayLength_Generic), asCALL_GENERIC); assert( r >= 0 );
 	r = engine->RegisterObjectMethod("array<T>", "void set_length(uint) property", asFUNCTION(ScriptArrayResize_Generic), asCALL_GENERIC); assert( r >= 0 );
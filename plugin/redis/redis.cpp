@@ -13,9 +13,12 @@
 #include "../../src/nvgt_plugin.h"
 #include "redis.h"
 
+#include <Poco/Condition.h>
 #include <Poco/Event.h>
+#include <Poco/Mutex.h>
 #include <Poco/Net/NetException.h>
 #include <Poco/Net/SocketAddress.h>
+#include <Poco/Net/StreamSocket.h>
 #include <Poco/NumberFormatter.h>
 #include <Poco/Redis/Array.h>
 #include <Poco/Redis/AsyncReader.h>
@@ -24,11 +27,14 @@
 #include <Poco/Redis/Error.h>
 #include <Poco/Redis/Exception.h>
 #include <Poco/Redis/Type.h>
+#include <Poco/Runnable.h>
 #include <Poco/Thread.h>
 #include <Poco/Timespan.h>
+#include <Poco/Timestamp.h>
 #include <scriptarray.h>
 #include <scriptdictionary.h>
 
+#include <deque>
 #include <memory>
 #include <sstream>
 #include <unordered_map>
@@ -133,6 +139,452 @@ public:
 	}
 };
 
+// A second connection used by redis_client's async API. Commands are written from the script thread as soon as they are sent, while a background thread reads the replies in order and queues them for polling.
+class redis_async_channel : public Runnable {
+private:
+	Client m_client;
+	Net::StreamSocket m_socket; // Shares its socket with m_client, so that close() can shut it down to wake a reader that is blocked waiting for a reply.
+	Thread m_thread;
+	Mutex m_mutex;
+	Condition m_sent;
+	Condition m_received;
+	std::deque<UInt64> m_pending;
+	std::deque<std::pair<UInt64, RedisType::Ptr>> m_ready;
+	UInt64 m_next_id;
+	bool m_reading;
+	bool m_stopping;
+
+	// Must be called with m_mutex held. Replies that will never arrive are delivered as errors so that nobody waits on them forever.
+	void fail_pending(const std::string& message) {
+		for (UInt64 id : m_pending)
+			m_ready.emplace_back(id, new Type<Redis::Error>(Redis::Error(message)));
+		m_pending.clear();
+		m_reading = false;
+		m_received.broadcast();
+	}
+
+public:
+	redis_async_channel() : m_next_id(1), m_reading(false), m_stopping(false) {}
+	~redis_async_channel() { close(); }
+
+	bool is_open() {
+		Mutex::ScopedLock lock(m_mutex);
+		return m_reading;
+	}
+
+	void open(const std::string& host, int port, const std::string& password, int database, int timeout_ms) {
+		close();
+		m_socket = Net::StreamSocket();
+		m_socket.connect(Net::SocketAddress(host, port), Timespan(Timespan::TimeDiff(timeout_ms) * 1000));
+		m_client.connect(m_socket);
+		if (!password.empty()) {
+			Array cmd;
+			cmd.add("AUTH").add(password);
+			m_client.execute<std::string>(cmd);
+		}
+		if (database != 0) {
+			Array cmd;
+			cmd.add("SELECT").add(NumberFormatter::format(database));
+			m_client.execute<std::string>(cmd);
+		}
+		// No receive timeout, since one firing in the middle of a large reply or a blocking command such as BLPOP would leave the parser out of step with the stream. The reader only reads while a reply is outstanding, and close() wakes it by shutting the socket down.
+		m_reading = true;
+		m_thread.start(*this);
+	}
+
+	void close() {
+		{
+			Mutex::ScopedLock lock(m_mutex);
+			m_stopping = true;
+			m_sent.signal();
+		}
+		if (m_thread.isRunning()) {
+			try {
+				m_socket.shutdown();
+			} catch (...) {
+			}
+			m_thread.join();
+		}
+		try {
+			if (m_client.isConnected())
+				m_client.disconnect();
+		} catch (...) {
+		}
+		Mutex::ScopedLock lock(m_mutex);
+		fail_pending("Async connection closed");
+		m_stopping = false;
+	}
+
+	UInt64 send(const Array& cmd) {
+		Mutex::ScopedLock lock(m_mutex);
+		if (!m_reading)
+			throw IOException("Async connection lost");
+		try {
+			m_client.execute<void>(cmd);
+			m_client.flush();
+		} catch (...) {
+			m_reading = false; // The reader drains whatever is already outstanding, then exits.
+			m_sent.signal();
+			throw;
+		}
+		UInt64 id = m_next_id++;
+		m_pending.push_back(id);
+		m_sent.signal();
+		return id;
+	}
+
+	bool poll(UInt64& id, RedisType::Ptr& reply) {
+		Mutex::ScopedLock lock(m_mutex);
+		if (m_ready.empty())
+			return false;
+		id = m_ready.front().first;
+		reply = m_ready.front().second;
+		m_ready.pop_front();
+		return true;
+	}
+
+	bool wait(int timeout_ms) {
+		Timestamp start;
+		Mutex::ScopedLock lock(m_mutex);
+		while (m_ready.empty() && !m_pending.empty()) {
+			if (timeout_ms < 0) {
+				m_received.wait(m_mutex);
+				continue;
+			}
+			long remaining = timeout_ms - long(start.elapsed() / 1000);
+			if (remaining <= 0 || !m_received.tryWait(m_mutex, remaining))
+				break;
+		}
+		return !m_ready.empty();
+	}
+
+	unsigned int pending_count() {
+		Mutex::ScopedLock lock(m_mutex);
+		return m_pending.size();
+	}
+
+	unsigned int ready_count() {
+		Mutex::ScopedLock lock(m_mutex);
+		return m_ready.size();
+	}
+
+	void run() {
+		while (true) {
+			{
+				Mutex::ScopedLock lock(m_mutex);
+				while (m_pending.empty() && m_reading && !m_stopping)
+					m_sent.wait(m_mutex);
+				if (m_pending.empty()) {
+					m_reading = false;
+					return;
+				}
+			}
+			RedisType::Ptr reply;
+			try {
+				reply = m_client.readReply();
+			} catch (const Exception& e) {
+				Mutex::ScopedLock lock(m_mutex);
+				fail_pending(m_stopping ? "Async connection closed" : e.displayText());
+				return;
+			} catch (...) {
+				Mutex::ScopedLock lock(m_mutex);
+				fail_pending(m_stopping ? "Async connection closed" : "Unknown error");
+				return;
+			}
+			Mutex::ScopedLock lock(m_mutex);
+			m_ready.emplace_back(m_pending.front(), reply);
+			m_pending.pop_front();
+			m_received.broadcast();
+		}
+	}
+};
+
+// State shared between a redis_pool and every client it has handed out, so that a client can still be returned safely after script has dropped the pool itself.
+struct redis_pool_core {
+	struct idle_connection {
+		SharedPtr<Client> client;
+		Timestamp since;
+	};
+	Mutex mutex;
+	Condition available;
+	std::deque<idle_connection> idle;
+	std::string host;
+	int port;
+	std::string password;
+	int database;
+	int timeout_ms;
+	unsigned int min_size;
+	unsigned int max_size;
+	int health_check_interval_ms;
+	int idle_timeout_ms;
+	unsigned int open_count;  // Idle plus borrowed connections, including ones still being connected.
+	unsigned int borrowed;
+	bool closed;
+	UInt64 borrows;
+	UInt64 waits;
+	UInt64 timeouts;
+	UInt64 connects;
+	UInt64 connect_failures;
+	UInt64 health_check_failures;
+	std::string last_error;
+	Timestamp::TimeDiff total_wait_us;
+	Timestamp::TimeDiff max_wait_us;
+
+	redis_pool_core(const std::string& host, int port, unsigned int min_size, unsigned int max_size) : host(host), port(port), database(0), timeout_ms(5000), min_size(min_size), max_size(max_size < 1 ? 1 : max_size), health_check_interval_ms(30000), idle_timeout_ms(60000), open_count(0), borrowed(0), closed(false), borrows(0), waits(0), timeouts(0), connects(0), connect_failures(0), health_check_failures(0), total_wait_us(0), max_wait_us(0) {}
+
+	// Opens and authenticates a new connection using a snapshot of the configuration. Called without the mutex held.
+	SharedPtr<Client> connect_client() {
+		std::string h, pwd;
+		int p, db, timeout;
+		{
+			Mutex::ScopedLock lock(mutex);
+			h = host;
+			p = port;
+			pwd = password;
+			db = database;
+			timeout = timeout_ms;
+		}
+		SharedPtr<Client> client = new Client();
+		client->connect(h, p, Timespan(Timespan::TimeDiff(timeout) * 1000));
+		if (!pwd.empty()) {
+			Array cmd;
+			cmd.add("AUTH").add(pwd);
+			client->execute<std::string>(cmd);
+		}
+		if (db != 0) {
+			Array cmd;
+			cmd.add("SELECT").add(NumberFormatter::format(db));
+			client->execute<std::string>(cmd);
+		}
+		return client;
+	}
+
+	static bool ping(Client& client) {
+		try {
+			Array cmd;
+			cmd.add("PING");
+			return client.execute<std::string>(cmd) == "PONG";
+		} catch (...) {
+			return false;
+		}
+	}
+
+	// Opens connections until at least min_size exist, returning how many were opened.
+	unsigned int warm_up() {
+		unsigned int opened = 0;
+		while (true) {
+			{
+				Mutex::ScopedLock lock(mutex);
+				if (closed || open_count >= min_size)
+					break;
+				open_count++;
+			}
+			SharedPtr<Client> client;
+			std::string error;
+			try {
+				client = connect_client();
+			} catch (const RedisException& e) {
+				error = e.message();
+			} catch (const Exception& e) {
+				error = e.displayText();
+			} catch (...) {
+				error = "Failed to connect";
+			}
+			Mutex::ScopedLock lock(mutex);
+			if (client.isNull()) {
+				open_count--;
+				connect_failures++;
+				last_error = error;
+				break;
+			}
+			connects++;
+			idle.push_back({client, Timestamp()});
+			available.signal();
+			opened++;
+		}
+		return opened;
+	}
+
+	void close() {
+		Mutex::ScopedLock lock(mutex);
+		closed = true;
+		for (auto& conn : idle) {
+			try {
+				conn.client->disconnect();
+			} catch (...) {
+			}
+		}
+		open_count -= idle.size();
+		idle.clear();
+		available.broadcast();
+	}
+
+	// Must be called with the mutex held. Closes connections that have sat idle for too long while more than min_size are open.
+	void trim_idle() {
+		if (idle_timeout_ms <= 0)
+			return;
+		while (!idle.empty() && open_count > min_size && idle.front().since.isElapsed(Timestamp::TimeDiff(idle_timeout_ms) * 1000)) {
+			try {
+				idle.front().client->disconnect();
+			} catch (...) {
+			}
+			idle.pop_front();
+			open_count--;
+		}
+	}
+
+	// Returns a connected client, or a null pointer with error set if none could be had within timeout_ms.
+	SharedPtr<Client> borrow(int timeout_ms, std::string& error) {
+		Timestamp start;
+		bool waited = false;
+		Mutex::ScopedLock lock(mutex);
+		while (true) {
+			if (closed) {
+				error = "Pool is closed";
+				return nullptr;
+			}
+			if (!idle.empty()) {
+				// Most recently returned first, so that surplus connections age out at the front of the queue.
+				idle_connection conn = idle.back();
+				idle.pop_back();
+				borrowed++;
+				bool healthy = conn.client->isConnected();
+				if (healthy && health_check_interval_ms >= 0 && conn.since.isElapsed(Timestamp::TimeDiff(health_check_interval_ms) * 1000)) {
+					mutex.unlock();
+					healthy = ping(*conn.client);
+					mutex.lock();
+					if (!healthy)
+						health_check_failures++;
+				}
+				if (healthy) {
+					record_wait(start, waited);
+					return conn.client;
+				}
+				// The idle connection went bad, so drop it and go around again to reuse another or open a fresh one in its place.
+				borrowed--;
+				open_count--;
+				try {
+					conn.client->disconnect();
+				} catch (...) {
+				}
+				continue;
+			}
+			if (open_count < max_size) {
+				open_count++;
+				borrowed++;
+				mutex.unlock();
+				SharedPtr<Client> client;
+				try {
+					client = connect_client();
+				} catch (const RedisException& e) {
+					error = e.message();
+				} catch (const Exception& e) {
+					error = e.displayText();
+				} catch (...) {
+					error = "Failed to connect";
+				}
+				mutex.lock();
+				if (!client.isNull()) {
+					connects++;
+					record_wait(start, waited);
+					return client;
+				}
+				connect_failures++;
+				open_count--;
+				borrowed--;
+				available.signal();
+				return nullptr;
+			}
+			long remaining = 0;
+			if (timeout_ms >= 0) {
+				remaining = timeout_ms - long(start.elapsed() / 1000);
+				if (remaining <= 0) {
+					timeouts++;
+					error = "Timed out waiting for a free connection";
+					return nullptr;
+				}
+			}
+			waited = true;
+			if (timeout_ms < 0)
+				available.wait(mutex);
+			else
+				available.tryWait(mutex, remaining);
+		}
+	}
+
+	// Must be called with the mutex held.
+	void record_wait(const Timestamp& start, bool waited) {
+		Timestamp::TimeDiff elapsed = start.elapsed();
+		borrows++;
+		if (waited)
+			waits++;
+		total_wait_us += elapsed;
+		if (elapsed > max_wait_us)
+			max_wait_us = elapsed;
+	}
+
+	static bool reply_is(const RedisType::Ptr& reply, const std::string& expected) {
+		if (reply.isNull())
+			return false;
+		if (reply->isSimpleString()) {
+			const Type<std::string>* str = dynamic_cast<const Type<std::string>*>(reply.get());
+			return str && str->value() == expected;
+		} else if (reply->isBulkString()) {
+			const Type<BulkString>* bs = dynamic_cast<const Type<BulkString>*>(reply.get());
+			return bs && !bs->value().isNull() && bs->value().value() == expected;
+		}
+		return false;
+	}
+
+	// Puts a connection that script may have left inside a transaction, watching keys or on another database back into the state connect_client() leaves it in, using one round trip. The trailing ECHO catches replies left over from an earlier timeout, which would otherwise shift every reply that follows. Returns false if the connection can't be trusted anymore. Called without the mutex held.
+	bool reset_session(Client& client) {
+		int db;
+		{
+			Mutex::ScopedLock lock(mutex);
+			db = database;
+		}
+		try {
+			Array discard, unwatch, select, echo;
+			discard.add("DISCARD");
+			unwatch.add("UNWATCH");
+			select.add("SELECT").add(NumberFormatter::format(db));
+			echo.add("ECHO").add("nvgt-pool-reset");
+			client.execute<void>(discard);
+			client.execute<void>(unwatch);
+			client.execute<void>(select);
+			client.execute<void>(echo);
+			client.flush();
+			client.readReply(); // Either OK or an error when no transaction was open, which is fine either way.
+			if (!reply_is(client.readReply(), "OK") || !reply_is(client.readReply(), "OK"))
+				return false;
+			return reply_is(client.readReply(), "nvgt-pool-reset");
+		} catch (...) {
+			return false;
+		}
+	}
+
+	// dirty is set when script ran something through the client that may have changed per connection state, see redis_client::m_session_dirty.
+	void give_back(const SharedPtr<Client>& client, bool dirty) {
+		bool reusable = client->isConnected() && client.referenceCount() == 1;
+		if (reusable && dirty)
+			reusable = reset_session(*client);
+		Mutex::ScopedLock lock(mutex);
+		borrowed--;
+		if (closed || !reusable || !client->isConnected() || client.referenceCount() > 1) {
+			// Dead, left in a state that couldn't be reset, or still referenced by a copy of the wrapper that handed it back, so it can't be shared again.
+			open_count--;
+			try {
+				if (client.referenceCount() == 1 && client->isConnected())
+					client->disconnect();
+			} catch (...) {
+			}
+		} else
+			idle.push_back({client, Timestamp()});
+		trim_idle();
+		available.signal();
+	}
+};
+
 // Redis client wrapper
 class redis_client : public plugin_refcounted<Client> {
 private:
@@ -144,6 +596,20 @@ private:
 	int m_timeout_ms;
 	bool m_pipeline_mode = false;
 	std::vector<Array> m_pipeline_commands;
+	std::unique_ptr<redis_async_channel> m_async; // Created by the first send_async call, never shared between copies.
+	SharedPtr<redis_pool_core> m_pool; // Set when this client was borrowed from a redis_pool.
+	bool m_session_dirty = false; // Set by anything that may leave per connection state behind (a selected database, a transaction, watched keys, arbitrary commands or a reply that never got read), so that a pooled connection is reset before being handed out again.
+
+	void return_to_pool() {
+		if (m_pool.isNull())
+			return;
+		SharedPtr<Client> client = shared;
+		shared = nullptr;
+		ptr = nullptr;
+		m_pool->give_back(client, m_session_dirty);
+		m_pool.reset();
+		m_session_dirty = false;
+	}
 
 	// Helper to create Poco Redis Array from parameters
 	template <typename... Args>
@@ -185,9 +651,11 @@ private:
 			return false;
 		} catch (const Exception& e) {
 			m_last_error = e.displayText();
+			m_session_dirty = true;
 			return false;
 		} catch (...) {
 			m_last_error = "Unknown error";
+			m_session_dirty = true;
 			return false;
 		}
 	}
@@ -202,9 +670,11 @@ private:
 			return nullptr;
 		} catch (const Exception& e) {
 			m_last_error = e.displayText();
+			m_session_dirty = true;
 			return nullptr;
 		} catch (...) {
 			m_last_error = "Unknown error";
+			m_session_dirty = true;
 			return nullptr;
 		}
 	}
@@ -216,9 +686,22 @@ public:
 		m_port(other->m_port),
 		m_password(other->m_password),
 		m_database(other->m_database),
-		m_timeout_ms(other->m_timeout_ms) {}
+		m_timeout_ms(other->m_timeout_ms) {
+		other->m_session_dirty = true; // The copy shares the connection and can change its state behind the original's back.
+	}
+	// Wraps a connection borrowed from a pool, which gets it back once script releases its last handle to this client.
+	redis_client(SharedPtr<Client> client, SharedPtr<redis_pool_core> pool) : plugin_refcounted(client),
+		m_host(pool->host),
+		m_port(pool->port),
+		m_password(pool->password),
+		m_database(pool->database),
+		m_timeout_ms(pool->timeout_ms),
+		m_pool(pool) {}
+	~redis_client() { return_to_pool(); }
 
 	redis_client& operator=(redis_client* other) {
+		return_to_pool();
+		other->m_session_dirty = true;
 		shared = other->shared;
 		ptr = shared.get();
 		m_host = other->m_host;
@@ -1400,6 +1883,7 @@ public:
 			return false;
 		}
 		std::string reply;
+		m_session_dirty = true;
 		if (execute_command(make_command("SELECT", index), reply) && reply == "OK") {
 			m_database = index;
 			return true;
@@ -1472,6 +1956,7 @@ public:
 			return false;
 		}
 		std::string reply;
+		m_session_dirty = true;
 		return execute_command(make_command("MULTI"), reply) && reply == "OK";
 	}
 
@@ -1498,6 +1983,7 @@ public:
 			return false;
 		}
 		std::string reply;
+		m_session_dirty = true;
 		return execute_command(make_command("WATCH", key), reply) && reply == "OK";
 	}
 
@@ -1517,6 +2003,7 @@ public:
 			cmd.add(*key);
 		}
 		std::string reply;
+		m_session_dirty = true;
 		return execute_command(cmd, reply) && reply == "OK";
 	}
 
@@ -2302,32 +2789,34 @@ public:
 			m_pipeline_commands.clear();
 			return result;
 		}
+		// Every command of the batch is written into the client's output buffer and sent with a single flush, then the replies are read back in order. Error replies come back as error values in their slots rather than aborting the batch.
+		size_t received = 0;
+		m_session_dirty = true; // The batch may hold any command.
 		try {
-			// Execute each command and collect results
-			// Note: Poco Redis doesn't have true pipelining support, so we simulate it
-			// by executing commands in sequence but collecting all results before returning.
-			// This seems redundant, so we'll probably remove if we can't figure out a meaningful difference between this and transactions
-			for (const auto& cmd : m_pipeline_commands) {
-				try {
-					RedisType::Ptr reply = ptr->sendCommand(cmd);
-					redis_value* val = new redis_value(reply);
-					result->InsertLast(&val);
-					val->release();
-				} catch (const RedisException& e) {
-					RedisType::Ptr errorReply = new Type<Redis::Error>(Redis::Error(e.message()));
-					redis_value* val = new redis_value(errorReply);
-					result->InsertLast(&val);
-					val->release();
-				}
+			for (const auto& cmd : m_pipeline_commands)
+				ptr->execute<void>(cmd);  // Buffers the command without flushing or waiting for a reply.
+			ptr->flush();
+			for (; received < m_pipeline_commands.size(); ++received) {
+				redis_value* val = new redis_value(ptr->readReply());
+				result->InsertLast(&val);
+				val->release();
 			}
-			m_pipeline_mode = false;
-			m_pipeline_commands.clear();
 			m_last_error.clear();
 		} catch (const Exception& e) {
 			m_last_error = e.displayText();
-			m_pipeline_mode = false;
-			m_pipeline_commands.clear();
+			// The connection is out of step with the batch now, so drop it and give the remaining commands an error each.
+			for (; received < m_pipeline_commands.size(); ++received) {
+				redis_value* val = new redis_value(new Type<Redis::Error>(Redis::Error(m_last_error)));
+				result->InsertLast(&val);
+				val->release();
+			}
+			try {
+				ptr->disconnect();
+			} catch (...) {
+			}
 		}
+		m_pipeline_mode = false;
+		m_pipeline_commands.clear();
 		return result;
 	}
 
@@ -2345,8 +2834,212 @@ public:
 			std::string* str = static_cast<std::string*>(args->At(i));
 			cmd.add(*str);
 		}
+		m_session_dirty = true; // Arbitrary commands may change connection state, such as opening a transaction.
 		return execute_command_value(cmd);
 	}
+
+	UInt64 send_async(CScriptArray* args) {
+		if (!args || args->GetSize() == 0) {
+			m_last_error = "Empty command";
+			return 0;
+		}
+		Array cmd;
+		for (uint32_t i = 0; i < args->GetSize(); ++i) {
+			std::string* str = static_cast<std::string*>(args->At(i));
+			cmd.add(*str);
+		}
+		try {
+			if (!m_async)
+				m_async.reset(new redis_async_channel());
+			if (!m_async->is_open())
+				m_async->open(m_host, m_port, m_password, m_database, m_timeout_ms);
+			UInt64 id = m_async->send(cmd);
+			m_last_error.clear();
+			return id;
+		} catch (const RedisException& e) {
+			m_last_error = e.message();
+		} catch (const Exception& e) {
+			m_last_error = e.displayText();
+		} catch (...) {
+			m_last_error = "Unknown error";
+		}
+		return 0;
+	}
+
+	redis_value* poll_async(UInt64& id) {
+		id = 0;
+		RedisType::Ptr reply;
+		if (!m_async || !m_async->poll(id, reply))
+			return nullptr;
+		return new redis_value(reply);
+	}
+
+	bool wait_async(int timeout_ms) {
+		return m_async && m_async->wait(timeout_ms);
+	}
+
+	unsigned int get_async_pending() const { return m_async ? m_async->pending_count() : 0; }
+	unsigned int get_async_ready() const { return m_async ? m_async->ready_count() : 0; }
+
+	void close_async() {
+		if (m_async)
+			m_async->close();
+	}
+};
+
+// A thread safe pool of connections. Any thread may borrow a client, which goes back to the pool as soon as the last handle to it is released.
+class redis_pool : public plugin_refcounted<redis_pool_core> {
+public:
+	redis_pool(const std::string& host, int port, unsigned int min_size, unsigned int max_size) : plugin_refcounted(new redis_pool_core(host, port, min_size, max_size)) {}
+	~redis_pool() { ptr->close(); }
+
+	redis_client* borrow(int timeout_ms) {
+		std::string error;
+		SharedPtr<Client> client = ptr->borrow(timeout_ms, error);
+		Mutex::ScopedLock lock(ptr->mutex);
+		if (client.isNull()) {
+			ptr->last_error = error;
+			return nullptr;
+		}
+		return new redis_client(client, shared);
+	}
+
+	unsigned int warm_up() { return ptr->warm_up(); }
+	void close() { ptr->close(); }
+
+	void reset_stats() {
+		Mutex::ScopedLock lock(ptr->mutex);
+		ptr->borrows = ptr->waits = ptr->timeouts = ptr->connects = ptr->connect_failures = ptr->health_check_failures = 0;
+		ptr->total_wait_us = ptr->max_wait_us = 0;
+	}
+
+	std::string get_host() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->host;
+	}
+	void set_host(const std::string& host) {
+		Mutex::ScopedLock lock(ptr->mutex);
+		ptr->host = host;
+	}
+	int get_port() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->port;
+	}
+	void set_port(int port) {
+		Mutex::ScopedLock lock(ptr->mutex);
+		ptr->port = port;
+	}
+	std::string get_password() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->password;
+	}
+	void set_password(const std::string& pwd) {
+		Mutex::ScopedLock lock(ptr->mutex);
+		ptr->password = pwd;
+	}
+	int get_database() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->database;
+	}
+	void set_database(int db) {
+		Mutex::ScopedLock lock(ptr->mutex);
+		ptr->database = db;
+	}
+	int get_timeout() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->timeout_ms;
+	}
+	void set_timeout(int ms) {
+		Mutex::ScopedLock lock(ptr->mutex);
+		ptr->timeout_ms = ms;
+	}
+	unsigned int get_min_size() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->min_size;
+	}
+	void set_min_size(unsigned int size) {
+		Mutex::ScopedLock lock(ptr->mutex);
+		ptr->min_size = size;
+	}
+	unsigned int get_max_size() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->max_size;
+	}
+	void set_max_size(unsigned int size) {
+		Mutex::ScopedLock lock(ptr->mutex);
+		ptr->max_size = size < 1 ? 1 : size;
+		ptr->available.broadcast();
+	}
+	int get_health_check_interval() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->health_check_interval_ms;
+	}
+	void set_health_check_interval(int ms) {
+		Mutex::ScopedLock lock(ptr->mutex);
+		ptr->health_check_interval_ms = ms;
+	}
+	int get_idle_timeout() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->idle_timeout_ms;
+	}
+	void set_idle_timeout(int ms) {
+		Mutex::ScopedLock lock(ptr->mutex);
+		ptr->idle_timeout_ms = ms;
+	}
+	std::string get_last_error() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->last_error;
+	}
+	bool is_closed() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->closed;
+	}
+
+	unsigned int get_size() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->open_count;
+	}
+	unsigned int get_idle() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->idle.size();
+	}
+	unsigned int get_borrowed() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->borrowed;
+	}
+	UInt64 get_borrows() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->borrows;
+	}
+	UInt64 get_waits() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->waits;
+	}
+	UInt64 get_timeouts() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->timeouts;
+	}
+	UInt64 get_connects() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->connects;
+	}
+	UInt64 get_connect_failures() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->connect_failures;
+	}
+	UInt64 get_health_check_failures() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->health_check_failures;
+	}
+	// Wait times are reported in milliseconds.
+	double get_average_wait() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->borrows ? double(ptr->total_wait_us) / ptr->borrows / 1000.0 : 0.0;
+	}
+	double get_max_wait() const {
+		Mutex::ScopedLock lock(ptr->mutex);
+		return ptr->max_wait_us / 1000.0;
+	}
 };
 
 // Blocking subscriber implementation
@@ -2532,6 +3225,10 @@ redis_client* redis_client_factory() {
 	return new redis_client();
 }
 
+redis_pool* redis_pool_factory(const std::string& host, int port, unsigned int min_size, unsigned int max_size) {
+	return new redis_pool(host, port, min_size, max_size);
+}
+
 blocking_redis_subscriber* blocking_redis_subscriber_factory() {
 	return new blocking_redis_subscriber();
 }
@@ -2728,6 +3425,52 @@ void RegisterRedis(asIScriptEngine* engine) {
 	engine->RegisterObjectMethod("redis_client", "array<redis_value@>@ pipeline_execute()", asMETHOD(redis_client, pipeline_execute), asCALL_THISCALL);
 	// Generic command execution
 	engine->RegisterObjectMethod("redis_client", "redis_value@ execute(array<string>@)", asMETHOD(redis_client, execute), asCALL_THISCALL);
+	// Async commands, sent over a second connection and polled for replies
+	engine->RegisterObjectMethod("redis_client", "uint64 send_async(array<string>@)", asMETHOD(redis_client, send_async), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_client", "redis_value@ poll_async(uint64&out = void)", asMETHOD(redis_client, poll_async), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_client", "bool wait_async(int = -1)", asMETHOD(redis_client, wait_async), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_client", "uint get_async_pending() const property", asMETHOD(redis_client, get_async_pending), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_client", "uint get_async_ready() const property", asMETHOD(redis_client, get_async_ready), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_client", "void close_async()", asMETHOD(redis_client, close_async), asCALL_THISCALL);
+	engine->RegisterObjectType("redis_pool", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("redis_pool", asBEHAVE_FACTORY, "redis_pool@ f(const string&in = \"localhost\", int = 6379, uint = 1, uint = 8)", asFUNCTION(redis_pool_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("redis_pool", asBEHAVE_ADDREF, "void f()", asMETHOD(redis_pool, add_ref), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("redis_pool", asBEHAVE_RELEASE, "void f()", asMETHOD(redis_pool, release), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "redis_client@ borrow(int = -1)", asMETHOD(redis_pool, borrow), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint warm_up()", asMETHOD(redis_pool, warm_up), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "void close()", asMETHOD(redis_pool, close), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "void reset_stats()", asMETHOD(redis_pool, reset_stats), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "string get_host() const property", asMETHOD(redis_pool, get_host), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "void set_host(const string&in) property", asMETHOD(redis_pool, set_host), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "int get_port() const property", asMETHOD(redis_pool, get_port), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "void set_port(int) property", asMETHOD(redis_pool, set_port), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "string get_password() const property", asMETHOD(redis_pool, get_password), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "void set_password(const string&in) property", asMETHOD(redis_pool, set_password), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "int get_database() const property", asMETHOD(redis_pool, get_database), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "void set_database(int) property", asMETHOD(redis_pool, set_database), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "int get_timeout() const property", asMETHOD(redis_pool, get_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "void set_timeout(int) property", asMETHOD(redis_pool, set_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint get_min_size() const property", asMETHOD(redis_pool, get_min_size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "void set_min_size(uint) property", asMETHOD(redis_pool, set_min_size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint get_max_size() const property", asMETHOD(redis_pool, get_max_size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "void set_max_size(uint) property", asMETHOD(redis_pool, set_max_size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "int get_health_check_interval() const property", asMETHOD(redis_pool, get_health_check_interval), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "void set_health_check_interval(int) property", asMETHOD(redis_pool, set_health_check_interval), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "int get_idle_timeout() const property", asMETHOD(redis_pool, get_idle_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "void set_idle_timeout(int) property", asMETHOD(redis_pool, set_idle_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "string get_last_error() const property", asMETHOD(redis_pool, get_last_error), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "bool get_is_closed() const property", asMETHOD(redis_pool, is_closed), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint get_size() const property", asMETHOD(redis_pool, get_size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint get_idle() const property", asMETHOD(redis_pool, get_idle), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint get_borrowed() const property", asMETHOD(redis_pool, get_borrowed), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint64 get_borrows() const property", asMETHOD(redis_pool, get_borrows), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint64 get_waits() const property", asMETHOD(redis_pool, get_waits), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint64 get_timeouts() const property", asMETHOD(redis_pool, get_timeouts), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint64 get_connects() const property", asMETHOD(redis_pool, get_connects), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint64 get_connect_failures() const property", asMETHOD(redis_pool, get_connect_failures), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "uint64 get_health_check_failures() const property", asMETHOD(redis_pool, get_health_check_failures), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "double get_average_wait() const property", asMETHOD(redis_pool, get_average_wait), asCALL_THISCALL);
+	engine->RegisterObjectMethod("redis_pool", "double get_max_wait() const property", asMETHOD(redis_pool, get_max_wait), asCALL_THISCALL);
 	engine->RegisterObjectType("blocking_redis_subscriber", 0, asOBJ_REF);
 	engine->RegisterObjectBehaviour("blocking_redis_subscriber", asBEHAVE_FACTORY, "blocking_redis_subscriber@ f()", asFUNCTION(blocking_redis_subscriber_factory), asCALL_CDECL);
 	engine->RegisterObjectBehaviour("blocking_redis_subscriber", asBEHAVE_ADDREF, "void f()", asMETHOD(blocking_redis_subscriber, add_ref), asCALL_THISCALL);
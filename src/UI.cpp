@@ -37,6 +37,7 @@
 	#include <sys/time.h>
 #endif
 #include <SDL3/SDL.h>
+#include <algorithm>
 #include <obfuscate.h>
 #include <thread.h>
 #include <string>
@@ -283,8 +284,7 @@ bool game_window::clear(unsigned int r, unsigned int g, unsigned int b) {
 }
 void game_window::draw_text(const std::string& text, float x, float y, unsigned int r, unsigned int g, unsigned int b) {
 	if (!_renderer || !_font || text.empty()) return;
-	Poco::AutoPtr<graphic> surf(_font->render_text_blended(text, r, g, b));
-	if (surf && surf->is_valid()) _renderer->render_graphic(surf.get(), x, y);
+	_renderer->draw_text(_font.get(), text, x, y, r, g, b);
 }
 uint64_t game_window::measure_text(const std::string& text) const {
 	if (!_font) return 0;
@@ -294,8 +294,7 @@ uint64_t game_window::measure_text(const std::string& text) const {
 }
 void game_window::draw_text_wrapped(const std::string& text, float x, float y, int wrap_width, unsigned int r, unsigned int g, unsigned int b) {
 	if (!_renderer || !_font || text.empty()) return;
-	Poco::AutoPtr<graphic> surf(_font->render_text_blended_wrapped(text, wrap_width, r, g, b));
-	if (surf && surf->is_valid()) _renderer->render_graphic(surf.get(), x, y);
+	_renderer->draw_text(_font.get(), text, x, y, r, g, b, 255, wrap_width);
 }
 uint64_t game_window::measure_text_wrapped(const std::string& text, int wrap_width) const {
 	if (!_font) return 0;
@@ -470,24 +469,142 @@ void refresh_window() {
 		post_events.clear();
 	}
 }
+// Blocks until deadline, given in SDL_GetTicksNS units, with sub-millisecond precision. The bulk of the time is slept in whole milliseconds with the event queue being pumped, then SDL_DelayPrecise covers all but the last fraction of a millisecond which is spun away. If wake_on_events is set, returns true as soon as an event is waiting in the queue.
+static bool precise_wait_until(Uint64 deadline, bool pump_events, bool wake_on_events) {
+	const Uint64 coarse_margin = 2 * SDL_NS_PER_MS; // Below this the scheduler can't be trusted to wake us on time.
+	const Uint64 spin_margin = 200 * SDL_NS_PER_US;
+	while (true) {
+		Uint64 now = SDL_GetTicksNS();
+		if (now >= deadline) return false;
+		Uint64 remaining = deadline - now;
+		if (remaining > coarse_margin) {
+			Sint32 ms = Sint32((remaining - coarse_margin) / SDL_NS_PER_MS);
+			if (ms < 1) ms = 1;
+			if (pump_events && wake_on_events) {
+				if (SDL_WaitEventTimeout(nullptr, ms)) return true;
+				continue;
+			}
+			SDL_Delay(ms);
+			if (pump_events) SDL_PumpEvents();
+		} else if (remaining > spin_margin) SDL_DelayPrecise(remaining - spin_margin);
+		else {
+			while (SDL_GetTicksNS() < deadline) SDL_CPUPauseInstruction();
+			return false;
+		}
+	}
+}
+// Runs garbage collection in the idle time before deadline the same way wait() always has, in slices of at most 25ms so that the event queue keeps being pumped.
+static bool idle_until(Uint64 deadline, bool wake_on_events) {
+	do {
+		Uint64 now = SDL_GetTicksNS();
+		int MS = now < deadline ? int(std::min<Uint64>((deadline - now) / SDL_NS_PER_MS, 25)) : 0;
+		if (g_GCMode == 2)
+			garbage_collect_action();
+		else if (g_GCMode == 4)
+			garbage_collect_idle(MS);
+		if (precise_wait_until(std::min<Uint64>(deadline, SDL_GetTicksNS() + 25 * SDL_NS_PER_MS), true, wake_on_events)) return true;
+	} while (SDL_GetTicksNS() < deadline);
+	return false;
+}
 void wait(int ms) {
 	anticheat_check();
+	Uint64 deadline = SDL_GetTicksNS() + Uint64(ms > 0 ? ms : 0) * SDL_NS_PER_MS;
+	tts_process_prewarm(ms > 0 ? ms : 0); // Prewarmed speech must be synthesized on the thread that owns the voice, so phrases that fit are handled here in the script's idle time.
 	if (!g_window || g_WindowThreadId != thread_current_thread_id()) {
-		Poco::Thread::sleep(ms);
+		Uint64 now = SDL_GetTicksNS();
+		if (now < deadline) Poco::Thread::sleep(int((deadline - now) / SDL_NS_PER_MS));
 		return;
 	}
-	while (ms >= 0) {
-		int MS = (ms > 25 ? 25 : ms);
-		if (g_GCMode == 2)
-			garbage_collect_action();
-		Poco::Thread::sleep(MS);
-		SDL_PumpEvents();
-		ms -= MS;
-		if (ms < 1) break;
-	}
+	if (g_GCMode == 4)
+		garbage_collect_incremental();
+	idle_until(deadline, false);
 	refresh_window();
 }
 
+// frame_pacer
+static const unsigned int frame_pacer_history = 1000; // Number of recent frame times kept for statistics.
+static const Uint64 frame_pacer_tolerance = SDL_NS_PER_MS / 2; // How late a frame can finish before it counts as a missed deadline.
+frame_pacer::frame_pacer(double target_fps) : _target_fps(0), _wake_on_events(false), _start(SDL_GetTicksNS()), _deadline(0), _last_frame(0), _frame_times_pos(0), _frames(0), _missed_deadlines(0), _refcount(1) {
+	set_target_fps(target_fps);
+	_frame_times.reserve(frame_pacer_history);
+}
+void frame_pacer::set_target_fps(double fps) {
+	_target_fps = fps > 0 ? fps : 0;
+	_deadline = 0;
+}
+double frame_pacer::get_elapsed() const {
+	return (SDL_GetTicksNS() - _start) / double(SDL_NS_PER_MS);
+}
+bool frame_pacer::pace(Uint64 deadline) {
+	anticheat_check();
+	bool window_thread = g_window && g_WindowThreadId == thread_current_thread_id();
+	if (window_thread) {
+		if (idle_until(deadline, _wake_on_events)) {
+			// Woken by input before the deadline. The deadline stays pending so the next call resumes the same frame.
+			refresh_window();
+			return true;
+		}
+	} else precise_wait_until(deadline, false, false);
+	Uint64 now = SDL_GetTicksNS();
+	if (now > deadline + frame_pacer_tolerance) _missed_deadlines++;
+	if (_last_frame) {
+		double frame_time = (now - _last_frame) / double(SDL_NS_PER_MS);
+		if (_frame_times.size() < frame_pacer_history) _frame_times.push_back(frame_time);
+		else _frame_times[_frame_times_pos] = frame_time;
+		_frame_times_pos = (_frame_times_pos + 1) % frame_pacer_history;
+	}
+	_last_frame = now;
+	_frames++;
+	if (window_thread) refresh_window();
+	return false;
+}
+bool frame_pacer::wait() {
+	Uint64 now = SDL_GetTicksNS();
+	if (_target_fps <= 0) return pace(now);
+	Uint64 interval = Uint64(SDL_NS_PER_SECOND / _target_fps);
+	if (!_deadline) _deadline = now + interval;
+	Uint64 deadline = _deadline;
+	bool woken = pace(deadline);
+	if (woken) return true;
+	// Deadlines advance on a fixed grid so that small overruns are absorbed by later frames, but if a whole frame was lost the grid is restarted rather than rushing through the backlog.
+	_deadline += interval;
+	now = SDL_GetTicksNS();
+	if (_deadline <= now) _deadline = now + interval;
+	return false;
+}
+bool frame_pacer::wait_until(double deadline_ms) {
+	Uint64 deadline = _start + Uint64(deadline_ms > 0 ? deadline_ms * SDL_NS_PER_MS : 0);
+	return pace(deadline);
+}
+double frame_pacer::get_last_frame_time() const {
+	if (_frame_times.empty()) return 0;
+	return _frame_times[(_frame_times_pos + frame_pacer_history - 1) % frame_pacer_history];
+}
+double frame_pacer::get_mean_frame_time() const {
+	if (_frame_times.empty()) return 0;
+	double total = 0;
+	for (double t : _frame_times) total += t;
+	return total / _frame_times.size();
+}
+double frame_pacer::get_max_frame_time() const {
+	if (_frame_times.empty()) return 0;
+	return *std::max_element(_frame_times.begin(), _frame_times.end());
+}
+double frame_pacer::get_percentile_frame_time(double percentile) const {
+	if (_frame_times.empty()) return 0;
+	std::vector<double> sorted(_frame_times);
+	size_t index = size_t(std::clamp(percentile, 0.0, 100.0) / 100.0 * (sorted.size() - 1) + 0.5);
+	std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+	return sorted[index];
+}
+void frame_pacer::reset_stats() {
+	_frame_times.clear();
+	_frame_times_pos = 0;
+	_frames = 0;
+	_missed_deadlines = 0;
+	_last_frame = 0;
+}
+
 // The following function contributed to NVGT by silak
 uint64_t idle_ticks() {
 	#ifdef _WIN32
@@ -660,6 +777,7 @@ system_tray_menu* system_tray::get_menu() {
 	_menu = new system_tray_menu(menu);
 	return _menu.get();
 }
+static frame_pacer* frame_pacer_factory(double target_fps) { return new frame_pacer(target_fps); }
 static system_tray* system_tray_factory(const std::string& tooltip, graphic* icon) { return new system_tray(tooltip, icon); }
 
 void RegisterUI(asIScriptEngine* engine) {
@@ -796,6 +914,25 @@ void RegisterUI(asIScriptEngine* engine) {
 	engine->RegisterGlobalFunction("uint64 get_window_os_handle()", asFUNCTION(get_window_os_handle), asCALL_CDECL);
 	engine->RegisterGlobalFunction("void refresh_window()", asFUNCTION(refresh_window), asCALL_CDECL);
 	engine->RegisterGlobalFunction("void wait(int ms)", asFUNCTIONPR(wait, (int), void), asCALL_CDECL);
+	engine->RegisterObjectType("frame_pacer", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("frame_pacer", asBEHAVE_ADDREF, "void f()", asMETHOD(frame_pacer, duplicate), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("frame_pacer", asBEHAVE_RELEASE, "void f()", asMETHOD(frame_pacer, release), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("frame_pacer", asBEHAVE_FACTORY, "frame_pacer@ f(double target_fps = 60)", asFUNCTION(frame_pacer_factory), asCALL_CDECL);
+	engine->RegisterObjectMethod("frame_pacer", "double get_target_fps() const property", asMETHOD(frame_pacer, get_target_fps), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "void set_target_fps(double fps) property", asMETHOD(frame_pacer, set_target_fps), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "bool get_wake_on_events() const property", asMETHOD(frame_pacer, get_wake_on_events), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "void set_wake_on_events(bool wake) property", asMETHOD(frame_pacer, set_wake_on_events), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "double get_elapsed() const property", asMETHOD(frame_pacer, get_elapsed), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "bool wait()", asMETHOD(frame_pacer, wait), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "bool wait_until(double deadline)", asMETHOD(frame_pacer, wait_until), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "uint get_frames() const property", asMETHOD(frame_pacer, get_frames), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "uint get_missed_deadlines() const property", asMETHOD(frame_pacer, get_missed_deadlines), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "double get_last_frame_time() const property", asMETHOD(frame_pacer, get_last_frame_time), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "double get_mean_frame_time() const property", asMETHOD(frame_pacer, get_mean_frame_time), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "double get_max_frame_time() const property", asMETHOD(frame_pacer, get_max_frame_time), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "double get_p99_frame_time() const property", asMETHOD(frame_pacer, get_p99_frame_time), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "double percentile_frame_time(double percentile) const", asMETHOD(frame_pacer, get_percentile_frame_time), asCALL_THISCALL);
+	engine->RegisterObjectMethod("frame_pacer", "void reset_stats()", asMETHOD(frame_pacer, reset_stats), asCALL_THISCALL);
 	engine->RegisterGlobalFunction("uint64 idle_ticks()", asFUNCTION(idle_ticks), asCALL_CDECL);
 	engine->RegisterGlobalFunction("bool is_console_available()", asFUNCTION(is_console_available), asCALL_CDECL);
 	// system_tray / system_tray_menu / system_tray_menu_item
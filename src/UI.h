@@ -207,6 +207,40 @@ public:
 	system_tray_menu* get_menu();
 };
 
+// Paces a loop to a target frame rate or to explicit deadlines with sub-millisecond precision, optionally returning as soon as input arrives, and keeps frame time statistics for the most recent frames.
+class frame_pacer {
+	double _target_fps;
+	bool _wake_on_events;
+	Uint64 _start;
+	Uint64 _deadline; // Next frame deadline in SDL_GetTicksNS units, 0 until the first wait.
+	Uint64 _last_frame;
+	std::vector<double> _frame_times; // Ring of recent frame times in milliseconds.
+	unsigned int _frame_times_pos;
+	unsigned int _frames;
+	unsigned int _missed_deadlines;
+	mutable int _refcount;
+	bool pace(Uint64 deadline);
+public:
+	frame_pacer(double target_fps = 60);
+	void duplicate() { asAtomicInc(_refcount); }
+	void release() { if (asAtomicDec(_refcount) < 1) delete this; }
+	double get_target_fps() const { return _target_fps; }
+	void set_target_fps(double fps);
+	bool get_wake_on_events() const { return _wake_on_events; }
+	void set_wake_on_events(bool wake) { _wake_on_events = wake; }
+	double get_elapsed() const;
+	bool wait();
+	bool wait_until(double deadline_ms);
+	unsigned int get_frames() const { return _frames; }
+	unsigned int get_missed_deadlines() const { return _missed_deadlines; }
+	double get_last_frame_time() const;
+	double get_mean_frame_time() const;
+	double get_max_frame_time() const;
+	double get_percentile_frame_time(double percentile) const;
+	double get_p99_frame_time() const { return get_percentile_frame_time(99); }
+	void reset_stats();
+};
+
 game_window* ShowNVGTWindow(const std::string& window_title, unsigned int flags = 0);
 bool DestroyNVGTWindow();
 bool WindowIsFocused();
@@ -33,6 +33,8 @@ public:
 	virtual bool speak(const std::string& text, bool interrupt = false, bool blocking = false) override;
 	virtual tts_audio_data* speak_to_pcm(const std::string &text) override;
 	virtual void free_pcm(tts_audio_data* data) override;
+	virtual bool get_pcm_streaming_supported() override;
+	virtual bool speak_to_pcm_stream(const std::string &text, const tts_pcm_stream_callback& callback) override;
 	virtual bool is_speaking() override;
 	virtual bool stop() override;
 	virtual float get_rate() override;
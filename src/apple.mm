@@ -262,11 +262,17 @@ int AVTTSVoice::get_current_voice() {
 	return impl->getVoiceIndex(currentVoiceName);
 }
 
-tts_audio_data* AVTTSVoice::speak_to_pcm(const std::string &text) {
-	if (!impl || text.empty()) return nullptr;
-	if (@available(iOS 13.0, macOS 10.15, *)) {} else return nullptr;
-	__block NSMutableData *audioData = [[NSMutableData alloc] init];
+bool AVTTSVoice::get_pcm_streaming_supported() {
+	if (@available(iOS 13.0, macOS 10.15, *)) return true;
+	return false;
+}
+
+bool AVTTSVoice::speak_to_pcm_stream(const std::string &text, const tts_pcm_stream_callback& callback) {
+	if (!impl || text.empty() || !callback) return false;
+	if (@available(iOS 13.0, macOS 10.15, *)) {} else return false;
+	const tts_pcm_stream_callback* cb = &callback;
 	__block BOOL synthesisDone = NO;
+	__block BOOL cancelled = NO;
 	__block AVAudioFormat *targetFormat = nil;
 	__block AVAudioConverter *converter = nil;
 	NSString *nstext = [NSString stringWithUTF8String:text.c_str()];
@@ -277,7 +283,7 @@ tts_audio_data* AVTTSVoice::speak_to_pcm(const std::string &text) {
 	utterance.voice = impl->currentVoice;
 	[impl->synth writeUtterance:utterance toBufferCallback:^(AVAudioBuffer * _Nonnull buffer) {
 		@autoreleasepool {
-			if (![buffer isKindOfClass:[AVAudioPCMBuffer class]]) return;
+			if (cancelled || ![buffer isKindOfClass:[AVAudioPCMBuffer class]]) return;
 			AVAudioPCMBuffer *pcmBuffer = (AVAudioPCMBuffer *)buffer;
 			if (pcmBuffer.frameLength == 0) { synthesisDone = YES; return; }
 			if (!converter) {
@@ -300,19 +306,37 @@ tts_audio_data* AVTTSVoice::speak_to_pcm(const std::string &text) {
 			NSError *error = nil;
 			AVAudioConverterOutputStatus status = [converter convertToBuffer:convertedBuffer error:&error withInputFromBlock:inputBlock];
 			if (status == AVAudioConverterOutputStatus_HaveData && convertedBuffer.frameLength > 0) {
-				NSUInteger bytesToAppend = convertedBuffer.frameLength * targetFormat.channelCount * sizeof(int16_t);
-				[audioData appendBytes:convertedBuffer.int16ChannelData[0] length:bytesToAppend];
+				unsigned int bytes = convertedBuffer.frameLength * targetFormat.channelCount * sizeof(int16_t);
+				if (!(*cb)(convertedBuffer.int16ChannelData[0], bytes, (unsigned int)targetFormat.sampleRate, (unsigned int)targetFormat.channelCount, 16)) cancelled = synthesisDone = YES;
 			}
+			[convertedBuffer release];
 		}
 	}];
 	NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:10.0];
 	while (!synthesisDone && [[NSDate date] compare:timeout] == NSOrderedAscending) [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+	if (!synthesisDone || cancelled) {
+		// The buffer callback must not outlive this call since it references the caller's callback.
+		cancelled = YES;
+		[impl->synth stopSpeakingAtBoundary:AVSpeechBoundaryImmediate];
+	}
 	if (converter) [converter release];
 	if (targetFormat) [targetFormat release];
-	if (!synthesisDone || audioData.length == 0) return nullptr;
-	unsigned int sampleRate = targetFormat ? (unsigned int)targetFormat.sampleRate : 22050;
-	unsigned int channelCount = targetFormat ? (unsigned int)targetFormat.channelCount : 1;
-	[audioData retain];
+	return synthesisDone && !cancelled;
+}
+
+tts_audio_data* AVTTSVoice::speak_to_pcm(const std::string &text) {
+	NSMutableData *audioData = [[NSMutableData alloc] init];
+	unsigned int sampleRate = 22050, channelCount = 1;
+	bool success = speak_to_pcm_stream(text, [&](const void* data, unsigned int size_in_bytes, unsigned int sample_rate, unsigned int channels, unsigned int bitsize) -> bool {
+		sampleRate = sample_rate;
+		channelCount = channels;
+		[audioData appendBytes:data length:size_in_bytes];
+		return true;
+	});
+	if (!success || audioData.length == 0) {
+		[audioData release];
+		return nullptr;
+	}
 	return new tts_audio_data(this, (void*)audioData.bytes, (unsigned int)audioData.length, sampleRate, channelCount, 16, (void*)audioData);
 }
 
@@ -19,13 +19,18 @@
 #if !defined(NVGT_STUB) && !defined(NVGT_MOBILE)
 #include <Poco/BinaryReader.h>
 #include <Poco/BinaryWriter.h>
+#include <Poco/Checksum.h>
 #include <Poco/Clock.h>
+#include <Poco/DateTime.h>
+#include <Poco/DeflatingStream.h>
 #include <Poco/Environment.h>
 #include <Poco/File.h>
 #include <Poco/FileStream.h>
 #include <Poco/Format.h>
 #include <Poco/Glob.h>
+#include <Poco/LocalDateTime.h>
 #include <Poco/Mutex.h>
+#include <Poco/NumberFormatter.h>
 #include <Poco/Path.h>
 #include <Poco/PipeStream.h>
 #include <Poco/Process.h>
@@ -33,16 +38,26 @@
 #include <Poco/String.h>
 #include <Poco/StringTokenizer.h>
 #include <Poco/TemporaryFile.h>
+#include <Poco/Timespan.h>
 #include <Poco/Timestamp.h>
 #include <Poco/Util/Application.h>
 #include <archive.h>
 #include <archive_entry.h>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <plist/plist.h>
+#include <thread>
+#include <unordered_map>
+#include <zlib.h>
 #ifdef _WIN32
 #include <vs_version.h>
 #endif
 #include "bundling.h"
 #include "filesystem.h"
+#include "hash.h"
 #include "misc_functions.h" // parse_float
 #include "nvgt.h"
 #ifndef NVGT_USER_CONFIG
@@ -138,8 +153,8 @@ static void libarchive_extract(const string& arc_path, const string& dest) {
 }
 // Recursively add all files in disk_dir to an open libarchive write handle.
 // arc_prefix: path prefix in archive (empty for root). exec_paths: archive paths that should get 0755.
-// store_paths: archive paths that should be stored without compression (zip only). zip: true if format is zip.
-static void archive_write_dir(struct archive* a, const string& disk_dir, const string& arc_prefix, const set<string>& exec_paths, const set<string>& store_paths, bool zip) {
+// Zip packages are instead written by bundle_zip_writer below.
+static void archive_write_dir(struct archive* a, const string& disk_dir, const string& arc_prefix, const set<string>& exec_paths) {
 	vector<File> entries;
 	File(disk_dir).list(entries);
 	for (const File& f : entries) {
@@ -154,12 +169,8 @@ static void archive_write_dir(struct archive* a, const string& disk_dir, const s
 			archive_entry_set_size(e, 0);
 			archive_write_header(a, e);
 			archive_entry_free(e);
-			archive_write_dir(a, f.path(), arc, exec_paths, store_paths, zip);
+			archive_write_dir(a, f.path(), arc, exec_paths);
 		} else {
-			if (zip) {
-				if (store_paths.count(arc)) archive_write_zip_set_compression_store(a);
-				else archive_write_zip_set_compression_deflate(a);
-			}
 			archive_entry_set_filetype(e, AE_IFREG);
 			archive_entry_set_perm(e, exec_paths.count(arc) ? 0755 : 0644);
 			archive_entry_set_size(e, (la_int64_t)f.getSize());
@@ -175,6 +186,276 @@ static void archive_write_dir(struct archive* a, const string& disk_dir, const s
 		}
 	}
 }
+// Writes zip packages (windows .zip, iOS .ipa, Android .apk) by hand rather than through libarchive, so that file contents can be deflated on several threads before the sequential write and so that deflated entries can be reused between builds. Deflated data is cached in a directory under a key made from the xxHash and size of the original file, and an index in that directory remembers the key and crc of each path along with its size and modification time so that unchanged files need not even be read again. Rebuilding a game with a large amount of unchanged assets is therefore mostly a matter of copying cached data into the new package.
+class bundle_zip_writer {
+	struct entry {
+		string disk_path, arc_path, source_path, key, deflated_path; // source_path is the asset this entry was copied from, if known.
+		bool directory, store, exec;
+		Timestamp modified, source_modified;
+		UInt64 size, compressed_size, offset;
+		UInt32 crc;
+		entry(const string& disk_path, const string& arc_path, bool directory, bool store, bool exec, const Timestamp& modified, UInt64 size) : disk_path(disk_path), arc_path(arc_path), directory(directory), store(store), exec(exec), modified(modified), size(size), compressed_size(0), offset(0), crc(0) {}
+		bool deflated() const { return !deflated_path.empty() && compressed_size < size; }
+	};
+	struct index_record {
+		string key;
+		UInt32 crc;
+		UInt64 size;
+		Int64 modified;
+	};
+	vector<entry> entries;
+	unordered_map<string, index_record> index, updated_index; // Keyed by source path.
+	std::mutex index_mtx;
+	map<string, string> sources; // Archive path prefix to the path it was copied from.
+	string cache_dir;
+	TemporaryFile temporary_cache;
+	bool persistent;
+	void add_entries(const string& disk_dir, const string& arc_prefix, const set<string>& exec_paths, const set<string>& store_paths) {
+		vector<File> files;
+		File(disk_dir).list(files);
+		for (const File& f : files) {
+			string name = Path(f.path()).makeFile().getFileName();
+			string arc = arc_prefix.empty() ? name : arc_prefix + "/" + name;
+			bool directory = f.isDirectory();
+			entries.emplace_back(f.path(), arc, directory, store_paths.count(arc) > 0, exec_paths.count(arc) > 0, f.getLastModified(), directory ? 0 : f.getSize());
+			if (directory) add_entries(f.path(), arc, exec_paths, store_paths);
+			else find_source(entries.back());
+		}
+	}
+	// Package contents are freshly copied into a temporary directory on every build, so their own paths and modification times never match the index. Files that were copied from a known source are looked up by that source instead.
+	void find_source(entry& e) {
+		string prefix = e.arc_path;
+		while (true) {
+			auto it = sources.find(prefix);
+			if (it != sources.end()) {
+				Path source(it->second);
+				if (prefix.size() < e.arc_path.size()) source.append(Path(e.arc_path.substr(prefix.size() + 1), Path::PATH_UNIX));
+				try {
+					File f(source);
+					if (!f.isFile() || f.getSize() != e.size) return;
+					e.source_path = source.toString();
+					e.source_modified = f.getLastModified();
+				} catch (Exception&) {}
+				return;
+			}
+			size_t pos = prefix.rfind('/');
+			if (pos == string::npos) return;
+			prefix.erase(pos);
+		}
+	}
+	void load_index() {
+		File index_file(Path(cache_dir).append("index").toString());
+		if (!persistent || !index_file.exists()) return;
+		FileInputStream in(index_file.path());
+		string line;
+		while (getline(in, line)) {
+			// key crc size modified path, separated by tabs with the path last as it is the only field that could contain spaces.
+			size_t fields[4];
+			size_t pos = 0;
+			bool valid = true;
+			for (int i = 0; i < 4 && valid; i++) {
+				pos = line.find('\t', pos);
+				if (pos == string::npos) valid = false;
+				else fields[i] = pos++;
+			}
+			if (!valid) continue;
+			index_record& r = index[line.substr(fields[3] + 1)];
+			r.key = line.substr(0, fields[0]);
+			r.crc = UInt32(strtoul(line.c_str() + fields[0] + 1, nullptr, 10));
+			r.size = strtoull(line.c_str() + fields[1] + 1, nullptr, 10);
+			r.modified = strtoll(line.c_str() + fields[2] + 1, nullptr, 10);
+		}
+	}
+	void save_index() {
+		if (!persistent) return;
+		// Records for source files that no longer exist are dropped.
+		for (auto& r : index) {
+			if (!updated_index.count(r.first) && File(r.first).exists()) updated_index.insert(r);
+		}
+		string index_path = Path(cache_dir).append("index").toString();
+		FileOutputStream out(index_path + ".tmp");
+		for (const auto& r : updated_index) out << r.second.key << '\t' << r.second.crc << '\t' << r.second.size << '\t' << r.second.modified << '\t' << r.first << '\n';
+		out.close();
+		File(index_path + ".tmp").renameTo(index_path);
+	}
+	// Blobs which neither the index nor this build refer to are deleted once they have gone unused for a day, which leaves any concurrent build sharing the cache time to finish with blobs it just wrote. Blobs still in use have their modification time refreshed in prepare_entry.
+	void evict_blobs() {
+		if (!persistent) return;
+		set<string> referenced;
+		for (const auto& r : updated_index) referenced.insert(r.second.key);
+		for (const entry& e : entries) referenced.insert(e.key);
+		vector<File> files;
+		File(cache_dir).list(files);
+		for (File& f : files) {
+			string name = Path(f.path()).getFileName();
+			if (name == "index" || referenced.count(name)) continue;
+			try {
+				if (f.isFile() && f.getLastModified().isElapsed(Timespan::DAYS)) f.remove();
+			} catch (Exception&) {} // Another build may have removed or replaced it.
+		}
+	}
+	// Runs on the worker threads, fills in the key, crc and deflated data of a file entry either from the cache or by reading the file.
+	void prepare_entry(entry& e, size_t entry_index) {
+		auto it = e.source_path.empty() ? index.end() : index.find(e.source_path);
+		if (it != index.end() && it->second.size == e.size && it->second.modified == e.source_modified.epochMicroseconds()) {
+			e.key = it->second.key;
+			e.crc = it->second.crc;
+		} else {
+			FileInputStream in(e.disk_path);
+			hasher h(HASH_XXH64);
+			Checksum crc(Checksum::TYPE_CRC32);
+			vector<char> buf(65536);
+			UInt64 total = 0;
+			while (in.good()) {
+				in.read(buf.data(), buf.size());
+				streamsize n = in.gcount();
+				if (n <= 0) break;
+				h.update(buf.data(), n);
+				crc.update(buf.data(), UInt32(n));
+				total += n;
+			}
+			if (total != e.size) throw Exception(format("%s changed while it was being bundled", e.disk_path));
+			e.key = format("%s-%s", NumberFormatter::formatHex(h.get_value(), 16), NumberFormatter::format(e.size));
+			e.crc = e.size ? crc.checksum() : 0;
+			if (!e.source_path.empty()) {
+				std::lock_guard<std::mutex> l(index_mtx);
+				updated_index[e.source_path] = {e.key, e.crc, e.size, e.source_modified.epochMicroseconds()};
+			}
+		}
+		if (e.store || e.size == 0) return;
+		File deflated(Path(cache_dir).append(e.key).toString());
+		if (!deflated.exists()) {
+			// Write to a name unique to this entry first, so that an interrupted build or two identical files never leave a partial entry under the final name.
+			string tmp_path = format("%s.%z.tmp", deflated.path(), entry_index);
+			{
+				FileInputStream in(e.disk_path);
+				FileOutputStream out(tmp_path);
+				DeflatingOutputStream deflater(out, -MAX_WBITS, Z_DEFAULT_COMPRESSION);
+				StreamCopier::copyStream(in, deflater, 65536);
+				deflater.close();
+				out.close();
+			}
+			File(tmp_path).renameTo(deflated.path());
+		} else if (persistent) {
+			try { deflated.setLastModified(Timestamp()); } catch (Exception&) {}
+		}
+		e.deflated_path = deflated.path();
+		e.compressed_size = deflated.getSize();
+	}
+	static void dos_date_time(const Timestamp& ts, UInt16& date, UInt16& time) {
+		LocalDateTime t{DateTime(ts)};
+		if (t.year() < 1980) {
+			date = (1 << 5) | 1;
+			time = 0;
+			return;
+		}
+		date = UInt16(((t.year() - 1980) << 9) | (t.month() << 5) | t.day());
+		time = UInt16((t.hour() << 11) | (t.minute() << 5) | (t.second() / 2));
+	}
+public:
+	bundle_zip_writer(const string& cache_directory) : cache_dir(cache_directory), persistent(!cache_directory.empty()) {
+		if (!persistent) cache_dir = temporary_cache.path();
+		File(cache_dir).createDirectories();
+		load_index();
+	}
+	// sources maps archive paths, or prefixes of them, to the files or directories that their contents were copied from.
+	void add_directory(const string& disk_dir, const string& arc_prefix, const set<string>& exec_paths, const set<string>& store_paths, const map<string, string>& sources = {}) {
+		this->sources = sources;
+		add_entries(disk_dir, arc_prefix, exec_paths, store_paths);
+	}
+	// Hashes and deflates every file entry that is not already cached, using thread_count threads (0 for one per core) including the calling one. The status callback is invoked from the calling thread only.
+	void prepare(unsigned int thread_count, const function<void(size_t done, size_t total)>& status = nullptr) {
+		if (!thread_count) thread_count = max(1u, std::thread::hardware_concurrency());
+		vector<size_t> files;
+		for (size_t i = 0; i < entries.size(); i++) {
+			if (!entries[i].directory) files.push_back(i);
+		}
+		std::atomic<size_t> next(0), done(0);
+		std::atomic<bool> failed(false);
+		std::exception_ptr error;
+		std::mutex error_mtx;
+		auto worker = [&](bool report) {
+			size_t i;
+			while (!failed && (i = next++) < files.size()) {
+				try {
+					prepare_entry(entries[files[i]], files[i]);
+				} catch (...) {
+					std::lock_guard<std::mutex> l(error_mtx);
+					if (!error) error = std::current_exception();
+					failed = true;
+				}
+				done++;
+				if (report && status) status(done, files.size());
+			}
+		};
+		vector<std::thread> threads;
+		for (unsigned int i = 1; i < thread_count && i < files.size(); i++) {
+			try { threads.emplace_back(worker, false); }
+			catch (std::system_error&) { break; }
+		}
+		worker(true);
+		for (std::thread& t : threads) t.join();
+		if (error) std::rethrow_exception(error);
+		save_index();
+		evict_blobs();
+	}
+	void write(const string& zip_path) {
+		FileOutputStream out(zip_path);
+		BinaryWriter bw(out, BinaryWriter::LITTLE_ENDIAN_BYTE_ORDER);
+		for (entry& e : entries) {
+			e.offset = UInt64(out.tellp());
+			string name = e.directory ? e.arc_path + "/" : e.arc_path;
+			UInt64 stored_size = e.deflated() ? e.compressed_size : e.size;
+			bool zip64 = e.size >= 0xffffffff || stored_size >= 0xffffffff;
+			UInt16 date, time;
+			dos_date_time(e.modified, date, time);
+			bw << UInt32(0x04034b50) << UInt16(zip64 ? 45 : 20) << UInt16(0x0800) << UInt16(e.deflated() ? 8 : 0) << time << date << e.crc;
+			if (zip64) bw << UInt32(0xffffffff) << UInt32(0xffffffff);
+			else bw << UInt32(stored_size) << UInt32(e.size);
+			bw << UInt16(name.size()) << UInt16(zip64 ? 20 : 0);
+			bw.writeRaw(name);
+			if (zip64) bw << UInt16(1) << UInt16(16) << e.size << stored_size;
+			if (e.directory || e.size == 0) continue;
+			bw.flush();
+			FileInputStream in(e.deflated() ? e.deflated_path : e.disk_path);
+			if (UInt64(StreamCopier::copyStream(in, out, 65536)) != stored_size) throw Exception(format("%s changed while it was being bundled", e.disk_path));
+		}
+		bw.flush();
+		UInt64 directory_offset = UInt64(out.tellp());
+		for (const entry& e : entries) {
+			string name = e.directory ? e.arc_path + "/" : e.arc_path;
+			UInt64 stored_size = e.deflated() ? e.compressed_size : e.size;
+			// Only the fields which don't fit in their 32 bit slots go into the zip64 extra field, in this order.
+			vector<UInt64> wide;
+			if (e.size >= 0xffffffff) wide.push_back(e.size);
+			if (stored_size >= 0xffffffff) wide.push_back(stored_size);
+			if (e.offset >= 0xffffffff) wide.push_back(e.offset);
+			UInt16 date, time;
+			dos_date_time(e.modified, date, time);
+			UInt32 mode = e.directory ? 040755 : (e.exec ? 0100755 : 0100644);
+			bw << UInt32(0x02014b50) << UInt16((3 << 8) | 45) << UInt16(wide.empty() ? 20 : 45) << UInt16(0x0800) << UInt16(e.deflated() ? 8 : 0) << time << date << e.crc;
+			bw << UInt32(stored_size >= 0xffffffff ? 0xffffffff : stored_size) << UInt32(e.size >= 0xffffffff ? 0xffffffff : e.size);
+			bw << UInt16(name.size()) << UInt16(wide.empty() ? 0 : 4 + wide.size() * 8) << UInt16(0) << UInt16(0) << UInt16(0);
+			bw << UInt32((mode << 16) | (e.directory ? 0x10 : 0)) << UInt32(e.offset >= 0xffffffff ? 0xffffffff : e.offset);
+			bw.writeRaw(name);
+			if (!wide.empty()) {
+				bw << UInt16(1) << UInt16(wide.size() * 8);
+				for (UInt64 v : wide) bw << v;
+			}
+		}
+		bw.flush();
+		UInt64 directory_end = UInt64(out.tellp());
+		UInt64 directory_size = directory_end - directory_offset;
+		if (entries.size() >= 0xffff || directory_offset >= 0xffffffff || directory_size >= 0xffffffff) {
+			bw << UInt32(0x06064b50) << UInt64(44) << UInt16((3 << 8) | 45) << UInt16(45) << UInt32(0) << UInt32(0) << UInt64(entries.size()) << UInt64(entries.size()) << directory_size << directory_offset;
+			bw << UInt32(0x07064b50) << UInt32(0) << directory_end << UInt32(1);
+		}
+		UInt16 count = UInt16(min<size_t>(entries.size(), 0xffff));
+		bw << UInt32(0x06054b50) << UInt16(0) << UInt16(0) << count << count << UInt32(min<UInt64>(directory_size, 0xffffffff)) << UInt32(min<UInt64>(directory_offset, 0xffffffff)) << UInt16(0);
+		bw.flush();
+		out.close();
+	}
+};
 // Thread-safe message box for use from the compilation worker thread. Dispatches message_box() onto the main thread via SDL_RunOnMainThread and blocks until the result is available. Returns -1 without showing anything for multi-button dialogs when quiet mode is active or a console is available, since the user cannot answer interactive questions in those conditions. Single-button alerts in console mode are printed to stdout.
 struct bundler_msgbox_args { const string& title; const string& text; const vector<string>& buttons; int result; };
 static void bundler_msgbox_callback(void* userdata) {
@@ -320,6 +601,26 @@ protected:
 			File(Path(g.filesystem_path).makeAbsolute(Path(get_input_file()).makeParent()).toString()).copyTo(p.toString());
 		}
 	}
+	// Maps the archive path of every game asset, as copied by bundle_assets, back to the asset's own location so that the bundle cache can recognize unchanged assets.
+	map<string, string> asset_sources(const string& arc_prefix) {
+		map<string, string> result;
+		for (const game_asset& g : g_game_assets) {
+			string arc = arc_prefix + g.bundled_path;
+			while (!arc.empty() && arc.back() == '/') arc.pop_back();
+			result[arc] = Path(g.filesystem_path).makeAbsolute(Path(get_input_file()).makeParent()).toString();
+		}
+		return result;
+	}
+	void write_zip_package(const string& zip_path, const string& disk_dir, const string& arc_prefix, const set<string>& exec_paths, const set<string>& store_paths, const map<string, string>& sources) {
+		// Deflated entries are cached across builds unless build.no_bundle_cache is set, see bundle_zip_writer.
+		string cache_dir;
+		if (!config.hasOption("build.no_bundle_cache")) cache_dir = config.getString("build.bundle_cache_directory", Path(Path::cacheHome()).append("nvgt/bundle_cache").toString());
+		bundle_zip_writer zip(cache_dir);
+		zip.add_directory(disk_dir, arc_prefix, exec_paths, store_paths, sources);
+		zip.prepare(config.getUInt("build.bundle_threads", 0), [this](size_t done, size_t total) { set_status(format("compressing files (%z of %z)...", done, total)); });
+		set_status("writing package...");
+		zip.write(zip_path);
+	}
 	void copy_shared_libraries(const Path& libpath) {
 		// Copy any needed shared libraries to the output package, handling excludes and already existent files.
 		set_status("copying libraries...");
@@ -418,13 +719,7 @@ protected:
 			set<string> store_paths;
 			for (const game_asset& g : g_game_assets)
 				if (g.flags & GAME_ASSET_UNCOMPRESSED) store_paths.insert(g.bundled_path);
-			struct archive* a = archive_write_new();
-			archive_write_set_format_zip(a);
-			archive_write_zip_set_compression_deflate(a);
-			archive_write_open_filename(a, zip_out.path().c_str());
-			archive_write_dir(a, workplace.path(), "", build_exec_paths("", ""), store_paths, true);
-			archive_write_close(a);
-			archive_write_free(a);
+			write_zip_package(zip_out.path(), workplace.path(), "", build_exec_paths("", ""), store_paths, asset_sources(""));
 			output_path = zip_out.path();
 		} else output_path = workplace.path();
 	}
@@ -515,7 +810,7 @@ protected:
 				archive_write_set_option(a, nullptr, "rockridge", "1");
 				archive_write_add_filter_none(a);
 				archive_write_open_filename(a, iso_out.path().c_str());
-				if (bundle_mode == 2) archive_write_dir(a, Path(workplace.path()).makeParent().toString(), "", mac_execs, {}, false);
+				if (bundle_mode == 2) archive_write_dir(a, Path(workplace.path()).makeParent().toString(), "", mac_execs);
 				else {
 					// Add .app explicitly, then add document assets at ISO root from their source paths.
 					struct archive_entry* de = archive_entry_new();
@@ -526,7 +821,7 @@ protected:
 					archive_entry_set_size(de, 0);
 					archive_write_header(a, de);
 					archive_entry_free(de);
-					archive_write_dir(a, workplace.path(), appname, mac_execs, {}, false);
+					archive_write_dir(a, workplace.path(), appname, mac_execs);
 					Path input_dir = Path(get_input_file()).makeParent();
 					for (const game_asset& g : g_game_assets) {
 						if (!(g.flags & GAME_ASSET_DOCUMENT)) continue;
@@ -669,13 +964,7 @@ protected:
 			for (const game_asset& g : g_game_assets)
 				if (g.flags & GAME_ASSET_UNCOMPRESSED) store_paths.insert(format("Payload/%s/%s", appbundle, g.bundled_path));
 			File ipa_out = Path(final_output_path).makeFile().setExtension("ipa").toString();
-			struct archive* a = archive_write_new();
-			archive_write_set_format_zip(a);
-			archive_write_zip_set_compression_deflate(a);
-			archive_write_open_filename(a, ipa_out.path().c_str());
-			archive_write_dir(a, ipa_root.toString(), "", build_exec_paths(ios_exec, format("Payload/%s", appbundle)), store_paths, true);
-			archive_write_close(a);
-			archive_write_free(a);
+			write_zip_package(ipa_out.path(), ipa_root.toString(), "", build_exec_paths(ios_exec, format("Payload/%s", appbundle)), store_paths, asset_sources(format("Payload/%s/", appbundle)));
 			output_path = ipa_out.path();
 		} else output_path = workplace.path();
 	}
@@ -711,7 +1000,7 @@ protected:
 			archive_write_set_format_pax_restricted(a);
 			archive_write_add_filter_gzip(a);
 			archive_write_open_filename(a, tgz_out.path().c_str());
-			archive_write_dir(a, workplace.path(), "", build_exec_paths(output_path.getFileName(), ""), {}, false);
+			archive_write_dir(a, workplace.path(), "", build_exec_paths(output_path.getFileName(), ""));
 			archive_write_close(a);
 			archive_write_free(a);
 			output_path = tgz_out.path();
@@ -909,13 +1198,7 @@ protected:
 		set<string> apk_store_arcs = {"resources.arsc"};
 		for (const game_asset& g : g_game_assets)
 			if (g.flags & GAME_ASSET_UNCOMPRESSED) apk_store_arcs.insert("assets/" + g.bundled_path);
-		struct archive* apk_arc = archive_write_new();
-		archive_write_set_format_zip(apk_arc);
-		archive_write_zip_set_compression_deflate(apk_arc);
-		archive_write_open_filename(apk_arc, zip_out_location.path().c_str());
-		archive_write_dir(apk_arc, workplace.path(), "", {}, apk_store_arcs, true);
-		archive_write_close(apk_arc);
-		archive_write_free(apk_arc);
+		write_zip_package(zip_out_location.path(), workplace.path(), "", {}, apk_store_arcs, asset_sources("assets/"));
 		// Now we need to align the zip file we just created using the Android sdk's zipalign tool, this will also be responsible for creating our final actual output file as it's the last operation that cannot be performed in place.
 		set_status("aligning APK...");
 		sout = serr = "";
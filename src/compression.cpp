@@ -1,4 +1,4 @@
-/* compression.cpp - string_deflate and string_inflate functions
+/* compression.cpp - string_deflate and string_inflate functions, plus reusable compressor and decompressor objects
  * original gist copyright 2007 Timo Bingmann <tb@panthema.net> under the boost license: https://gist.github.com/gomons/9d446024fbb7ccb6536ab984e29e154a
  *
  * NVGT - NonVisual Gaming Toolkit
@@ -11,35 +11,500 @@
  * 3. This notice may not be removed or altered from any source distribution.
 */
 
+#include <algorithm>
+#include <climits>
 #include <string>
 #include <cstring>
-#include <stdexcept>
-#include <iostream>
-#include <iomanip>
-#include <sstream>
-#include <Poco/InflatingStream.h>
-#include <Poco/DeflatingStream.h>
-#include "compression.h"
 #include <istream>
 #include <ostream>
+#include <Poco/Exception.h>
+#include <Poco/RefCountedObject.h>
+#include <zlib.h>
+#include <zstd.h>
+#define LZ4F_STATIC_LINKING_ONLY // The dictionary functions are still declared in the static section of older lz4frame.h releases.
+#include <lz4frame.h>
+#include "compression.h"
+#include "datastreams.h"
+
+using namespace Poco;
+
+// The string_deflate/string_inflate functions as well as the compressor and decompressor classes below talk to zlib, zstd and lz4 directly rather than going through Poco's deflating streams, so that the native state of a codec can be reset and reused between calls instead of being torn down and rebuilt every time something small is compressed.
+enum compression_codec {
+	COMPRESSION_CODEC_ZLIB, // Matches COMPRESSION_METHOD_ZLIB.
+	COMPRESSION_CODEC_GZIP, // Matches COMPRESSION_METHOD_GZIP.
+	COMPRESSION_CODEC_DEFLATE, // Raw deflate without any header or checksum.
+	COMPRESSION_CODEC_ZSTD,
+	COMPRESSION_CODEC_LZ4 // The LZ4 frame format, compatible with the lz4 command line tool.
+};
+const int compression_level_default = INT_MIN;
+const size_t compression_stream_chunk_size = 65536;
+
+static int zlib_window_bits(compression_codec codec) {
+	return codec == COMPRESSION_CODEC_GZIP ? 31 : codec == COMPRESSION_CODEC_DEFLATE ? -15 : 15;
+}
+static void check_codec(int codec) {
+	if (codec < COMPRESSION_CODEC_ZLIB || codec > COMPRESSION_CODEC_LZ4) throw InvalidArgumentException("unknown compression codec");
+}
+// Grows a string by up to size bytes and returns a pointer to the new area, the caller shrinks it again once it knows how much was produced.
+static char* grow(std::string& out, size_t size) {
+	size_t old = out.size();
+	out.resize(old + size);
+	return &out[old];
+}
+
+class compressor : public RefCountedObject {
+	compression_codec codec;
+	int level;
+	std::string dictionary;
+	bool dirty; // True if the level or dictionary changed since the native state was last built.
+	z_stream* zs;
+	ZSTD_CCtx* zstd_ctx;
+	ZSTD_CDict* zstd_dict;
+	LZ4F_cctx* lz4_ctx;
+	LZ4F_CDict* lz4_dict;
+	LZ4F_preferences_t lz4_prefs;
+	std::string buffer;
+	void free_state() {
+		if (zs) {
+			deflateEnd(zs);
+			delete zs;
+			zs = nullptr;
+		}
+		if (zstd_dict) ZSTD_freeCDict(zstd_dict);
+		if (zstd_ctx) ZSTD_freeCCtx(zstd_ctx);
+		if (lz4_dict) LZ4F_freeCDict(lz4_dict);
+		if (lz4_ctx) LZ4F_freeCompressionContext(lz4_ctx);
+		zstd_dict = nullptr;
+		zstd_ctx = nullptr;
+		lz4_dict = nullptr;
+		lz4_ctx = nullptr;
+	}
+	int native_level() const {
+		if (level != compression_level_default) return level;
+		return codec == COMPRESSION_CODEC_ZSTD ? ZSTD_CLEVEL_DEFAULT : codec == COMPRESSION_CODEC_LZ4 ? 0 : Z_DEFAULT_COMPRESSION;
+	}
+	void zlib_update(const char* data, size_t size, std::string& out, bool finish) {
+		do {
+			uInt slice = uInt(std::min<size_t>(size, 1 << 30)); // avail_in is only 32 bits wide.
+			zs->next_in = (Bytef*)data;
+			zs->avail_in = slice;
+			data += slice;
+			size -= slice;
+			bool last = finish && size == 0;
+			size_t chunk = std::max<size_t>(deflateBound(zs, slice), 1024);
+			int ret;
+			do {
+				char* dest = grow(out, chunk);
+				zs->next_out = (Bytef*)dest;
+				zs->avail_out = uInt(chunk);
+				ret = deflate(zs, last ? Z_FINISH : Z_NO_FLUSH);
+				out.resize(out.size() - zs->avail_out);
+				if (ret == Z_STREAM_ERROR) throw IOException("deflate failed");
+			} while (last ? ret != Z_STREAM_END : zs->avail_out == 0);
+		} while (size > 0);
+	}
+	void zstd_update(const char* data, size_t size, std::string& out, bool finish) {
+		ZSTD_inBuffer in = {data, size, 0};
+		size_t chunk = std::max(ZSTD_compressBound(size), ZSTD_CStreamOutSize());
+		size_t remaining;
+		do {
+			ZSTD_outBuffer o = {grow(out, chunk), chunk, 0};
+			remaining = ZSTD_compressStream2(zstd_ctx, &o, &in, finish ? ZSTD_e_end : ZSTD_e_continue);
+			out.resize(out.size() - chunk + o.pos);
+			if (ZSTD_isError(remaining)) throw IOException(std::string("zstd compression failed: ") + ZSTD_getErrorName(remaining));
+		} while (finish ? remaining != 0 : in.pos < in.size);
+	}
+	void lz4_update(const char* data, size_t size, std::string& out, bool finish) {
+		size_t chunk = LZ4F_compressBound(size, &lz4_prefs);
+		size_t written = LZ4F_compressUpdate(lz4_ctx, grow(out, chunk), chunk, data, size, nullptr);
+		out.resize(out.size() - chunk + (LZ4F_isError(written) ? 0 : written));
+		if (LZ4F_isError(written)) throw IOException(std::string("lz4 compression failed: ") + LZ4F_getErrorName(written));
+		if (!finish) return;
+		chunk = LZ4F_compressBound(0, &lz4_prefs);
+		written = LZ4F_compressEnd(lz4_ctx, grow(out, chunk), chunk, nullptr);
+		out.resize(out.size() - chunk + (LZ4F_isError(written) ? 0 : written));
+		if (LZ4F_isError(written)) throw IOException(std::string("lz4 compression failed: ") + LZ4F_getErrorName(written));
+	}
+public:
+	unsigned long long total_in, total_out;
+	compressor(int codec = COMPRESSION_CODEC_ZLIB, int level = compression_level_default, const std::string& dictionary = "") : codec(compression_codec(codec)), level(level), dirty(true), zs(nullptr), zstd_ctx(nullptr), zstd_dict(nullptr), lz4_ctx(nullptr), lz4_dict(nullptr), lz4_prefs(), total_in(0), total_out(0) {
+		check_codec(codec);
+		set_dictionary(dictionary);
+	}
+	~compressor() {
+		free_state();
+	}
+	int get_codec() const { return codec; }
+	int get_level() const { return level; }
+	void set_level(int new_level) {
+		if (new_level == level) return;
+		level = new_level;
+		dirty = true;
+	}
+	const std::string& get_dictionary() const { return dictionary; }
+	void set_dictionary(const std::string& new_dictionary) {
+		if (codec == COMPRESSION_CODEC_GZIP && !new_dictionary.empty()) throw InvalidArgumentException("the gzip format does not support dictionaries");
+		if (new_dictionary == dictionary) return;
+		dictionary = new_dictionary;
+		dirty = true;
+	}
+	// Prepares the native state for a new frame, only rebuilding it if the level or dictionary changed. Pass the total input size when it is known so that zstd and lz4 can record it in the frame header.
+	void begin(std::string& out, long long size_hint = -1) {
+		int lvl = native_level();
+		if (codec <= COMPRESSION_CODEC_DEFLATE) {
+			if (zs && dirty) {
+				deflateEnd(zs);
+				delete zs;
+				zs = nullptr;
+			}
+			if (!zs) {
+				zs = new z_stream();
+				if (deflateInit2(zs, lvl, Z_DEFLATED, zlib_window_bits(codec), 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+					delete zs;
+					zs = nullptr;
+					throw InvalidArgumentException("invalid zlib compression level");
+				}
+			} else deflateReset(zs);
+			if (!dictionary.empty()) deflateSetDictionary(zs, (const Bytef*)dictionary.data(), uInt(dictionary.size()));
+		} else if (codec == COMPRESSION_CODEC_ZSTD) {
+			if (!zstd_ctx) zstd_ctx = ZSTD_createCCtx();
+			if (dirty) {
+				ZSTD_CCtx_reset(zstd_ctx, ZSTD_reset_session_and_parameters);
+				ZSTD_CCtx_setParameter(zstd_ctx, ZSTD_c_compressionLevel, lvl);
+				if (zstd_dict) ZSTD_freeCDict(zstd_dict);
+				zstd_dict = dictionary.empty() ? nullptr : ZSTD_createCDict(dictionary.data(), dictionary.size(), lvl);
+				ZSTD_CCtx_refCDict(zstd_ctx, zstd_dict);
+			} else ZSTD_CCtx_reset(zstd_ctx, ZSTD_reset_session_only);
+			if (size_hint >= 0) ZSTD_CCtx_setPledgedSrcSize(zstd_ctx, size_hint);
+		} else if (codec == COMPRESSION_CODEC_LZ4) {
+			if (!lz4_ctx && LZ4F_isError(LZ4F_createCompressionContext(&lz4_ctx, LZ4F_VERSION))) throw IOException("unable to create lz4 compression context");
+			if (dirty) {
+				if (lz4_dict) LZ4F_freeCDict(lz4_dict);
+				lz4_dict = dictionary.empty() ? nullptr : LZ4F_createCDict(dictionary.data(), dictionary.size());
+			}
+			lz4_prefs = LZ4F_preferences_t();
+			lz4_prefs.compressionLevel = lvl;
+			lz4_prefs.frameInfo.blockMode = LZ4F_blockLinked;
+			lz4_prefs.frameInfo.contentSize = size_hint >= 0 ? size_hint : 0;
+			char* dest = grow(out, LZ4F_HEADER_SIZE_MAX);
+			size_t written = LZ4F_compressBegin_usingCDict(lz4_ctx, dest, LZ4F_HEADER_SIZE_MAX, lz4_dict, &lz4_prefs);
+			out.resize(out.size() - LZ4F_HEADER_SIZE_MAX + (LZ4F_isError(written) ? 0 : written));
+			if (LZ4F_isError(written)) throw IOException(std::string("lz4 compression failed: ") + LZ4F_getErrorName(written));
+		}
+		dirty = false;
+	}
+	// Appends the compressed form of the given data to out, finishing the frame if requested.
+	void update(const char* data, size_t size, std::string& out, bool finish) {
+		size_t before = out.size();
+		if (codec <= COMPRESSION_CODEC_DEFLATE) zlib_update(data, size, out, finish);
+		else if (codec == COMPRESSION_CODEC_ZSTD) zstd_update(data, size, out, finish);
+		else lz4_update(data, size, out, finish);
+		total_in += size;
+		total_out += out.size() - before;
+	}
+	void compress(const std::string& data, std::string& out) {
+		begin(out, data.size());
+		update(data.data(), data.size(), out, true);
+	}
+	std::string compress_script(const std::string& data) {
+		std::string out;
+		compress(data, out);
+		return out;
+	}
+	unsigned int compress_into(const std::string& data, std::string& output, bool append) {
+		if (!append) output.clear();
+		size_t before = output.size();
+		compress(data, output);
+		return output.size() - before;
+	}
+	unsigned long long compress_to(const std::string& data, datastream* output) {
+		if (!output || !output->get_ostr()) throw InvalidArgumentException("output stream is not writable");
+		buffer.clear();
+		compress(data, buffer);
+		output->get_ostr()->write(buffer.data(), buffer.size());
+		return output->get_ostr()->good() ? buffer.size() : 0;
+	}
+	unsigned long long compress_stream(datastream* input, datastream* output) {
+		if (!input || !input->get_istr()) throw InvalidArgumentException("input stream is not readable");
+		if (!output || !output->get_ostr()) throw InvalidArgumentException("output stream is not writable");
+		std::istream& istr = *input->get_istr();
+		std::ostream& ostr = *output->get_ostr();
+		std::string chunk(compression_stream_chunk_size, '\0');
+		unsigned long long written = 0;
+		buffer.clear();
+		begin(buffer);
+		while (true) {
+			istr.read(&chunk[0], chunk.size());
+			size_t got = istr.gcount();
+			bool finish = got < chunk.size();
+			update(chunk.data(), got, buffer, finish);
+			ostr.write(buffer.data(), buffer.size());
+			written += buffer.size();
+			buffer.clear();
+			if (!ostr.good()) return 0;
+			if (finish) break;
+		}
+		return written;
+	}
+	void reset_stats() {
+		total_in = total_out = 0;
+	}
+};
+
+class decompressor : public RefCountedObject {
+	compression_codec codec;
+	std::string dictionary;
+	bool dirty;
+	bool frame_done;
+	z_stream* zs;
+	ZSTD_DCtx* zstd_ctx;
+	ZSTD_DDict* zstd_dict;
+	LZ4F_dctx* lz4_ctx;
+	std::string buffer;
+	void free_state() {
+		if (zs) {
+			inflateEnd(zs);
+			delete zs;
+			zs = nullptr;
+		}
+		if (zstd_dict) ZSTD_freeDDict(zstd_dict);
+		if (zstd_ctx) ZSTD_freeDCtx(zstd_ctx);
+		if (lz4_ctx) LZ4F_freeDecompressionContext(lz4_ctx);
+		zstd_dict = nullptr;
+		zstd_ctx = nullptr;
+		lz4_ctx = nullptr;
+	}
+	void check_limit(const std::string& out, size_t start) {
+		if (max_output_size && out.size() - start > max_output_size) throw DataFormatException("decompressed data exceeds max_output_size");
+	}
+	void zlib_update(const char* data, size_t size, std::string& out, size_t start) {
+		size_t chunk = std::max<size_t>(size * 4, 4096);
+		while (size > 0 && !frame_done) {
+			uInt slice = uInt(std::min<size_t>(size, 1 << 30));
+			zs->next_in = (Bytef*)data;
+			zs->avail_in = slice;
+			int ret;
+			do {
+				char* dest = grow(out, chunk);
+				zs->next_out = (Bytef*)dest;
+				zs->avail_out = uInt(chunk);
+				ret = inflate(zs, Z_NO_FLUSH);
+				if (ret == Z_NEED_DICT) {
+					if (dictionary.empty() || inflateSetDictionary(zs, (const Bytef*)dictionary.data(), uInt(dictionary.size())) != Z_OK) {
+						out.resize(out.size() - chunk);
+						throw DataFormatException("compressed data requires a dictionary that was not provided or does not match");
+					}
+					ret = inflate(zs, Z_NO_FLUSH);
+				}
+				out.resize(out.size() - zs->avail_out);
+				if (ret == Z_DATA_ERROR || ret == Z_MEM_ERROR || ret == Z_STREAM_ERROR || ret == Z_NEED_DICT) throw DataFormatException(zs->msg ? zs->msg : "invalid deflate data");
+				check_limit(out, start);
+				if (ret == Z_STREAM_END) frame_done = true;
+				if (zs->avail_out == 0 && chunk < (1 << 24)) chunk *= 2;
+			} while (!frame_done && (zs->avail_in > 0 || zs->avail_out == 0));
+			data += slice - zs->avail_in;
+			size -= slice - zs->avail_in;
+		}
+	}
+	void zstd_update(const char* data, size_t size, std::string& out, size_t start) {
+		ZSTD_inBuffer in = {data, size, 0};
+		unsigned long long content_size = ZSTD_getFrameContentSize(data, size);
+		size_t chunk = content_size < (1ULL << 31) ? std::max<size_t>(content_size, 64) : ZSTD_DStreamOutSize();
+		bool full = true;
+		// Even once all input is consumed, zstd may still be holding output back if the last call filled the buffer.
+		while (in.pos < in.size || (full && !frame_done)) {
+			ZSTD_outBuffer o = {grow(out, chunk), chunk, 0};
+			size_t ret = ZSTD_decompressStream(zstd_ctx, &o, &in);
+			out.resize(out.size() - chunk + o.pos);
+			if (ZSTD_isError(ret)) throw DataFormatException(std::string("zstd decompression failed: ") + ZSTD_getErrorName(ret));
+			check_limit(out, start);
+			frame_done = ret == 0;
+			full = o.pos == o.size;
+			if (full) chunk = std::max(chunk, ZSTD_DStreamOutSize());
+		}
+	}
+	void lz4_update(const char* data, size_t size, std::string& out, size_t start) {
+		size_t chunk = std::max<size_t>(size * 4, 65536);
+		while (size > 0 || !frame_done) {
+			size_t dest_size = chunk, src_size = size;
+			char* dest = grow(out, chunk);
+			size_t ret = LZ4F_decompress_usingDict(lz4_ctx, dest, &dest_size, data, &src_size, dictionary.empty() ? nullptr : dictionary.data(), dictionary.size(), nullptr);
+			out.resize(out.size() - chunk + (LZ4F_isError(ret) ? 0 : dest_size));
+			if (LZ4F_isError(ret)) throw DataFormatException(std::string("lz4 decompression failed: ") + LZ4F_getErrorName(ret));
+			check_limit(out, start);
+			data += src_size;
+			size -= src_size;
+			if (ret == 0) {
+				frame_done = true;
+				break;
+			}
+			if (src_size == 0 && dest_size < chunk) break; // Needs more input.
+			if (dest_size == chunk && chunk < (1 << 24)) chunk *= 2;
+		}
+	}
+public:
+	unsigned long long max_output_size;
+	unsigned long long total_in, total_out;
+	decompressor(int codec = COMPRESSION_CODEC_ZLIB, const std::string& dictionary = "") : codec(compression_codec(codec)), dirty(true), frame_done(false), zs(nullptr), zstd_ctx(nullptr), zstd_dict(nullptr), lz4_ctx(nullptr), max_output_size(0), total_in(0), total_out(0) {
+		check_codec(codec);
+		set_dictionary(dictionary);
+	}
+	~decompressor() {
+		free_state();
+	}
+	int get_codec() const { return codec; }
+	const std::string& get_dictionary() const { return dictionary; }
+	void set_dictionary(const std::string& new_dictionary) {
+		if (codec == COMPRESSION_CODEC_GZIP && !new_dictionary.empty()) throw InvalidArgumentException("the gzip format does not support dictionaries");
+		if (new_dictionary == dictionary) return;
+		dictionary = new_dictionary;
+		dirty = true;
+	}
+	void begin() {
+		frame_done = false;
+		if (codec <= COMPRESSION_CODEC_DEFLATE) {
+			if (!zs) {
+				zs = new z_stream();
+				if (inflateInit2(zs, zlib_window_bits(codec)) != Z_OK) {
+					delete zs;
+					zs = nullptr;
+					throw IOException("unable to initialize zlib");
+				}
+			} else inflateReset(zs);
+			// Raw deflate streams have no header to request a dictionary with, so it must be set up front.
+			if (codec == COMPRESSION_CODEC_DEFLATE && !dictionary.empty()) inflateSetDictionary(zs, (const Bytef*)dictionary.data(), uInt(dictionary.size()));
+		} else if (codec == COMPRESSION_CODEC_ZSTD) {
+			if (!zstd_ctx) zstd_ctx = ZSTD_createDCtx();
+			ZSTD_DCtx_reset(zstd_ctx, ZSTD_reset_session_only);
+			if (dirty) {
+				if (zstd_dict) ZSTD_freeDDict(zstd_dict);
+				zstd_dict = dictionary.empty() ? nullptr : ZSTD_createDDict(dictionary.data(), dictionary.size());
+				ZSTD_DCtx_refDDict(zstd_ctx, zstd_dict);
+			}
+		} else if (codec == COMPRESSION_CODEC_LZ4) {
+			if (!lz4_ctx && LZ4F_isError(LZ4F_createDecompressionContext(&lz4_ctx, LZ4F_VERSION))) throw IOException("unable to create lz4 decompression context");
+			LZ4F_resetDecompressionContext(lz4_ctx);
+		}
+		dirty = false;
+	}
+	// Appends the decompressed form of the given data to out. Returns true once the end of the compressed frame has been reached.
+	bool update(const char* data, size_t size, std::string& out, size_t start) {
+		size_t before = out.size();
+		if (codec <= COMPRESSION_CODEC_DEFLATE) zlib_update(data, size, out, start);
+		else if (codec == COMPRESSION_CODEC_ZSTD) zstd_update(data, size, out, start);
+		else lz4_update(data, size, out, start);
+		total_in += size;
+		total_out += out.size() - before;
+		return frame_done;
+	}
+	void decompress(const std::string& data, std::string& out) {
+		size_t start = out.size();
+		begin();
+		if (!update(data.data(), data.size(), out, start)) throw DataFormatException("compressed data is truncated");
+	}
+	std::string decompress_script(const std::string& data) {
+		std::string out;
+		decompress(data, out);
+		return out;
+	}
+	unsigned int decompress_into(const std::string& data, std::string& output, bool append) {
+		if (!append) output.clear();
+		size_t before = output.size();
+		decompress(data, output);
+		return output.size() - before;
+	}
+	unsigned long long decompress_to(const std::string& data, datastream* output) {
+		if (!output || !output->get_ostr()) throw InvalidArgumentException("output stream is not writable");
+		buffer.clear();
+		decompress(data, buffer);
+		output->get_ostr()->write(buffer.data(), buffer.size());
+		return output->get_ostr()->good() ? buffer.size() : 0;
+	}
+	unsigned long long decompress_stream(datastream* input, datastream* output) {
+		if (!input || !input->get_istr()) throw InvalidArgumentException("input stream is not readable");
+		if (!output || !output->get_ostr()) throw InvalidArgumentException("output stream is not writable");
+		std::istream& istr = *input->get_istr();
+		std::ostream& ostr = *output->get_ostr();
+		std::string chunk(compression_stream_chunk_size, '\0');
+		unsigned long long written = 0;
+		bool done = false;
+		begin();
+		while (!done) {
+			istr.read(&chunk[0], chunk.size());
+			size_t got = istr.gcount();
+			if (got == 0) break;
+			buffer.clear();
+			done = update(chunk.data(), got, buffer, 0);
+			if (max_output_size && written + buffer.size() > max_output_size) throw DataFormatException("decompressed data exceeds max_output_size");
+			ostr.write(buffer.data(), buffer.size());
+			written += buffer.size();
+			if (!ostr.good()) return 0;
+		}
+		if (!done) throw DataFormatException("compressed data is truncated");
+		return written;
+	}
+	void reset_stats() {
+		total_in = total_out = 0;
+	}
+};
 
 std::string string_deflate(const std::string& str, int compressionlevel = -1) {
-	std::stringstream ostr;
-	Poco::DeflatingOutputStream stream(ostr, Poco::DeflatingStreamBuf::STREAM_ZLIB, compressionlevel);
-	stream << str;
-	stream.close();
-	return ostr.str();
+	static thread_local compressor deflater(COMPRESSION_CODEC_ZLIB);
+	deflater.set_level(compressionlevel);
+	std::string out;
+	deflater.compress(str, out);
+	return out;
 }
 
 std::string string_inflate(const std::string& str) {
-	std::stringstream ostr;
-	Poco::InflatingOutputStream stream(ostr, Poco::DeflatingStreamBuf::STREAM_ZLIB);
-	stream << str;
-	stream.close();
-	return ostr.str();
+	static thread_local decompressor inflater(COMPRESSION_CODEC_ZLIB);
+	std::string out;
+	inflater.decompress(str, out);
+	return out;
 }
 
+compressor* compressor_factory(int codec, int level, const std::string& dictionary) { return new compressor(codec, level, dictionary); }
+decompressor* decompressor_factory(int codec, const std::string& dictionary) { return new decompressor(codec, dictionary); }
+
 void RegisterScriptCompression(asIScriptEngine* engine) {
-	engine->RegisterGlobalFunction("string string_deflate(const string& in data, int compression_level = 9)", asFUNCTION(string_deflate), asCALL_CDECL);
+	engine->RegisterGlobalFunction("string string_deflate(const string& in data, int compression_level = -1)", asFUNCTION(string_deflate), asCALL_CDECL);
 	engine->RegisterGlobalFunction("string string_inflate(const string& in deflated)", asFUNCTION(string_inflate), asCALL_CDECL);
+	engine->RegisterEnum("compression_codec");
+	engine->RegisterEnumValue("compression_codec", "COMPRESSION_CODEC_ZLIB", COMPRESSION_CODEC_ZLIB);
+	engine->RegisterEnumValue("compression_codec", "COMPRESSION_CODEC_GZIP", COMPRESSION_CODEC_GZIP);
+	engine->RegisterEnumValue("compression_codec", "COMPRESSION_CODEC_DEFLATE", COMPRESSION_CODEC_DEFLATE);
+	engine->RegisterEnumValue("compression_codec", "COMPRESSION_CODEC_ZSTD", COMPRESSION_CODEC_ZSTD);
+	engine->RegisterEnumValue("compression_codec", "COMPRESSION_CODEC_LZ4", COMPRESSION_CODEC_LZ4);
+	engine->RegisterGlobalProperty("const int COMPRESSION_LEVEL_DEFAULT", (void*)&compression_level_default);
+	engine->RegisterObjectType("compressor", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("compressor", asBEHAVE_FACTORY, "compressor@ f(compression_codec codec = COMPRESSION_CODEC_ZLIB, int level = COMPRESSION_LEVEL_DEFAULT, const string&in dictionary = \"\")", asFUNCTION(compressor_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("compressor", asBEHAVE_ADDREF, "void f()", asMETHODPR(compressor, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("compressor", asBEHAVE_RELEASE, "void f()", asMETHODPR(compressor, release, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("compressor", "compression_codec get_codec() const property", asMETHOD(compressor, get_codec), asCALL_THISCALL);
+	engine->RegisterObjectMethod("compressor", "int get_level() const property", asMETHOD(compressor, get_level), asCALL_THISCALL);
+	engine->RegisterObjectMethod("compressor", "void set_level(int) property", asMETHOD(compressor, set_level), asCALL_THISCALL);
+	engine->RegisterObjectMethod("compressor", "const string& get_dictionary() const property", asMETHOD(compressor, get_dictionary), asCALL_THISCALL);
+	engine->RegisterObjectMethod("compressor", "void set_dictionary(const string&in) property", asMETHOD(compressor, set_dictionary), asCALL_THISCALL);
+	engine->RegisterObjectMethod("compressor", "string compress(const string&in data)", asMETHOD(compressor, compress_script), asCALL_THISCALL);
+	engine->RegisterObjectMethod("compressor", "uint compress_into(const string&in data, string& output, bool append = false)", asMETHOD(compressor, compress_into), asCALL_THISCALL);
+	engine->RegisterObjectMethod("compressor", "uint64 compress_to(const string&in data, datastream@ output)", asMETHOD(compressor, compress_to), asCALL_THISCALL);
+	engine->RegisterObjectMethod("compressor", "uint64 compress_stream(datastream@ input, datastream@ output)", asMETHOD(compressor, compress_stream), asCALL_THISCALL);
+	engine->RegisterObjectProperty("compressor", "const uint64 total_in", asOFFSET(compressor, total_in));
+	engine->RegisterObjectProperty("compressor", "const uint64 total_out", asOFFSET(compressor, total_out));
+	engine->RegisterObjectMethod("compressor", "void reset_stats()", asMETHOD(compressor, reset_stats), asCALL_THISCALL);
+	engine->RegisterObjectType("decompressor", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("decompressor", asBEHAVE_FACTORY, "decompressor@ f(compression_codec codec = COMPRESSION_CODEC_ZLIB, const string&in dictionary = \"\")", asFUNCTION(decompressor_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("decompressor", asBEHAVE_ADDREF, "void f()", asMETHODPR(decompressor, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("decompressor", asBEHAVE_RELEASE, "void f()", asMETHODPR(decompressor, release, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("decompressor", "compression_codec get_codec() const property", asMETHOD(decompressor, get_codec), asCALL_THISCALL);
+	engine->RegisterObjectMethod("decompressor", "const string& get_dictionary() const property", asMETHOD(decompressor, get_dictionary), asCALL_THISCALL);
+	engine->RegisterObjectMethod("decompressor", "void set_dictionary(const string&in) property", asMETHOD(decompressor, set_dictionary), asCALL_THISCALL);
+	engine->RegisterObjectMethod("decompressor", "string decompress(const string&in data)", asMETHOD(decompressor, decompress_script), asCALL_THISCALL);
+	engine->RegisterObjectMethod("decompressor", "uint decompress_into(const string&in data, string& output, bool append = false)", asMETHOD(decompressor, decompress_into), asCALL_THISCALL);
+	engine->RegisterObjectMethod("decompressor", "uint64 decompress_to(const string&in data, datastream@ output)", asMETHOD(decompressor, decompress_to), asCALL_THISCALL);
+	engine->RegisterObjectMethod("decompressor", "uint64 decompress_stream(datastream@ input, datastream@ output)", asMETHOD(decompressor, decompress_stream), asCALL_THISCALL);
+	engine->RegisterObjectProperty("decompressor", "uint64 max_output_size", asOFFSET(decompressor, max_output_size));
+	engine->RegisterObjectProperty("decompressor", "const uint64 total_in", asOFFSET(decompressor, total_in));
+	engine->RegisterObjectProperty("decompressor", "const uint64 total_out", asOFFSET(decompressor, total_out));
+	engine->RegisterObjectMethod("decompressor", "void reset_stats()", asMETHOD(decompressor, reset_stats), asCALL_THISCALL);
 }
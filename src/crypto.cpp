@@ -16,8 +16,10 @@
 #include <string>
 #include <cstring>
 #include <sstream>
+#include <stdexcept>
 #include <rng_get_bytes.h>
 #include <obfuscate.h>
+#include <openssl/evp.h>
 #include <Poco/SHA2Engine.h>
 #include "monocypher.h"
 
@@ -307,6 +309,179 @@ std::ostream &chacha_ostream::own_sink(bool owns) {
 	return *this;
 }
 
+// Chunked AEAD streams
+static const char aead_stream_magic[4] = {'N', 'V', 'A', 'E'};
+static const uint8_t aead_stream_version = 1;
+static const int aead_header_size = 24; // magic, version, algorithm, 2 reserved bytes, little endian chunk size and the 12 byte base nonce.
+static const int aead_tag_size = 16;
+static const unsigned int aead_min_chunk_size = 64, aead_max_chunk_size = 16 * 1024 * 1024;
+static const EVP_CIPHER* aead_cipher(int algorithm) {
+	if (algorithm == AEAD_AES_256_GCM) return EVP_aes_256_gcm();
+	else if (algorithm == AEAD_CHACHA20_POLY1305) return EVP_chacha20_poly1305();
+	return nullptr;
+}
+static EVP_CIPHER_CTX* aead_create_context(int algorithm, const std::string& key, bool encrypt) {
+	if (key.empty())
+		throw std::invalid_argument("Key must not be blank.");
+	const EVP_CIPHER* cipher = aead_cipher(algorithm);
+	if (!cipher)
+		throw std::invalid_argument("Unknown encryption algorithm.");
+	// Arbitrary key strings are hashed down to 256 bits in the same way as asset_encryptor does it.
+	uint8_t derived_key[32];
+	crypto_blake2b(derived_key, 32, (const uint8_t*)key.data(), key.size());
+	EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+	bool ok = ctx && EVP_CipherInit_ex(ctx, cipher, nullptr, derived_key, nullptr, encrypt ? 1 : 0) > 0;
+	crypto_wipe(derived_key, 32);
+	if (!ok) {
+		EVP_CIPHER_CTX_free(ctx);
+		throw std::runtime_error("Unable to initialize cipher.");
+	}
+	return ctx;
+}
+// Seals or opens one chunk in place of out. The chunk index is mixed into the last 8 bytes of the nonce, and the header plus a final chunk flag make up the associated data.
+static bool aead_process_chunk(EVP_CIPHER_CTX* ctx, const uint8_t* base_nonce, uint64_t counter, const std::string& header, bool final, const uint8_t* in, int length, uint8_t* out, uint8_t* tag, bool encrypt) {
+	uint8_t chunk_nonce[12];
+	memcpy(chunk_nonce, base_nonce, 12);
+	for (int i = 0; i < 8; i++) chunk_nonce[11 - i] ^= uint8_t(counter >> (i * 8));
+	uint8_t final_flag = final ? 1 : 0;
+	int outl = 0, finl = 0;
+	if (EVP_CipherInit_ex(ctx, nullptr, nullptr, nullptr, chunk_nonce, -1) <= 0) return false;
+	if (EVP_CipherUpdate(ctx, nullptr, &outl, (const uint8_t*)header.data(), (int)header.size()) <= 0) return false;
+	if (EVP_CipherUpdate(ctx, nullptr, &outl, &final_flag, 1) <= 0) return false;
+	if (length > 0 && EVP_CipherUpdate(ctx, out, &outl, in, length) <= 0) return false;
+	if (!encrypt && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, aead_tag_size, tag) <= 0) return false;
+	if (EVP_CipherFinal_ex(ctx, out + outl, &finl) <= 0) return false;
+	if (encrypt && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, aead_tag_size, tag) <= 0) return false;
+	return true;
+}
+
+aead_ostreambuf::aead_ostreambuf(std::ostream &sink, const std::string &key, int algorithm, unsigned int chunk_size) : sink(&sink), ctx(nullptr), counter(0), finished(false), owns_sink(false) {
+	if (chunk_size < aead_min_chunk_size || chunk_size > aead_max_chunk_size)
+		throw std::invalid_argument("Chunk size must be between 64 bytes and 16 MB.");
+	if (rng_get_bytes(nonce, 12) != 12)
+		throw std::runtime_error("Could not obtain required number of bytes for nonce.");
+	ctx = aead_create_context(algorithm, key, true);
+	header.assign(aead_stream_magic, 4);
+	header += char(aead_stream_version);
+	header += char(algorithm);
+	header.append(2, '\0');
+	for (int i = 0; i < 4; i++) header += char((chunk_size >> (i * 8)) & 0xff);
+	header.append((const char*)nonce, 12);
+	sink.write(header.data(), header.size());
+	buffer.resize(chunk_size);
+	work.resize(chunk_size + aead_tag_size);
+	setp(buffer.data(), buffer.data() + buffer.size());
+}
+aead_ostreambuf::~aead_ostreambuf() {
+	finish();
+	crypto_wipe(buffer.data(), buffer.size());
+	EVP_CIPHER_CTX_free(ctx);
+	if (owns_sink)
+		delete sink;
+}
+void aead_ostreambuf::own_sink(bool owns) {
+	owns_sink = owns;
+}
+bool aead_ostreambuf::write_chunk(std::streamsize length, bool final) {
+	uint8_t* out = (uint8_t*)work.data();
+	if (!aead_process_chunk(ctx, nonce, counter++, header, final, (const uint8_t*)buffer.data(), (int)length, out, out + length, true))
+		return false;
+	sink->write(work.data(), length + aead_tag_size);
+	setp(buffer.data(), buffer.data() + buffer.size());
+	return sink->good();
+}
+bool aead_ostreambuf::finish() {
+	if (finished) return true;
+	finished = true;
+	std::streamsize length = pptr() - pbase();
+	bool ok = true;
+	// A full chunk is never final, that way readers can tell the last chunk apart by its size alone.
+	if (length == (std::streamsize)buffer.size()) {
+		ok = write_chunk(length, false);
+		length = 0;
+	}
+	ok = ok && write_chunk(length, true);
+	setp(nullptr, nullptr);
+	sink->flush();
+	return ok;
+}
+aead_ostreambuf::int_type aead_ostreambuf::overflow(int_type c) {
+	if (finished)
+		return traits_type::eof();
+	if (pptr() == epptr() && !write_chunk(buffer.size(), false))
+		return traits_type::eof();
+	if (!traits_type::eq_int_type(c, traits_type::eof())) {
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+	}
+	return traits_type::not_eof(c);
+}
+int aead_ostreambuf::sync() {
+	// Partial chunks are held back until they fill or the stream is finished, since sealing them early would make their size indistinguishable from the final chunk.
+	sink->flush();
+	return sink->good() ? 0 : -1;
+}
+aead_istreambuf::aead_istreambuf(std::istream &source, const std::string &key) : source(&source), ctx(nullptr), counter(0), chunk_size(0), finished(false), owns_source(false) {
+	char h[aead_header_size];
+	source.read(h, aead_header_size);
+	if (source.gcount() != aead_header_size || memcmp(h, aead_stream_magic, 4) != 0 || uint8_t(h[4]) != aead_stream_version)
+		throw std::invalid_argument("This is not a valid encrypted stream.");
+	for (int i = 0; i < 4; i++) chunk_size |= unsigned(uint8_t(h[8 + i])) << (i * 8);
+	if (chunk_size < aead_min_chunk_size || chunk_size > aead_max_chunk_size)
+		throw std::invalid_argument("This is not a valid encrypted stream.");
+	ctx = aead_create_context(uint8_t(h[5]), key, false);
+	header.assign(h, aead_header_size);
+	memcpy(nonce, h + 12, 12);
+	buffer.resize(chunk_size);
+	work.resize(chunk_size + aead_tag_size);
+	setg(buffer.data(), buffer.data(), buffer.data());
+}
+aead_istreambuf::~aead_istreambuf() {
+	crypto_wipe(buffer.data(), buffer.size());
+	EVP_CIPHER_CTX_free(ctx);
+	if (owns_source)
+		delete source;
+}
+void aead_istreambuf::own_source(bool owns) {
+	owns_source = owns;
+}
+aead_istreambuf::int_type aead_istreambuf::underflow() {
+	if (gptr() < egptr())
+		return traits_type::to_int_type(*gptr());
+	if (finished)
+		return traits_type::eof();
+	setg(buffer.data(), buffer.data(), buffer.data());
+	source->read(work.data(), work.size());
+	std::streamsize length = source->gcount() - aead_tag_size;
+	if (length < 0)
+		throw std::runtime_error("Encrypted stream is truncated.");
+	bool final = length < (std::streamsize)chunk_size;
+	uint8_t* in = (uint8_t*)work.data();
+	if (!aead_process_chunk(ctx, nonce, counter++, header, final, in, (int)length, (uint8_t*)buffer.data(), in + length, false)) {
+		crypto_wipe(buffer.data(), buffer.size());
+		throw std::runtime_error("Encrypted stream failed authentication.");
+	}
+	finished = final;
+	if (length == 0)
+		return traits_type::eof();
+	setg(buffer.data(), buffer.data(), buffer.data() + length);
+	return traits_type::to_int_type(*gptr());
+}
+aead_istream::aead_istream(std::istream &source, const std::string &key) : buf(source, key), basic_istream(&buf) {
+}
+std::istream &aead_istream::own_source(bool owns) {
+	buf.own_source(owns);
+	return *this;
+}
+aead_ostream::aead_ostream(std::ostream &sink, const std::string &key, int algorithm, unsigned int chunk_size) : buf(sink, key, algorithm, chunk_size), basic_ostream(&buf) {
+}
+aead_ostream::~aead_ostream() {
+	buf.finish();
+}
+std::ostream &aead_ostream::own_sink(bool owns) {
+	buf.own_sink(owns);
+	return *this;
+}
 
 void RegisterScriptCrypto(asIScriptEngine* engine) {
 	engine->RegisterGlobalFunction(_O("string string_aes_encrypt(const string&in plaintext, string key)"), asFUNCTION(string_aes_encrypt), asCALL_CDECL);
@@ -13,8 +13,10 @@
 #pragma once
 
 #include <angelscript.h>
+#include <cstdint>
 #include <string>
 #include <iostream>
+#include <vector>
 #include <Poco/BufferedStreamBuf.h>
 #ifdef _WIN32
 	#define WIN32_LEAN_AND_MEAN
@@ -85,4 +87,67 @@ public:
 	virtual std::ostream &own_sink(bool owns = true);
 };
 
+// Chunked authenticated encryption streams. The plaintext is split into chunks that are each sealed with AES-256-GCM or ChaCha20-Poly1305 through OpenSSL, which picks AES-NI, ARMv8 crypto extensions or vectorized ChaCha implementations at runtime. Every chunk's nonce is derived from a random per-stream nonce and the chunk index, and the final chunk is flagged in its authenticated data, so reordered, modified or truncated streams are all detected before any of the affected plaintext is released.
+enum aead_algorithm { AEAD_AES_256_GCM, AEAD_CHACHA20_POLY1305 };
+struct evp_cipher_ctx_st;
+class aead_ostreambuf : public std::streambuf {
+	std::ostream *sink;
+	evp_cipher_ctx_st *ctx;
+	std::string header; // Written in cleartext at the start of the stream and authenticated along with every chunk.
+	uint8_t nonce[12];
+	uint64_t counter;
+	std::vector<char> buffer;
+	std::vector<char> work;
+	bool finished;
+	bool owns_sink;
+	bool write_chunk(std::streamsize length, bool final);
+
+public:
+	aead_ostreambuf(std::ostream &sink, const std::string &key, int algorithm, unsigned int chunk_size);
+	virtual ~aead_ostreambuf();
+	void own_sink(bool owns);
+	// Seals whatever is buffered as the final chunk, after which nothing more can be written.
+	bool finish();
+
+protected:
+	virtual int_type overflow(int_type c);
+	virtual int sync();
+};
+class aead_istreambuf : public std::streambuf {
+	std::istream *source;
+	evp_cipher_ctx_st *ctx;
+	std::string header;
+	uint8_t nonce[12];
+	uint64_t counter;
+	unsigned int chunk_size;
+	std::vector<char> buffer;
+	std::vector<char> work;
+	bool finished;
+	bool owns_source;
+
+public:
+	aead_istreambuf(std::istream &source, const std::string &key);
+	virtual ~aead_istreambuf();
+	void own_source(bool owns);
+
+protected:
+	// Throws if a chunk fails authentication or the stream ends before its final chunk, which the istream turns into badbit.
+	virtual int_type underflow();
+};
+class aead_istream : public std::istream {
+	aead_istreambuf buf;
+
+public:
+	aead_istream(std::istream &source, const std::string &key);
+	virtual std::istream &own_source(bool owns = true);
+};
+class aead_ostream : public std::ostream {
+	aead_ostreambuf buf;
+
+public:
+	aead_ostream(std::ostream &sink, const std::string &key, int algorithm = AEAD_AES_256_GCM, unsigned int chunk_size = 65536);
+	virtual ~aead_ostream();
+	virtual std::ostream &own_sink(bool owns = true);
+};
+
 void RegisterScriptCrypto(asIScriptEngine* engine);
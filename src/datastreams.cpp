@@ -39,9 +39,12 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <scriptarray.h>
 #include "datastreams.h"
 #include "nvgt.h"          // subsystems.
 #include "crypto.h" //Custom asset encryption stream.
+#include "hash.h"
 
 using namespace Poco;
 
@@ -824,6 +827,15 @@ void counting_stream_add_pos(datastream* ds, std::streamsize value) {
 	if (ios)
 		ios->addPos(value);
 }
+template <class T>
+hasher* hashing_stream_get_hasher(datastream* ds) {
+	T* stream = dynamic_cast<T*>(ds->stream());
+	if (!stream)
+		return nullptr;
+	hasher* h = stream->get_hasher();
+	h->duplicate();
+	return h;
+}
 template <class T, class S>
 void RegisterCountingStream(asIScriptEngine* engine, const std::string& type) {
 	RegisterDatastreamType<T, datastream_factory_closed, S>(engine, type);
@@ -837,6 +849,273 @@ void RegisterCountingStream(asIScriptEngine* engine, const std::string& type) {
 	engine->RegisterObjectMethod(type.c_str(), "void add_pos(int64)", asFUNCTION(counting_stream_add_pos), asCALL_CDECL_OBJFIRST);
 }
 
+// buffer_reader and buffer_writer
+static bool buffer_byteorder_swaps(int byteorder) {
+	#ifdef POCO_ARCH_BIG_ENDIAN
+	return byteorder == BinaryReader::LITTLE_ENDIAN_BYTE_ORDER;
+	#else
+	return byteorder == BinaryReader::BIG_ENDIAN_BYTE_ORDER;
+	#endif
+}
+bool buffer_reader::open(const std::string& buffer, int byteorder) {
+	owned = buffer;
+	return open_view(owned.data(), owned.size(), byteorder);
+}
+bool buffer_reader::open_view(const char* buffer, size_t size, int byteorder) {
+	if (buffer != owned.data()) owned.clear();
+	data = buffer ? buffer : owned.data(); // A null address with a size of 0 still gives an active, empty reader.
+	length = buffer ? size : 0;
+	cursor = 0;
+	swap = buffer_byteorder_swaps(byteorder);
+	_eof = false;
+	return true;
+}
+bool buffer_reader::open_stream(datastream* source, unsigned long long max_size, int byteorder) {
+	if (!source || !source->get_istr()) return false;
+	std::istream& istr = *source->get_istr();
+	std::string result;
+	// Read the rest of the stream in one go if it can tell us how big it is, otherwise fall back to copying it in chunks.
+	std::streampos pos = istr.tellg();
+	if (pos > -1 && istr.seekg(0, std::ios::end)) {
+		unsigned long long remaining = (unsigned long long)(istr.tellg() - pos);
+		istr.seekg(pos);
+		if (max_size && remaining > max_size) remaining = max_size;
+		result.resize(remaining);
+		istr.read(&result[0], remaining);
+		result.resize(istr.gcount());
+	} else {
+		istr.clear();
+		char chunk[16384];
+		while (istr && (!max_size || result.size() < max_size)) {
+			istr.read(chunk, max_size ? std::min<unsigned long long>(sizeof(chunk), max_size - result.size()) : sizeof(chunk));
+			result.append(chunk, istr.gcount());
+		}
+	}
+	owned.swap(result);
+	return open_view(owned.data(), owned.size(), byteorder);
+}
+bool buffer_reader::close() {
+	if (!data) return false;
+	owned.clear();
+	owned.shrink_to_fit();
+	data = nullptr;
+	length = cursor = 0;
+	_eof = false;
+	return true;
+}
+bool buffer_reader::seek(unsigned long long offset) {
+	if (!data || offset > length) return false;
+	cursor = offset;
+	_eof = false;
+	return true;
+}
+bool buffer_reader::seek_end(unsigned long long offset) {
+	return offset <= length && seek(length - offset);
+}
+bool buffer_reader::seek_relative(long long offset) {
+	if (offset < 0 && (unsigned long long)(-offset) > cursor) return false;
+	return seek(cursor + offset);
+}
+std::string buffer_reader::take(size_t size) {
+	if (size > length - cursor) {
+		size = length - cursor;
+		_eof = true;
+	}
+	std::string result(data + cursor, size);
+	cursor += size;
+	return result;
+}
+std::string buffer_reader::read(unsigned int size) {
+	if (!data) return "";
+	return take(size ? size : length - cursor);
+}
+std::string buffer_reader::read_line() {
+	if (!data) return "";
+	const char* start = data + cursor;
+	const char* end = (const char*)std::memchr(start, '\n', length - cursor);
+	if (!end) return take(length - cursor + 1); // Like std::getline, a final line without a newline sets eof.
+	cursor = end - data + 1;
+	return std::string(start, end - start);
+}
+std::string buffer_reader::read_until(const std::string& text, bool require_full) {
+	if (!data || text.empty()) return "";
+	std::string_view haystack(data + cursor, length - cursor);
+	size_t found = require_full ? haystack.find(text) : haystack.find(text[0]);
+	if (found == std::string_view::npos) return take(length - cursor + 1);
+	return take(found + (require_full ? text.size() : 1));
+}
+UInt64 buffer_reader::read_7bit_encoded() {
+	UInt64 value = 0;
+	for (int shift = 0; shift < 70; shift += 7) {
+		if (cursor >= length) {
+			_eof = true;
+			break;
+		}
+		unsigned char c = data[cursor++];
+		value |= UInt64(c & 0x7f) << shift;
+		if (!(c & 0x80)) break;
+	}
+	return value;
+}
+template <typename T>
+unsigned int buffer_reader::read_array(CScriptArray* values, unsigned int count) {
+	if (!values) return 0;
+	if (!data) count = 0;
+	size_t fits = (length - cursor) / sizeof(T);
+	if (count > fits) {
+		count = fits;
+		_eof = true;
+	}
+	values->Resize(count);
+	if (!count) return 0;
+	T* out = (T*)values->GetBuffer();
+	std::memcpy(out, data + cursor, count * sizeof(T));
+	cursor += count * sizeof(T);
+	if constexpr(sizeof(T) > 1) {
+		if (swap) {
+			for (unsigned int i = 0; i < count; i++) out[i] = byte_swap(out[i]);
+		}
+	}
+	return count;
+}
+buffer_writer::buffer_writer(unsigned long long reserve, int byteorder) : cursor(0), byteorder(byteorder), swap(buffer_byteorder_swaps(byteorder)) {
+	if (reserve) buffer.reserve(reserve);
+}
+void buffer_writer::clear() {
+	buffer.clear();
+	cursor = 0;
+}
+bool buffer_writer::seek(unsigned long long offset) {
+	if (offset > buffer.size()) return false;
+	cursor = offset;
+	return true;
+}
+bool buffer_writer::seek_end(unsigned long long offset) {
+	return offset <= buffer.size() && seek(buffer.size() - offset);
+}
+bool buffer_writer::seek_relative(long long offset) {
+	if (offset < 0 && (unsigned long long)(-offset) > cursor) return false;
+	return seek(cursor + offset);
+}
+unsigned int buffer_writer::write(const std::string& data) {
+	if (!data.empty()) std::memcpy(claim(data.size()), data.data(), data.size());
+	return data.size();
+}
+void buffer_writer::write_7bit_encoded(UInt64 integer) {
+	do {
+		unsigned char c = integer & 0x7f;
+		integer >>= 7;
+		if (integer) c |= 0x80;
+		*claim(1) = c;
+	} while (integer);
+}
+template <typename T>
+unsigned int buffer_writer::write_array(CScriptArray* values) {
+	if (!values || values->GetSize() == 0) return 0;
+	unsigned int count = values->GetSize();
+	T* out = (T*)claim(count * sizeof(T));
+	std::memcpy(out, values->GetBuffer(), count * sizeof(T));
+	if constexpr(sizeof(T) > 1) {
+		if (swap) {
+			for (unsigned int i = 0; i < count; i++) out[i] = buffer_reader::byte_swap(out[i]);
+		}
+	}
+	return count;
+}
+unsigned long long buffer_writer::write_to(datastream* output) {
+	if (!output || !output->get_ostr()) return 0;
+	output->get_ostr()->write(buffer.data(), buffer.size());
+	return output->get_ostr()->good() ? buffer.size() : 0;
+}
+buffer_reader* buffer_writer::get_reader() const {
+	buffer_reader* reader = new buffer_reader();
+	reader->open(buffer, byteorder);
+	return reader;
+}
+buffer_reader* buffer_reader_factory(const std::string& data, int byteorder) {
+	buffer_reader* reader = new buffer_reader();
+	reader->open(data, byteorder);
+	return reader;
+}
+buffer_reader* buffer_reader_stream_factory(datastream* source, unsigned long long max_size, int byteorder) {
+	buffer_reader* reader = new buffer_reader();
+	if (!reader->open_stream(source, max_size, byteorder)) {
+		reader->release();
+		throw InvalidArgumentException("Unable to read from given stream");
+	}
+	return reader;
+}
+buffer_reader* buffer_reader_memory_factory(UInt64 address, UInt64 size, int byteorder) {
+	buffer_reader* reader = new buffer_reader();
+	reader->open_view((const char*)address, size, byteorder);
+	return reader;
+}
+bool buffer_reader_memory_open(buffer_reader* reader, UInt64 address, UInt64 size, int byteorder) { return reader->open_view((const char*)address, size, byteorder); }
+buffer_writer* buffer_writer_factory(UInt64 reserve, int byteorder) { return new buffer_writer(reserve, byteorder); }
+template <typename T>
+void RegisterBufferReadwrite(asIScriptEngine* engine, const std::string& type_name) {
+	engine->RegisterObjectMethod("buffer_reader", format("buffer_reader& opShr(%s&out)", type_name).c_str(), asMETHODPR(buffer_reader, read<T>, (T&), buffer_reader&), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", format("%s read_%s()", type_name, type_name).c_str(), asMETHODPR(buffer_reader, read<T>, (), T), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", format("buffer_writer& opShl(%s)", type_name).c_str(), asMETHODPR(buffer_writer, write<T>, (T), buffer_writer&), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", format("buffer_writer& write_%s(%s)", type_name, type_name).c_str(), asMETHODPR(buffer_writer, write<T>, (T), buffer_writer&), asCALL_THISCALL);
+	if constexpr(!std::is_same<T, std::string>::value) {
+		engine->RegisterObjectMethod("buffer_reader", format("uint read_array(%s[]@ values, uint count)", type_name).c_str(), asMETHOD(buffer_reader, read_array<T>), asCALL_THISCALL);
+		engine->RegisterObjectMethod("buffer_writer", format("uint write_array(const %s[]@ values)", type_name).c_str(), asMETHOD(buffer_writer, write_array<T>), asCALL_THISCALL);
+	}
+}
+void RegisterBufferStreams(asIScriptEngine* engine) {
+	engine->RegisterObjectType("buffer_reader", 0, asOBJ_REF);
+	engine->RegisterObjectType("buffer_writer", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("buffer_reader", asBEHAVE_FACTORY, "buffer_reader@ f(const string&in data = \"\", int byteorder = STREAM_BYTE_ORDER_NATIVE)", asFUNCTION(buffer_reader_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("buffer_reader", asBEHAVE_FACTORY, "buffer_reader@ f(datastream@ source, uint64 max_size = 0, int byteorder = STREAM_BYTE_ORDER_NATIVE)", asFUNCTION(buffer_reader_stream_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("buffer_reader", asBEHAVE_ADDREF, "void f()", asMETHODPR(buffer_reader, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("buffer_reader", asBEHAVE_RELEASE, "void f()", asMETHODPR(buffer_reader, release, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "bool open(const string&in data, int byteorder = STREAM_BYTE_ORDER_NATIVE)", asMETHOD(buffer_reader, open), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "bool open(datastream@ source, uint64 max_size = 0, int byteorder = STREAM_BYTE_ORDER_NATIVE)", asMETHOD(buffer_reader, open_stream), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "bool close()", asMETHOD(buffer_reader, close), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "bool get_active() const property", asMETHOD(buffer_reader, active), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "uint64 get_size() const property", asMETHOD(buffer_reader, size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "uint64 get_available() const property", asMETHOD(buffer_reader, available), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "int64 get_pos() const property", asMETHOD(buffer_reader, get_pos), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "bool get_good() const property", asMETHOD(buffer_reader, good), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "bool get_eof() const property", asMETHOD(buffer_reader, eof), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "bool seek(uint64)", asMETHOD(buffer_reader, seek), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "bool seek_end(uint64 = 0)", asMETHOD(buffer_reader, seek_end), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "bool seek_relative(int64)", asMETHOD(buffer_reader, seek_relative), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "string read(uint = 0)", asMETHODPR(buffer_reader, read, (unsigned int), std::string), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "string read_line()", asMETHOD(buffer_reader, read_line), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "string read_until(const string&in text, bool require_full)", asMETHOD(buffer_reader, read_until), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "uint64 read_7bit_encoded()", asMETHODPR(buffer_reader, read_7bit_encoded, (), UInt64), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_reader", "void read_7bit_encoded(uint64&out integer)", asMETHODPR(buffer_reader, read_7bit_encoded, (UInt64&), void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("buffer_writer", asBEHAVE_FACTORY, "buffer_writer@ f(uint64 reserve = 0, int byteorder = STREAM_BYTE_ORDER_NATIVE)", asFUNCTION(buffer_writer_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("buffer_writer", asBEHAVE_ADDREF, "void f()", asMETHODPR(buffer_writer, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("buffer_writer", asBEHAVE_RELEASE, "void f()", asMETHODPR(buffer_writer, release, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "const string& str() const", asMETHOD(buffer_writer, str), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "uint64 get_size() const property", asMETHOD(buffer_writer, size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "int64 get_pos() const property", asMETHOD(buffer_writer, get_pos), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "uint64 get_capacity() const property", asMETHOD(buffer_writer, get_capacity), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "void reserve(uint64 size)", asMETHOD(buffer_writer, reserve), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "void clear()", asMETHOD(buffer_writer, clear), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "bool seek(uint64)", asMETHOD(buffer_writer, seek), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "bool seek_end(uint64 = 0)", asMETHOD(buffer_writer, seek_end), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "bool seek_relative(int64)", asMETHOD(buffer_writer, seek_relative), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "uint write(const string&in)", asMETHODPR(buffer_writer, write, (const std::string&), unsigned int), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "void write_7bit_encoded(uint64 integer)", asMETHOD(buffer_writer, write_7bit_encoded), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "uint64 write_to(datastream@ output)", asMETHOD(buffer_writer, write_to), asCALL_THISCALL);
+	engine->RegisterObjectMethod("buffer_writer", "buffer_reader@ get_reader() const", asMETHOD(buffer_writer, get_reader), asCALL_THISCALL);
+	RegisterBufferReadwrite<char>(engine, "int8");
+	RegisterBufferReadwrite<unsigned char>(engine, "uint8");
+	RegisterBufferReadwrite<short>(engine, "int16");
+	RegisterBufferReadwrite<unsigned short>(engine, "uint16");
+	RegisterBufferReadwrite<int>(engine, "int");
+	RegisterBufferReadwrite<unsigned int>(engine, "uint");
+	RegisterBufferReadwrite<long long>(engine, "int64");
+	RegisterBufferReadwrite<unsigned long long>(engine, "uint64");
+	RegisterBufferReadwrite<float>(engine, "float");
+	RegisterBufferReadwrite<double>(engine, "double");
+	RegisterBufferReadwrite<std::string>(engine, "string");
+}
+
 // Wrappers around cin, cout and cerr from the stl. The first function just performs any common setup used for all 3 streams.
 datastream* dscmd(datastream* ds) {
 	ds->no_close = true;
@@ -910,10 +1189,21 @@ void RegisterScriptDatastreams(asIScriptEngine* engine) {
 	RegisterOutputDatastreamType<InflatingOutputStream, InflatingStreamBuf::StreamType>(engine, "inflating_writer", "compression_method compression = COMPRESSION_METHOD_ZLIB");
 	RegisterCountingStream<CountingInputStream, std::istream>(engine, "counting_reader");
 	RegisterCountingStream<CountingOutputStream, std::ostream>(engine, "counting_writer");
+	RegisterScriptHasher(engine);
+	RegisterInputDatastreamType<hashing_istream, hasher*>(engine, "hashing_reader", "hasher@+ hasher");
+	engine->RegisterObjectMethod("hashing_reader", "hasher@ get_hasher() const property", asFUNCTION(hashing_stream_get_hasher<hashing_istream>), asCALL_CDECL_OBJFIRST);
+	RegisterOutputDatastreamType<hashing_ostream, hasher*>(engine, "hashing_writer", "hasher@+ hasher");
+	engine->RegisterObjectMethod("hashing_writer", "hasher@ get_hasher() const property", asFUNCTION(hashing_stream_get_hasher<hashing_ostream>), asCALL_CDECL_OBJFIRST);
 	RegisterInputDatastreamType<InputLineEndingConverter, const std::string&>(engine, "line_converting_reader", "const string&in line_ending = spec::NEWLINE_DEFAULT");
 	RegisterOutputDatastreamType<OutputLineEndingConverter, const std::string&>(engine, "line_converting_writer", "const string&in line_ending = spec::NEWLINE_DEFAULT");
 	RegisterOutputDatastreamType<chacha_ostream, const std::string&>(engine, "asset_encryptor", "string& in key");
 	RegisterInputDatastreamType<chacha_istream, const std::string&>(engine, "asset_decryptor", "const string& in key");
+	engine->RegisterEnum("aead_algorithm");
+	engine->RegisterEnumValue("aead_algorithm", "AEAD_AES_256_GCM", AEAD_AES_256_GCM);
+	engine->RegisterEnumValue("aead_algorithm", "AEAD_CHACHA20_POLY1305", AEAD_CHACHA20_POLY1305);
+	RegisterOutputDatastreamType<aead_ostream, const std::string&, int, unsigned int>(engine, "aead_encryptor", "const string&in key, aead_algorithm algorithm = AEAD_AES_256_GCM, uint chunk_size = 65536");
+	RegisterInputDatastreamType<aead_istream, const std::string&>(engine, "aead_decryptor", "const string&in key");
+	RegisterBufferStreams(engine);
 	engine->SetDefaultAccessMask(NVGT_SUBSYSTEM_RAW_MEMORY);
 	RegisterDatastreamType<MemoryInputStream, datastream_factory_closed>(engine, "memory_reader");
 	engine->RegisterObjectBehaviour("memory_reader", asBEHAVE_FACTORY, "memory_reader@ d(uint64, uint64, const string&in encoding = \"\", int byteorder = 1)", asFUNCTION((generic_stream_factory<MemoryInputStream, const char*, size_t>)), asCALL_CDECL);
@@ -921,5 +1211,7 @@ void RegisterScriptDatastreams(asIScriptEngine* engine) {
 	RegisterDatastreamType<MemoryOutputStream, datastream_factory_closed>(engine, "memory_writer");
 	engine->RegisterObjectBehaviour("memory_writer", asBEHAVE_FACTORY, "memory_writer@ d(uint64, uint64, const string&in encoding = \"\", int byteorder = 1)", asFUNCTION((generic_stream_factory<MemoryOutputStream, char*, size_t>)), asCALL_CDECL);
 	engine->RegisterObjectMethod("memory_writer", "bool open(uint64, uint64, const string&in encoding = \"\", int byteorder = 1)", asFUNCTION((generic_stream_open<MemoryOutputStream, char*, size_t>)), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectBehaviour("buffer_reader", asBEHAVE_FACTORY, "buffer_reader@ f(uint64 address, uint64 size, int byteorder = STREAM_BYTE_ORDER_NATIVE)", asFUNCTION(buffer_reader_memory_factory), asCALL_CDECL);
+	engine->RegisterObjectMethod("buffer_reader", "bool open(uint64 address, uint64 size, int byteorder = STREAM_BYTE_ORDER_NATIVE)", asFUNCTION(buffer_reader_memory_open), asCALL_CDECL_OBJFIRST);
 	engine->SetDefaultAccessMask(NVGT_SUBSYSTEM_GENERAL);
 }
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 #include <vector>
 #include <angelscript.h>
@@ -199,6 +201,113 @@ public:
 	}
 };
 
+class CScriptArray;
+// buffer_reader and buffer_writer are a fast path for parsing or building binary data that lives in one contiguous block of memory. They produce and consume exactly the same format as a datastream with no text encoding, but every primitive is a bounds checked memcpy rather than a trip through a BinaryReader and a virtual streambuf, and arrays of primitives are transferred with a single copy.
+class buffer_reader : public Poco::RefCountedObject {
+	std::string owned; // Holds the data unless the reader is a view over memory owned by someone else.
+	const char* data;
+	size_t length;
+	size_t cursor;
+	bool swap; // True if the requested byte order differs from the native one.
+	bool _eof;
+	template <typename T> static T byte_swap(T value) {
+		unsigned char bytes[sizeof(T)];
+		std::memcpy(bytes, &value, sizeof(T));
+		std::reverse(bytes, bytes + sizeof(T));
+		std::memcpy(&value, bytes, sizeof(T));
+		return value;
+	}
+	friend class buffer_writer;
+	// Returns up to size bytes from the cursor, setting eof if fewer were available.
+	std::string take(size_t size);
+public:
+	buffer_reader() : data(nullptr), length(0), cursor(0), swap(false), _eof(false) {}
+	bool open(const std::string& buffer, int byteorder = Poco::BinaryReader::NATIVE_BYTE_ORDER);
+	bool open_view(const char* buffer, size_t size, int byteorder = Poco::BinaryReader::NATIVE_BYTE_ORDER); // Does not copy, the memory must outlive the reader.
+	bool open_stream(datastream* source, unsigned long long max_size = 0, int byteorder = Poco::BinaryReader::NATIVE_BYTE_ORDER);
+	bool close();
+	inline bool active() const { return data != nullptr; }
+	inline unsigned long long size() const { return length; }
+	inline unsigned long long get_pos() const { return cursor; }
+	inline unsigned long long available() const { return length - cursor; }
+	inline bool eof() const { return _eof; }
+	inline bool good() const { return data && !_eof; }
+	inline const char* get_data() const { return data; }
+	bool seek(unsigned long long offset);
+	bool seek_end(unsigned long long offset);
+	bool seek_relative(long long offset);
+	std::string read(unsigned int size);
+	std::string read_line();
+	std::string read_until(const std::string& text, bool require_full);
+	Poco::UInt64 read_7bit_encoded();
+	void read_7bit_encoded(Poco::UInt64& integer) { integer = read_7bit_encoded(); }
+	template <typename T> T read() {
+		if constexpr(std::is_same<T, std::string>::value) {
+			return take(read_7bit_encoded());
+		} else {
+			T value = 0;
+			if (length - cursor < sizeof(T)) {
+				cursor = length;
+				_eof = true;
+				return value;
+			}
+			std::memcpy(&value, data + cursor, sizeof(T));
+			cursor += sizeof(T);
+			if constexpr(sizeof(T) > 1) {
+				if (swap) value = byte_swap(value);
+			}
+			return value;
+		}
+	}
+	template <typename T> buffer_reader& read(T& value) {
+		value = read<T>();
+		return *this;
+	}
+	// Reads count values straight into a primitive array, resizing it to the number of values actually read.
+	template <typename T> unsigned int read_array(CScriptArray* values, unsigned int count);
+};
+class buffer_writer : public Poco::RefCountedObject {
+	std::string buffer;
+	size_t cursor;
+	int byteorder;
+	bool swap;
+	// Returns a pointer to size writable bytes at the cursor, extending the buffer if needed, and advances the cursor past them.
+	inline char* claim(size_t size) {
+		if (cursor + size > buffer.size()) buffer.resize(cursor + size);
+		char* ptr = &buffer[cursor];
+		cursor += size;
+		return ptr;
+	}
+public:
+	buffer_writer(unsigned long long reserve = 0, int byteorder = Poco::BinaryWriter::NATIVE_BYTE_ORDER);
+	inline const std::string& str() const { return buffer; }
+	inline unsigned long long size() const { return buffer.size(); }
+	inline unsigned long long get_pos() const { return cursor; }
+	inline unsigned long long get_capacity() const { return buffer.capacity(); }
+	void reserve(unsigned long long size) { buffer.reserve(size); }
+	void clear();
+	bool seek(unsigned long long offset);
+	bool seek_end(unsigned long long offset);
+	bool seek_relative(long long offset);
+	unsigned int write(const std::string& data);
+	void write_7bit_encoded(Poco::UInt64 integer);
+	template <typename T> buffer_writer& write(T value) {
+		if constexpr(std::is_same<T, std::string>::value) {
+			write_7bit_encoded(value.size());
+			write(value);
+		} else {
+			if constexpr(sizeof(T) > 1) {
+				if (swap) value = buffer_reader::byte_swap(value);
+			}
+			std::memcpy(claim(sizeof(T)), &value, sizeof(T));
+		}
+		return *this;
+	}
+	template <typename T> unsigned int write_array(CScriptArray* values);
+	unsigned long long write_to(datastream* output);
+	buffer_reader* get_reader() const;
+};
+
 // These macros simply allow the registration of a stream with a bit less typing, since there are many streams and any amount of them may be registered later.
 #define f_streamargs const std::string& encoding = "", int byteorder = Poco::BinaryReader::NATIVE_BYTE_ORDER
 #define p_streamargs encoding, byteorder
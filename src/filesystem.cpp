@@ -11,14 +11,24 @@
  * 3. This notice may not be removed or altered from any source distribution.
 */
 
+#include <algorithm>
 #include <array>
+#include <condition_variable>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 #include <angelscript.h> // the actual Angelscript header
 #include <scriptarray.h>
 #include <Poco/Exception.h>
 #include <Poco/File.h>
 #include <Poco/Glob.h>
 #include <Poco/Path.h>
+#include <Poco/RefCountedObject.h>
 #include <Poco/Timestamp.h>
 #include <Poco/UnicodeConverter.h>
 #include <SDL3/SDL.h>
@@ -44,56 +54,42 @@ bool FNMatch(const std::string& file, const std::string& pattern) {
 	} catch(Exception& e) { return false; }
 }
 
-// Includes below only used for this function, the Angelscript filesystem functions are faster than Poco's directory iterators where we have to repeatedly call GetFileAttributes to determine whether each item is a file or directory.
+// Includes below are used for directory enumeration, the native directory APIs are faster than Poco's directory iterators where we have to repeatedly call GetFileAttributes or stat to determine whether each item is a file or directory.
 #ifdef _WIN32
 #include <windows.h>
 #else
 #include <sys/stat.h>
 #include <dirent.h>
+#include <fcntl.h>
 #endif
 
-CScriptArray* FindFiles(const string& path) {
-	// Obtain a pointer to the engine
-	asIScriptContext* ctx = asGetActiveContext();
-	asIScriptEngine* engine = ctx->GetEngine();
-
-	// TODO: This should only be done once
+// Lists the files or the subdirectories matching a path with a wildcard in its last component, such as "sounds/*.ogg".
+static CScriptArray* find_entries(const string& path, bool directories) {
 	// TODO: This assumes that CScriptArray was already registered
 	asITypeInfo* arrayType = get_array_type("array<string>");
-
-	// Create the array object
-	CScriptArray* array = CScriptArray::Create(arrayType);
-
+	vector<string> found;
 	#if defined(_WIN32)
 	// Windows uses UTF16 so it is necessary to convert the string
-	wchar_t bufUTF16[1024];
-	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, bufUTF16, 1024);
-
+	std::wstring pathUTF16;
+	UnicodeConverter::convert(path, pathUTF16);
 	WIN32_FIND_DATAW ffd;
-	HANDLE hFind = FindFirstFileExW(bufUTF16, FindExInfoStandard, &ffd, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+	// FindExInfoBasic skips looking up the 8.3 short name of each entry which we never use.
+	HANDLE hFind = FindFirstFileExW(pathUTF16.c_str(), FindExInfoBasic, &ffd, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
 	if (INVALID_HANDLE_VALUE == hFind)
-		return array;
-
+		return CScriptArray::Create(arrayType);
 	do {
-		// Skip directories
-		if ((ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+		if (bool(ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != directories)
 			continue;
-
-		// Convert the file name back to UTF8
-		char bufUTF8[1024];
-		WideCharToMultiByte(CP_UTF8, 0, ffd.cFileName, -1, bufUTF8, 1024, 0, 0);
-
-		// Add the file to the array
-		array->Resize(array->GetSize() + 1);
-		((string*)(array->At(array->GetSize() - 1)))->assign(bufUTF8);
+		if (directories && (wcscmp(ffd.cFileName, L".") == 0 || wcscmp(ffd.cFileName, L"..") == 0))
+			continue;
+		found.emplace_back();
+		UnicodeConverter::convert(ffd.cFileName, found.back());
 	} while (FindNextFileW(hFind, &ffd) != 0);
-
 	FindClose(hFind);
 	#else
-	int wildcard = path.rfind('/');
+	size_t wildcard = path.rfind('/');
 	if (wildcard == std::string::npos) wildcard = path.rfind('\\');
-	string currentPath = path;
-	string Wildcard = "*";
+	string currentPath, Wildcard;
 	if (wildcard != std::string::npos) {
 		currentPath = path.substr(0, wildcard + 1);
 		Wildcard = path.substr(wildcard + 1);
@@ -101,117 +97,50 @@ CScriptArray* FindFiles(const string& path) {
 		currentPath = "./";
 		Wildcard = path;
 	}
-	dirent* ent = 0;
+	// Compile the pattern once rather than for every entry, and skip matching altogether for the common "*" case.
+	unique_ptr<Glob> matcher;
+	try {
+		if (Wildcard != "*") matcher = make_unique<Glob>(Wildcard);
+	} catch (Exception&) {
+		return CScriptArray::Create(arrayType);
+	}
 	DIR* dir = opendir(currentPath.c_str());
-	if (!dir) return array;
+	if (!dir) return CScriptArray::Create(arrayType);
+	int fd = dirfd(dir);
+	dirent* ent;
 	while ((ent = readdir(dir)) != NULL) {
-		const string filename = ent->d_name;
-
-		// Skip . and ..
+		const char* filename = ent->d_name;
+		// Skip . and .. along with hidden entries
 		if (filename[0] == '.')
 			continue;
-
-		// Skip sub directories
-		string fullname = currentPath + filename;
-		struct stat st;
-		if (stat(fullname.c_str(), &st) == -1)
-			continue;
-		if ((st.st_mode & S_IFDIR) != 0)
-			continue;
-
-		// wildcard matching
-		if (!FNMatch(filename, Wildcard)) continue;
-
-		// Add the file to the array
-		array->Resize(array->GetSize() + 1);
-		((string*)(array->At(array->GetSize() - 1)))->assign(filename);
+		if (matcher && !matcher->match(filename)) continue;
+		// The entry type usually comes straight from readdir, only symbolic links and filesystems that don't report it need a stat call.
+		bool is_directory;
+		#ifdef DT_DIR
+		if (ent->d_type == DT_DIR) is_directory = true;
+		else if (ent->d_type != DT_UNKNOWN && ent->d_type != DT_LNK) is_directory = false;
+		else
+		#endif
+		{
+			struct stat st;
+			if (fstatat(fd, filename, &st, 0) == -1)
+				continue;
+			is_directory = S_ISDIR(st.st_mode);
+		}
+		if (is_directory != directories) continue;
+		found.emplace_back(filename);
 	}
 	closedir(dir);
 	#endif
-
+	CScriptArray* array = CScriptArray::Create(arrayType, found.size());
+	for (asUINT i = 0; i < found.size(); i++) static_cast<string*>(array->At(i))->swap(found[i]);
 	return array;
 }
-
+CScriptArray* FindFiles(const string& path) {
+	return find_entries(path, false);
+}
 CScriptArray* FindDirectories(const string& path) {
-	// Obtain a pointer to the engine
-	asIScriptContext* ctx = asGetActiveContext();
-	asIScriptEngine* engine = ctx->GetEngine();
-
-	// TODO: This assumes that CScriptArray was already registered
-	asITypeInfo* arrayType = get_array_type("array<string>");
-
-	// Create the array object
-	CScriptArray* array = CScriptArray::Create(arrayType);
-
-	#if defined(_WIN32)
-	// Windows uses UTF16 so it is necessary to convert the string
-	wchar_t bufUTF16[1024];
-	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, bufUTF16, 1024);
-
-	WIN32_FIND_DATAW ffd;
-	HANDLE hFind = FindFirstFileExW(bufUTF16, FindExInfoStandard, &ffd, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
-	if (INVALID_HANDLE_VALUE == hFind)
-		return array;
-
-	do {
-		// Skip files
-		if (!(ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
-			continue;
-
-		// Convert the file name back to UTF8
-		char bufUTF8[1024];
-		WideCharToMultiByte(CP_UTF8, 0, ffd.cFileName, -1, bufUTF8, 1024, 0, 0);
-
-		if (strcmp(bufUTF8, ".") == 0 || strcmp(bufUTF8, "..") == 0)
-			continue;
-
-		// Add the dir to the array
-		array->Resize(array->GetSize() + 1);
-		((string*)(array->At(array->GetSize() - 1)))->assign(bufUTF8);
-	} while (FindNextFileW(hFind, &ffd) != 0);
-
-	FindClose(hFind);
-	#else
-	int wildcard = path.rfind('/');
-	if (wildcard == std::string::npos) wildcard = path.rfind('\\');
-	string currentPath = path;
-	string Wildcard = "*";
-	if (wildcard != std::string::npos) {
-		currentPath = path.substr(0, wildcard + 1);
-		Wildcard = path.substr(wildcard + 1);
-	} else {
-		currentPath = "./";
-		Wildcard = path;
-	}
-	dirent* ent = 0;
-	DIR* dir = opendir(currentPath.c_str());
-	if (!dir) return array;
-	while ((ent = readdir(dir)) != NULL) {
-		const string filename = ent->d_name;
-
-		// Skip . and ..
-		if (filename[0] == '.')
-			continue;
-
-		// Skip files
-		string fullname = currentPath + filename;
-		struct stat st;
-		if (stat(fullname.c_str(), &st) == -1)
-			continue;
-		if ((st.st_mode & S_IFDIR) == 0)
-			continue;
-
-		// wildcard matching
-		if (!FNMatch(filename, Wildcard)) continue;
-
-		// Add the dir to the array
-		array->Resize(array->GetSize() + 1);
-		((string*)(array->At(array->GetSize() - 1)))->assign(filename);
-	}
-	closedir(dir);
-	#endif
-
-	return array;
+	return find_entries(path, true);
 }
 
 CScriptArray* script_glob(const string& pattern, int options) {
@@ -356,6 +285,212 @@ bool FileTouch(const string& filePath, const Timestamp& newTime) {
 	}
 }
 
+// Walks a directory tree once and keeps the relative path, size, modification time and type of every entry in compact sorted arrays, so that repeated lookups and pattern queries never touch the disk.
+class directory_index : public RefCountedObject {
+	struct entry {
+		string path;
+		Int64 size;
+		Int64 modified; // Microseconds since the epoch
+		bool directory;
+	};
+	string root;
+	string names; // Every relative path back to back, separated by '/' and sorted.
+	vector<UInt32> name_offsets; // count + 1 offsets into names.
+	vector<Int64> sizes, modified_times;
+	vector<UInt8> directories;
+	Int64 total_size;
+	string_view name_at(size_t index) const { return string_view(names).substr(name_offsets[index], name_offsets[index + 1] - name_offsets[index]); }
+	void check_index(asUINT index) const {
+		if (index >= sizes.size()) throw out_of_range("directory_index entry out of range");
+	}
+	// Reads a single directory, appending its entries to found and its subdirectories to pending.
+	static void scan(const string& root, const string& relative, bool skip_hidden, vector<entry>& found, vector<string>& pending) {
+		string prefix = relative.empty()? "" : relative + "/";
+		#ifdef _WIN32
+		std::wstring pattern;
+		UnicodeConverter::convert(root + "/" + prefix + "*", pattern);
+		WIN32_FIND_DATAW ffd;
+		HANDLE hFind = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &ffd, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+		if (hFind == INVALID_HANDLE_VALUE) return;
+		do {
+			if (wcscmp(ffd.cFileName, L".") == 0 || wcscmp(ffd.cFileName, L"..") == 0) continue;
+			if (skip_hidden && (ffd.cFileName[0] == L'.' || (ffd.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN))) continue;
+			string name;
+			UnicodeConverter::convert(ffd.cFileName, name);
+			bool is_directory = ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
+			ULARGE_INTEGER size, time;
+			size.LowPart = ffd.nFileSizeLow;
+			size.HighPart = ffd.nFileSizeHigh;
+			time.LowPart = ffd.ftLastWriteTime.dwLowDateTime;
+			time.HighPart = ffd.ftLastWriteTime.dwHighDateTime;
+			found.push_back({prefix + name, is_directory? 0 : Int64(size.QuadPart), Timestamp::fromFileTimeNP(time.LowPart, time.HighPart).epochMicroseconds(), is_directory});
+			// Reparse points such as junctions are listed but not followed, which keeps link cycles from recursing forever.
+			if (is_directory && !(ffd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) pending.push_back(prefix + name);
+		} while (FindNextFileW(hFind, &ffd) != 0);
+		FindClose(hFind);
+		#else
+		DIR* dir = opendir((root + "/" + prefix).c_str());
+		if (!dir) return;
+		int fd = dirfd(dir);
+		dirent* ent;
+		while ((ent = readdir(dir)) != NULL) {
+			const char* name = ent->d_name;
+			if (name[0] == '.' && (skip_hidden || name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+			struct stat st;
+			if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == -1) continue;
+			bool link = S_ISLNK(st.st_mode);
+			// Symbolic links report their target, but linked directories are not descended into so that cycles can't recurse forever.
+			if (link && fstatat(fd, name, &st, 0) == -1) continue;
+			bool is_directory = S_ISDIR(st.st_mode);
+			found.push_back({prefix + name, is_directory? 0 : Int64(st.st_size), Int64(st.st_mtime) * 1000000, is_directory});
+			if (is_directory && !link) pending.push_back(prefix + name);
+		}
+		closedir(dir);
+		#endif
+	}
+public:
+	directory_index() : total_size(0) {}
+	bool build(const string& path, unsigned int thread_count, bool skip_hidden) {
+		clear();
+		if (!DirectoryExists(path)) return false;
+		root = path;
+		while (root.size() > 1 && (root.back() == '/' || root.back() == '\\')) root.pop_back();
+		if (!thread_count) thread_count = max(1u, std::thread::hardware_concurrency());
+		vector<entry> found;
+		vector<string> pending = {""};
+		if (thread_count < 2) {
+			while (!pending.empty()) {
+				string relative = move(pending.back());
+				pending.pop_back();
+				scan(root, relative, skip_hidden, found, pending);
+			}
+		} else {
+			// Workers share one stack of directories still to be read, each collecting entries separately until the stack is empty and nobody is still scanning something that could add to it.
+			std::mutex lock;
+			std::condition_variable cv;
+			unsigned int busy = 0;
+			vector<vector<entry>> results(thread_count);
+			auto worker = [&](unsigned int id) {
+				vector<string> discovered;
+				std::unique_lock<std::mutex> guard(lock);
+				while (true) {
+					cv.wait(guard, [&] { return !pending.empty() || busy == 0; });
+					if (pending.empty()) break;
+					string relative = move(pending.back());
+					pending.pop_back();
+					busy++;
+					guard.unlock();
+					scan(root, relative, skip_hidden, results[id], discovered);
+					guard.lock();
+					busy--;
+					for (string& d : discovered) pending.push_back(move(d));
+					discovered.clear();
+					cv.notify_all();
+				}
+			};
+			vector<std::thread> threads;
+			for (unsigned int i = 1; i < thread_count; i++) {
+				try { threads.emplace_back(worker, i); }
+				catch (std::system_error&) { break; }
+			}
+			worker(0);
+			for (std::thread& t : threads) t.join();
+			size_t count = 0;
+			for (const auto& r : results) count += r.size();
+			found.reserve(count);
+			for (auto& r : results) move(r.begin(), r.end(), back_inserter(found));
+		}
+		sort(found.begin(), found.end(), [](const entry& a, const entry& b) { return a.path < b.path; });
+		size_t name_bytes = 0;
+		for (const entry& e : found) name_bytes += e.path.size();
+		names.reserve(name_bytes);
+		name_offsets.reserve(found.size() + 1);
+		sizes.reserve(found.size());
+		modified_times.reserve(found.size());
+		directories.reserve(found.size());
+		name_offsets.push_back(0);
+		for (const entry& e : found) {
+			names += e.path;
+			name_offsets.push_back(names.size());
+			sizes.push_back(e.size);
+			modified_times.push_back(e.modified);
+			directories.push_back(e.directory);
+			total_size += e.size;
+		}
+		return true;
+	}
+	void clear() {
+		root.clear();
+		names.clear();
+		names.shrink_to_fit();
+		name_offsets.clear();
+		sizes.clear();
+		modified_times.clear();
+		directories.clear();
+		total_size = 0;
+	}
+	const string& get_root() const { return root; }
+	asUINT get_count() const { return sizes.size(); }
+	Int64 get_total_size() const { return total_size; }
+	string get_path(asUINT index) const {
+		check_index(index);
+		return string(name_at(index));
+	}
+	Int64 get_size(asUINT index) const {
+		check_index(index);
+		return sizes[index];
+	}
+	Timestamp get_modified(asUINT index) const {
+		check_index(index);
+		return Timestamp(modified_times[index]);
+	}
+	bool is_directory(asUINT index) const {
+		check_index(index);
+		return directories[index];
+	}
+	// Binary searches for the first entry not less than the given path.
+	size_t lower_bound(string_view path) const {
+		size_t low = 0, high = sizes.size();
+		while (low < high) {
+			size_t mid = (low + high) / 2;
+			if (name_at(mid) < path) low = mid + 1;
+			else high = mid;
+		}
+		return low;
+	}
+	int find(const string& path) const {
+		size_t index = lower_bound(path);
+		return index < sizes.size() && name_at(index) == path? int(index) : -1;
+	}
+	CScriptArray* list(const string& prefix, bool files, bool dirs) const {
+		CScriptArray* array = CScriptArray::Create(get_array_type("array<string>"));
+		for (size_t i = lower_bound(prefix); i < sizes.size(); i++) {
+			string_view name = name_at(i);
+			if (name.substr(0, prefix.size()) != prefix) break;
+			if (directories[i]? !dirs : !files) continue;
+			string copy(name);
+			array->InsertLast(&copy);
+		}
+		return array;
+	}
+	CScriptArray* glob(const string& pattern, bool files, bool dirs, int options) const {
+		CScriptArray* array = CScriptArray::Create(get_array_type("array<string>"));
+		Glob matcher(pattern, options);
+		// Everything before the first wildcard must match literally, so only the sorted range sharing that prefix needs testing.
+		string prefix;
+		if (!(options & Glob::GLOB_CASELESS)) prefix = pattern.substr(0, pattern.find_first_of("*?[{\\"));
+		for (size_t i = lower_bound(prefix); i < sizes.size(); i++) {
+			string_view name = name_at(i);
+			if (name.substr(0, prefix.size()) != prefix) break;
+			if (directories[i]? !dirs : !files) continue;
+			string copy(name);
+			if (matcher.match(copy)) array->InsertLast(&copy);
+		}
+		return array;
+	}
+};
+directory_index* directory_index_factory() { return new directory_index(); }
+
 void RegisterScriptFileSystemFunctions(asIScriptEngine* engine) {
 	engine->RegisterEnum("glob_options");
 	engine->RegisterEnumValue("glob_options", "GLOB_DEFAULT", Glob::GLOB_DEFAULT);
@@ -381,5 +516,21 @@ void RegisterScriptFileSystemFunctions(asIScriptEngine* engine) {
 	engine->RegisterGlobalFunction("string DIRECTORY_PREFERENCES(const string&in company_name, const string&in application_name)", asFUNCTION(get_preferences_path), asCALL_CDECL);
 	engine->RegisterGlobalFunction("string file_get_contents(const string&in filename)", asFUNCTION(file_get_contents), asCALL_CDECL);
 	engine->RegisterGlobalFunction("bool file_put_contents(const string&in filename, const string&in contents, bool append = false)", asFUNCTION(file_put_contents), asCALL_CDECL);
+	engine->RegisterObjectType("directory_index", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("directory_index", asBEHAVE_FACTORY, "directory_index@ f()", asFUNCTION(directory_index_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("directory_index", asBEHAVE_ADDREF, "void f()", asMETHODPR(directory_index, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("directory_index", asBEHAVE_RELEASE, "void f()", asMETHODPR(directory_index, release, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "bool build(const string&in path, uint thread_count = 1, bool skip_hidden = false)", asMETHOD(directory_index, build), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "void clear()", asMETHOD(directory_index, clear), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "const string& get_root() const property", asMETHOD(directory_index, get_root), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "uint get_count() const property", asMETHOD(directory_index, get_count), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "int64 get_total_size() const property", asMETHOD(directory_index, get_total_size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "string get_path(uint index) const", asMETHOD(directory_index, get_path), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "int64 get_size(uint index) const", asMETHOD(directory_index, get_size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "timestamp get_modified(uint index) const", asMETHOD(directory_index, get_modified), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "bool is_directory(uint index) const", asMETHOD(directory_index, is_directory), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "int find(const string&in path) const", asMETHOD(directory_index, find), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "string[]@ list(const string&in prefix = \"\", bool files = true, bool directories = false) const", asMETHOD(directory_index, list), asCALL_THISCALL);
+	engine->RegisterObjectMethod("directory_index", "string[]@ glob(const string&in pattern, bool files = true, bool directories = false, glob_options options = GLOB_DEFAULT) const", asMETHOD(directory_index, glob), asCALL_THISCALL);
 	engine->RegisterGlobalFunction("bool file_touch(const string& in path, const timestamp& in new_time = timestamp())", asFUNCTION(FileTouch), asCALL_CDECL);
 }
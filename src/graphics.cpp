@@ -10,6 +10,7 @@
  * 3. This notice may not be removed or altered from any source distribution.
 */
 
+#include <atomic>
 #include "graphics.h"
 #include "UI.h"
 #include "nvgt_plugin.h"
@@ -17,7 +18,8 @@ std::string get_font_path(const std::string& name); // defined in xplatform.cpp
 
 // graphic
 
-graphic::graphic(SDL_Surface* surface) : _surface(surface), _refcount(1) {}
+static std::atomic<unsigned long long> g_graphic_id(0);
+graphic::graphic(SDL_Surface* surface) : _surface(surface), _refcount(1), _id(++g_graphic_id), _version(0) {}
 
 graphic::~graphic() {
 	SDL_DestroySurface(_surface);
@@ -216,17 +218,27 @@ std::string font_tag_to_string(unsigned int tag) {
 
 // graphics_renderer
 
-graphics_renderer::graphics_renderer() : _renderer(nullptr), _refcount(1) {
+// Cached textures and text objects that go this many presents without being drawn are released.
+static const unsigned int renderer_cache_max_age = 120;
+// Past this many cached text objects, anything not drawn during the current frame is released immediately so that constantly changing strings can't grow the cache without bound.
+static const unsigned int renderer_text_cache_limit = 512;
+
+graphics_renderer::graphics_renderer() : _renderer(nullptr), _text_engine(nullptr), _frame(0), _refcount(1) {
 	// Default renderer attaches to whichever window SDL currently considers the focused one, if any.
 	SDL_Window* win = SDL_GetKeyboardFocus();
 	if (win) _renderer = SDL_CreateRenderer(win, nullptr);
 }
 
-graphics_renderer::graphics_renderer(game_window* window) : _renderer(nullptr), _refcount(1) {
+graphics_renderer::graphics_renderer(game_window* window) : _renderer(nullptr), _text_engine(nullptr), _frame(0), _refcount(1) {
 	if (window) _renderer = SDL_CreateRenderer(window->get_sdl_window(), nullptr);
 }
 
 graphics_renderer::~graphics_renderer() {
+	clear_caches();
+	if (_text_engine) {
+		TTF_DestroyRendererTextEngine(_text_engine);
+		_text_engine = nullptr;
+	}
 	if (_renderer) {
 		SDL_DestroyRenderer(_renderer);
 		_renderer = nullptr;
@@ -278,25 +290,109 @@ bool graphics_renderer::fill_rect(float x, float y, float w, float h) {
 	return SDL_RenderFillRect(_renderer, &r);
 }
 
+bool graphics_renderer::present() {
+	bool ok = SDL_RenderPresent(_renderer);
+	_frame++;
+	if (_frame % 60 == 0) evict_cache(renderer_cache_max_age);
+	return ok;
+}
+
+void graphics_renderer::evict_cache(unsigned int max_age) {
+	for (auto it = _texture_cache.begin(); it != _texture_cache.end();) {
+		if (_frame - it->second.last_used < max_age) {
+			++it;
+			continue;
+		}
+		SDL_DestroyTexture(it->second.texture);
+		it = _texture_cache.erase(it);
+	}
+	for (auto it = _text_cache.begin(); it != _text_cache.end();) {
+		if (_frame - it->second.last_used < max_age) {
+			++it;
+			continue;
+		}
+		TTF_DestroyText(it->second.text);
+		it->second.font->release();
+		it = _text_cache.erase(it);
+	}
+}
+
+void graphics_renderer::clear_caches() {
+	for (auto& i : _texture_cache) SDL_DestroyTexture(i.second.texture);
+	_texture_cache.clear();
+	for (auto& i : _text_cache) {
+		TTF_DestroyText(i.second.text);
+		i.second.font->release();
+	}
+	_text_cache.clear();
+}
+
+SDL_Texture* graphics_renderer::get_cached_texture(graphic* gfx) {
+	SDL_Surface* surface = gfx->get_surface();
+	auto it = _texture_cache.find(gfx->get_id());
+	if (it != _texture_cache.end() && it->second.version != gfx->get_version()) {
+		SDL_DestroyTexture(it->second.texture);
+		_texture_cache.erase(it);
+		it = _texture_cache.end();
+	}
+	if (it == _texture_cache.end()) {
+		SDL_Texture* tex = SDL_CreateTextureFromSurface(_renderer, surface);
+		if (!tex) return nullptr;
+		it = _texture_cache.emplace(gfx->get_id(), cached_texture {tex, gfx->get_version(), _frame}).first;
+	}
+	it->second.last_used = _frame;
+	// Color, alpha and blend modes are cheap texture state rather than pixel data, so they are resynced on every draw instead of forcing a reupload.
+	Uint8 r = 255, g = 255, b = 255, a = 255;
+	SDL_BlendMode mode = SDL_BLENDMODE_BLEND;
+	SDL_GetSurfaceColorMod(surface, &r, &g, &b);
+	SDL_GetSurfaceAlphaMod(surface, &a);
+	SDL_GetSurfaceBlendMode(surface, &mode);
+	SDL_SetTextureColorMod(it->second.texture, r, g, b);
+	SDL_SetTextureAlphaMod(it->second.texture, a);
+	SDL_SetTextureBlendMode(it->second.texture, mode);
+	return it->second.texture;
+}
+
 bool graphics_renderer::render_graphic(graphic* gfx, float dst_x, float dst_y) {
 	if (!gfx || !gfx->get_surface()) return false;
-	SDL_Texture* tex = SDL_CreateTextureFromSurface(_renderer, gfx->get_surface());
+	SDL_Texture* tex = get_cached_texture(gfx);
 	if (!tex) return false;
 	SDL_FRect dst = {dst_x, dst_y, (float)gfx->get_width(), (float)gfx->get_height()};
-	bool ok = SDL_RenderTexture(_renderer, tex, nullptr, &dst);
-	SDL_DestroyTexture(tex);
-	return ok;
+	return SDL_RenderTexture(_renderer, tex, nullptr, &dst);
 }
 
 bool graphics_renderer::render_graphic_ex(graphic* gfx, float src_x, float src_y, float src_w, float src_h, float dst_x, float dst_y, float dst_w, float dst_h) {
 	if (!gfx || !gfx->get_surface()) return false;
-	SDL_Texture* tex = SDL_CreateTextureFromSurface(_renderer, gfx->get_surface());
+	SDL_Texture* tex = get_cached_texture(gfx);
 	if (!tex) return false;
 	SDL_FRect src = {src_x, src_y, src_w, src_h};
 	SDL_FRect dst = {dst_x, dst_y, dst_w, dst_h};
-	bool ok = SDL_RenderTexture(_renderer, tex, &src, &dst);
-	SDL_DestroyTexture(tex);
-	return ok;
+	return SDL_RenderTexture(_renderer, tex, &src, &dst);
+}
+
+bool graphics_renderer::draw_text(text_font* font, const std::string& text, float x, float y, unsigned int r, unsigned int g, unsigned int b, unsigned int a, int wrap_width) {
+	if (!_renderer || !font || !font->get_ttf_font()) return false;
+	if (text.empty()) return true;
+	if (!_text_engine) {
+		_text_engine = TTF_CreateRendererTextEngine(_renderer);
+		if (!_text_engine) return false;
+	}
+	// The cache holds a reference to every font it keys on, so a font pointer can't be reused by another font while its entries exist.
+	std::string key(reinterpret_cast<const char*>(&font), sizeof(font));
+	key.append(reinterpret_cast<const char*>(&wrap_width), sizeof(wrap_width));
+	key += text;
+	auto it = _text_cache.find(key);
+	if (it == _text_cache.end()) {
+		if (_text_cache.size() >= renderer_text_cache_limit) evict_cache(1);
+		TTF_Text* t = TTF_CreateText(_text_engine, font->get_ttf_font(), text.c_str(), text.size());
+		if (!t) return false;
+		if (wrap_width > 0) TTF_SetTextWrapWidth(t, wrap_width);
+		font->duplicate();
+		it = _text_cache.emplace(key, cached_text {t, font, _frame}).first;
+	}
+	it->second.last_used = _frame;
+	TTF_SetTextColor(it->second.text, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)a);
+	return TTF_DrawRendererText(it->second.text, x, y);
 }
 
 graphics_texture* graphics_renderer::create_texture(graphic* gfx) {
@@ -430,6 +526,7 @@ void RegisterGraphics(asIScriptEngine* engine) {
 	engine->RegisterObjectMethod("graphic", "bool get_is_valid() const property", asMETHOD(graphic, is_valid), asCALL_THISCALL);
 	engine->RegisterObjectMethod("graphic", "bool lock()", asMETHOD(graphic, lock), asCALL_THISCALL);
 	engine->RegisterObjectMethod("graphic", "void unlock()", asMETHOD(graphic, unlock), asCALL_THISCALL);
+	engine->RegisterObjectMethod("graphic", "void invalidate()", asMETHOD(graphic, invalidate), asCALL_THISCALL);
 	engine->RegisterObjectMethod("graphic", "bool save_bmp(const string&in file) const", asMETHOD(graphic, save_bmp), asCALL_THISCALL);
 	engine->RegisterObjectMethod("graphic", "bool save_png(const string&in file) const", asMETHOD(graphic, save_png), asCALL_THISCALL);
 	engine->RegisterObjectMethod("graphic", "bool set_rle(bool enabled)", asMETHOD(graphic, set_rle), asCALL_THISCALL);
@@ -555,6 +652,10 @@ void RegisterGraphics(asIScriptEngine* engine) {
 	engine->RegisterObjectMethod("graphics_renderer", "bool get_current_output_size(int&out w, int&out h) const", asMETHOD(graphics_renderer, get_current_output_size), asCALL_THISCALL);
 	engine->RegisterObjectMethod("graphics_renderer", "bool render_graphic(graphic@+ gfx, float dst_x, float dst_y)", asMETHOD(graphics_renderer, render_graphic), asCALL_THISCALL);
 	engine->RegisterObjectMethod("graphics_renderer", "bool render_graphic(graphic@+ gfx, float src_x, float src_y, float src_w, float src_h, float dst_x, float dst_y, float dst_w, float dst_h)", asMETHOD(graphics_renderer, render_graphic_ex), asCALL_THISCALL);
+	engine->RegisterObjectMethod("graphics_renderer", "bool draw_text(text_font@+ font, const string&in text, float x, float y, uint r, uint g, uint b, uint a = 255, int wrap_width = 0)", asMETHOD(graphics_renderer, draw_text), asCALL_THISCALL);
+	engine->RegisterObjectMethod("graphics_renderer", "void clear_caches()", asMETHOD(graphics_renderer, clear_caches), asCALL_THISCALL);
+	engine->RegisterObjectMethod("graphics_renderer", "uint get_cached_texture_count() const property", asMETHOD(graphics_renderer, get_cached_texture_count), asCALL_THISCALL);
+	engine->RegisterObjectMethod("graphics_renderer", "uint get_cached_text_count() const property", asMETHOD(graphics_renderer, get_cached_text_count), asCALL_THISCALL);
 	engine->RegisterObjectMethod("graphics_renderer", "graphics_texture@ create_texture(graphic@+ gfx)", asMETHOD(graphics_renderer, create_texture), asCALL_THISCALL);
 	engine->RegisterObjectMethod("graphics_renderer", "bool render_texture(graphics_texture@+ tex, float dst_x, float dst_y)", asMETHOD(graphics_renderer, render_texture), asCALL_THISCALL);
 	engine->RegisterObjectMethod("graphics_renderer", "bool render_texture(graphics_texture@+ tex, float src_x, float src_y, float src_w, float src_h, float dst_x, float dst_y, float dst_w, float dst_h)", asMETHOD(graphics_renderer, render_texture_ex), asCALL_THISCALL);
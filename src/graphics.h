@@ -28,6 +28,8 @@ inline SDL_Color to_sdl_color(unsigned int r, unsigned int g, unsigned int b) {
 class graphic {
 	SDL_Surface* _surface;
 	int _refcount;
+	unsigned long long _id; // Never reused, lets renderers key cached textures without holding a reference to the graphic.
+	unsigned int _version; // Bumped whenever the pixels change so that cached textures get reuploaded.
 public:
 	graphic(SDL_Surface* surface);
 	~graphic();
@@ -38,14 +40,17 @@ public:
 	int get_pitch() const { return _surface ? _surface->pitch : 0; }
 	bool is_valid() const { return _surface != nullptr; }
 	bool lock() { return SDL_LockSurface(_surface); }
-	void unlock() { SDL_UnlockSurface(_surface); }
+	void unlock() { SDL_UnlockSurface(_surface); _version++; }
+	void invalidate() { _version++; }
+	unsigned long long get_id() const { return _id; }
+	unsigned int get_version() const { return _version; }
 	bool save_bmp(const std::string& file) const { return SDL_SaveBMP(_surface, file.c_str()); }
 	bool save_png(const std::string& file) const { return SDL_SavePNG(_surface, file.c_str()); }
 	bool set_rle(bool enabled) { return SDL_SetSurfaceRLE(_surface, enabled); }
 	bool set_color_mod(unsigned int r, unsigned int g, unsigned int b) { return SDL_SetSurfaceColorMod(_surface, (Uint8)r, (Uint8)g, (Uint8)b); }
 	bool set_alpha_mod(unsigned int alpha) { return SDL_SetSurfaceAlphaMod(_surface, (Uint8)alpha); }
 	bool set_blend_mode(unsigned int mode) { return SDL_SetSurfaceBlendMode(_surface, (SDL_BlendMode)mode); }
-	bool flip(unsigned int mode) { return SDL_FlipSurface(_surface, (SDL_FlipMode)mode); }
+	bool flip(unsigned int mode) { _version++; return SDL_FlipSurface(_surface, (SDL_FlipMode)mode); }
 	graphic* convert(unsigned int pixel_format) const { SDL_Surface* s = SDL_ConvertSurface(_surface, (SDL_PixelFormat)pixel_format); return s ? new graphic(s) : nullptr; }
 	graphic* duplicate_surface() const { SDL_Surface* s = SDL_DuplicateSurface(_surface); return s ? new graphic(s) : nullptr; }
 	unsigned int get_blend_mode() const;
@@ -90,6 +95,7 @@ public:
 	void duplicate() { asAtomicInc(_refcount); }
 	void release() { if (asAtomicDec(_refcount) < 1) delete this; }
 	unsigned int get_generation() const { return TTF_GetFontGeneration(_font); }
+	TTF_Font* get_ttf_font() const { return _font; }
 	bool add_fallback_font(text_font* font);
 	bool remove_fallback_font(text_font* font);
 	void clear_fallback_fonts();
@@ -148,8 +154,26 @@ unsigned int font_string_to_tag(const std::string& str);
 std::string font_tag_to_string(unsigned int tag);
 
 class graphics_renderer {
+	// Textures uploaded from graphic objects are kept across frames and only recreated when the graphic's version changes. Entries are keyed by graphic id rather than by pointer so that a graphic allocated at the address of a destroyed one never picks up a stale texture, and entries that have not been drawn for a while are dropped in present().
+	struct cached_texture {
+		SDL_Texture* texture;
+		unsigned int version;
+		unsigned int last_used;
+	};
+	// Shaped text objects drawn through SDL_ttf's renderer text engine, which rasterizes glyphs once into atlas textures and then draws whole strings as batched quads.
+	struct cached_text {
+		TTF_Text* text;
+		text_font* font; // Holds a reference so the TTF_Font outlives the text object.
+		unsigned int last_used;
+	};
 	SDL_Renderer* _renderer;
+	TTF_TextEngine* _text_engine;
+	std::unordered_map<unsigned long long, cached_texture> _texture_cache;
+	std::unordered_map<std::string, cached_text> _text_cache;
+	unsigned int _frame;
 	int _refcount;
+	SDL_Texture* get_cached_texture(graphic* gfx);
+	void evict_cache(unsigned int max_age);
 public:
 	graphics_renderer();
 	graphics_renderer(game_window* window);
@@ -159,7 +183,7 @@ public:
 	bool is_valid() const { return _renderer != nullptr; }
 	std::string get_name() const { return from_cstr(SDL_GetRendererName(_renderer)); }
 	bool clear() { return SDL_RenderClear(_renderer); }
-	bool present() { return SDL_RenderPresent(_renderer); }
+	bool present();
 	bool draw_point(float x, float y) { return SDL_RenderPoint(_renderer, x, y); }
 	bool draw_line(float x1, float y1, float x2, float y2) { return SDL_RenderLine(_renderer, x1, y1, x2, y2); }
 	bool set_draw_color(unsigned int r, unsigned int g, unsigned int b, unsigned int a) { return SDL_SetRenderDrawColor(_renderer, (Uint8)r, (Uint8)g, (Uint8)b, (Uint8)a); }
@@ -181,6 +205,10 @@ public:
 	bool fill_rect(float x, float y, float w, float h);
 	bool render_graphic(graphic* gfx, float dst_x, float dst_y);
 	bool render_graphic_ex(graphic* gfx, float src_x, float src_y, float src_w, float src_h, float dst_x, float dst_y, float dst_w, float dst_h);
+	bool draw_text(text_font* font, const std::string& text, float x, float y, unsigned int r, unsigned int g, unsigned int b, unsigned int a = 255, int wrap_width = 0);
+	void clear_caches();
+	unsigned int get_cached_texture_count() const { return (unsigned int)_texture_cache.size(); }
+	unsigned int get_cached_text_count() const { return (unsigned int)_text_cache.size(); }
 	graphics_texture* create_texture(graphic* gfx);
 	bool render_texture(graphics_texture* tex, float dst_x, float dst_y);
 	bool render_texture_ex(graphics_texture* tex, float src_x, float src_y, float src_w, float src_h, float dst_x, float dst_y, float dst_w, float dst_h);
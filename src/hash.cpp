@@ -10,15 +10,31 @@
  * 3. This notice may not be removed or altered from any source distribution.
 */
 
+#include <cstring>
+#include <stdexcept>
 #include <string>
 #include <angelscript.h>
 #include <obfuscate.h>
+#include <openssl/evp.h>
+#include <SDL3/SDL_cpuinfo.h>
 #include <Poco/Checksum.h>
 #include <Poco/HMACEngine.h>
 #include <Poco/MD5Engine.h>
 #include <Poco/SHA1Engine.h>
 #include <Poco/SHA2Engine.h>
 #include "hash.h"
+#if defined(__x86_64__) || defined(_M_X64)
+	#include <nmmintrin.h>
+	#define NVGT_CRC32C_SSE42
+	#ifdef _MSC_VER
+		#define CRC32C_TARGET
+	#else
+		#define CRC32C_TARGET __attribute__((target("sse4.2")))
+	#endif
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+	#include <arm_acle.h>
+	#define NVGT_CRC32C_ARM
+#endif
 std::string md5(const std::string& message, bool binary) {
 	Poco::MD5Engine engine;
 	engine.update(message);
@@ -117,6 +133,249 @@ unsigned int adler32(const std::string& data) {
 	return c.checksum();
 }
 
+// CRC32C (Castagnoli), using the SSE4.2 or ARMv8 CRC instructions when available and slicing-by-8 tables otherwise.
+static uint32_t crc32c_table[8][256];
+static bool crc32c_init_tables() {
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; k++) c = c & 1 ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+		crc32c_table[0][i] = c;
+	}
+	for (uint32_t i = 0; i < 256; i++) {
+		for (int t = 1; t < 8; t++) crc32c_table[t][i] = (crc32c_table[t - 1][i] >> 8) ^ crc32c_table[0][crc32c_table[t - 1][i] & 0xff];
+	}
+	return true;
+}
+static uint32_t crc32c_software(uint32_t c, const uint8_t* p, size_t length) {
+	static bool tables_ready = crc32c_init_tables();
+	(void)tables_ready;
+	while (length >= 8) {
+		uint64_t word;
+		memcpy(&word, p, 8);
+		word ^= c;
+		c = crc32c_table[7][word & 0xff] ^ crc32c_table[6][(word >> 8) & 0xff] ^ crc32c_table[5][(word >> 16) & 0xff] ^ crc32c_table[4][(word >> 24) & 0xff] ^ crc32c_table[3][(word >> 32) & 0xff] ^ crc32c_table[2][(word >> 40) & 0xff] ^ crc32c_table[1][(word >> 48) & 0xff] ^ crc32c_table[0][word >> 56];
+		p += 8;
+		length -= 8;
+	}
+	while (length--) c = crc32c_table[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+	return c;
+}
+#ifdef NVGT_CRC32C_SSE42
+CRC32C_TARGET static uint32_t crc32c_hardware(uint32_t c, const uint8_t* p, size_t length) {
+	uint64_t c64 = c;
+	while (length >= 8) {
+		uint64_t word;
+		memcpy(&word, p, 8);
+		c64 = _mm_crc32_u64(c64, word);
+		p += 8;
+		length -= 8;
+	}
+	c = (uint32_t)c64;
+	while (length--) c = _mm_crc32_u8(c, *p++);
+	return c;
+}
+#elif defined(NVGT_CRC32C_ARM)
+static uint32_t crc32c_hardware(uint32_t c, const uint8_t* p, size_t length) {
+	while (length >= 8) {
+		uint64_t word;
+		memcpy(&word, p, 8);
+		c = __crc32cd(c, word);
+		p += 8;
+		length -= 8;
+	}
+	while (length--) c = __crc32cb(c, *p++);
+	return c;
+}
+#endif
+uint32_t crc32c(uint32_t crc, const void* data, size_t length) {
+	const uint8_t* p = (const uint8_t*)data;
+	#ifdef NVGT_CRC32C_SSE42
+	static const bool hardware = SDL_HasSSE42();
+	if (hardware) return ~crc32c_hardware(~crc, p, length);
+	#elif defined(NVGT_CRC32C_ARM)
+	return ~crc32c_hardware(~crc, p, length);
+	#endif
+	return ~crc32c_software(~crc, p, length);
+}
+unsigned int crc32c_string(const std::string& data) {
+	return crc32c(0, data.data(), data.size());
+}
+
+// XXH64, a fast non-cryptographic hash suitable for cache keys and content comparison. Produces the same values as the reference xxHash implementation.
+static const uint64_t xxh_prime1 = 0x9E3779B185EBCA87ULL, xxh_prime2 = 0xC2B2AE3D27D4EB4FULL, xxh_prime3 = 0x165667B19E3779F9ULL, xxh_prime4 = 0x85EBCA77C2B2AE63ULL, xxh_prime5 = 0x27D4EB2F165667C5ULL;
+static inline uint64_t xxh_rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+static inline uint64_t xxh_read64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint32_t xxh_read32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+	acc += input * xxh_prime2;
+	acc = xxh_rotl(acc, 31);
+	return acc * xxh_prime1;
+}
+static inline uint64_t xxh_merge_round(uint64_t acc, uint64_t val) {
+	acc ^= xxh_round(0, val);
+	return acc * xxh_prime1 + xxh_prime4;
+}
+static void xxh64_reset(xxh64_state& s, uint64_t seed) {
+	s.v[0] = seed + xxh_prime1 + xxh_prime2;
+	s.v[1] = seed + xxh_prime2;
+	s.v[2] = seed;
+	s.v[3] = seed - xxh_prime1;
+	s.total_length = 0;
+	s.mem_size = 0;
+}
+static void xxh64_update(xxh64_state& s, const uint8_t* p, size_t length) {
+	s.total_length += length;
+	if (s.mem_size + length < 32) {
+		memcpy(s.mem + s.mem_size, p, length);
+		s.mem_size += (uint32_t)length;
+		return;
+	}
+	if (s.mem_size) {
+		size_t fill = 32 - s.mem_size;
+		memcpy(s.mem + s.mem_size, p, fill);
+		for (int i = 0; i < 4; i++) s.v[i] = xxh_round(s.v[i], xxh_read64(s.mem + i * 8));
+		p += fill;
+		length -= fill;
+		s.mem_size = 0;
+	}
+	uint64_t v1 = s.v[0], v2 = s.v[1], v3 = s.v[2], v4 = s.v[3];
+	while (length >= 32) {
+		v1 = xxh_round(v1, xxh_read64(p));
+		v2 = xxh_round(v2, xxh_read64(p + 8));
+		v3 = xxh_round(v3, xxh_read64(p + 16));
+		v4 = xxh_round(v4, xxh_read64(p + 24));
+		p += 32;
+		length -= 32;
+	}
+	s.v[0] = v1; s.v[1] = v2; s.v[2] = v3; s.v[3] = v4;
+	if (length) {
+		memcpy(s.mem, p, length);
+		s.mem_size = (uint32_t)length;
+	}
+}
+static uint64_t xxh64_digest(const xxh64_state& s) {
+	uint64_t h;
+	if (s.total_length >= 32) {
+		h = xxh_rotl(s.v[0], 1) + xxh_rotl(s.v[1], 7) + xxh_rotl(s.v[2], 12) + xxh_rotl(s.v[3], 18);
+		for (int i = 0; i < 4; i++) h = xxh_merge_round(h, s.v[i]);
+	} else h = s.v[2] + xxh_prime5;
+	h += s.total_length;
+	const uint8_t* p = s.mem;
+	uint32_t length = s.mem_size;
+	while (length >= 8) {
+		h ^= xxh_round(0, xxh_read64(p));
+		h = xxh_rotl(h, 27) * xxh_prime1 + xxh_prime4;
+		p += 8;
+		length -= 8;
+	}
+	if (length >= 4) {
+		h ^= uint64_t(xxh_read32(p)) * xxh_prime1;
+		h = xxh_rotl(h, 23) * xxh_prime2 + xxh_prime3;
+		p += 4;
+		length -= 4;
+	}
+	while (length--) {
+		h ^= (*p++) * xxh_prime5;
+		h = xxh_rotl(h, 11) * xxh_prime1;
+	}
+	h ^= h >> 33;
+	h *= xxh_prime2;
+	h ^= h >> 29;
+	h *= xxh_prime3;
+	h ^= h >> 32;
+	return h;
+}
+uint64_t xxhash64(const void* data, size_t length, uint64_t seed) {
+	xxh64_state s;
+	xxh64_reset(s, seed);
+	xxh64_update(s, (const uint8_t*)data, length);
+	return xxh64_digest(s);
+}
+uint64_t xxhash64_string(const std::string& data, uint64_t seed) {
+	return xxhash64(data.data(), data.size(), seed);
+}
+
+// hasher
+static const EVP_MD* hasher_md(hash_algorithm algorithm) {
+	switch (algorithm) {
+		case HASH_MD5: return EVP_md5();
+		case HASH_SHA1: return EVP_sha1();
+		case HASH_SHA224: return EVP_sha224();
+		case HASH_SHA256: return EVP_sha256();
+		case HASH_SHA384: return EVP_sha384();
+		case HASH_SHA512: return EVP_sha512();
+		default: return nullptr;
+	}
+}
+hasher::hasher(hash_algorithm algorithm, uint64_t seed) : algorithm(algorithm), seed(seed), bytes_processed(0), md(nullptr), checksum(algorithm == HASH_ADLER32 ? Poco::Checksum::TYPE_ADLER32 : Poco::Checksum::TYPE_CRC32), crc32c_value(0), refcount(1) {
+	if (algorithm < 0 || algorithm >= HASH_ALGORITHM_COUNT)
+		throw std::invalid_argument("Unknown hash algorithm.");
+	if (hasher_md(algorithm)) {
+		md = EVP_MD_CTX_new();
+		if (!md) throw std::runtime_error("Unable to create digest context.");
+	}
+	reset();
+}
+hasher::~hasher() {
+	if (md) EVP_MD_CTX_free(md);
+}
+void hasher::reset() {
+	bytes_processed = 0;
+	if (md) EVP_DigestInit_ex(md, hasher_md(algorithm), nullptr);
+	checksum = Poco::Checksum(algorithm == HASH_ADLER32 ? Poco::Checksum::TYPE_ADLER32 : Poco::Checksum::TYPE_CRC32);
+	crc32c_value = 0;
+	xxh64_reset(xxh, seed);
+}
+unsigned int hasher::get_digest_size() const {
+	if (md) return EVP_MD_size(hasher_md(algorithm));
+	return algorithm == HASH_XXH64 ? 8 : 4;
+}
+void hasher::update(const void* data, size_t length) {
+	if (!length) return;
+	bytes_processed += length;
+	if (md) EVP_DigestUpdate(md, data, length);
+	else if (algorithm == HASH_CRC32 || algorithm == HASH_ADLER32) {
+		// Poco::Checksum takes 32 bit lengths.
+		const char* p = (const char*)data;
+		while (length) {
+			unsigned int block = length > 0x40000000 ? 0x40000000 : (unsigned int)length;
+			checksum.update(p, block);
+			p += block;
+			length -= block;
+		}
+	} else if (algorithm == HASH_CRC32C) crc32c_value = crc32c(crc32c_value, data, length);
+	else if (algorithm == HASH_XXH64) xxh64_update(xxh, (const uint8_t*)data, length);
+}
+uint64_t hasher::get_value() const {
+	switch (algorithm) {
+		case HASH_CRC32: case HASH_ADLER32: return bytes_processed ? checksum.checksum() : 0; // Matches crc32() and adler32() which return 0 for empty input.
+		case HASH_CRC32C: return crc32c_value;
+		case HASH_XXH64: return xxh64_digest(xxh);
+		default: return 0;
+	}
+}
+std::string hasher::digest(bool binary) const {
+	Poco::DigestEngine::Digest d;
+	if (md) {
+		// Finalizing a copy leaves this context free to keep accepting data.
+		EVP_MD_CTX* copy = EVP_MD_CTX_new();
+		unsigned char buf[EVP_MAX_MD_SIZE];
+		unsigned int size = 0;
+		if (copy && EVP_MD_CTX_copy_ex(copy, md) && EVP_DigestFinal_ex(copy, buf, &size))
+			d.assign(buf, buf + size);
+		EVP_MD_CTX_free(copy);
+	} else {
+		// Integer results are output big endian, the canonical byte order for both CRCs and xxHash.
+		uint64_t value = get_value();
+		for (int i = get_digest_size() - 1; i >= 0; i--) d.push_back((value >> (i * 8)) & 0xff);
+	}
+	if (binary)
+		return std::string((const char*)d.data(), d.size());
+	return Poco::DigestEngine::digestToHex(d);
+}
+static hasher* hasher_factory(hash_algorithm algorithm, uint64_t seed) { return new hasher(algorithm, seed); }
+static void hasher_update(hasher* h, const std::string& data) { h->update(data); }
+
 // the following checksum_stream code written by caturria:
 checksum_ostreambuf::checksum_ostreambuf(std::ostream& sink)
 	: BasicBufferedStreamBuf(4096, std::ios_base::out),
@@ -183,6 +442,68 @@ uint32_t checksum_istream::get_checksum() {
 	return buf->get_checksum();
 }
 
+// hashing_reader and hashing_writer
+hashing_ostreambuf::hashing_ostreambuf(std::ostream& sink, hasher* h) : BasicBufferedStreamBuf(4096, std::ios_base::out), h(h), sink(&sink) {
+	if (!h) throw std::invalid_argument("A hasher is required.");
+	h->duplicate();
+}
+hashing_ostreambuf::~hashing_ostreambuf() {
+	h->release();
+}
+int hashing_ostreambuf::writeToDevice(const char* buffer, std::streamsize length) {
+	h->update(buffer, length);
+	sink->write(buffer, length);
+	return sink->good() ? (int)length : -1;
+}
+hashing_ostream::hashing_ostream(std::ostream& sink, hasher* h) : buf(sink, h), basic_ostream(&buf) {
+}
+hashing_ostream::~hashing_ostream() {
+	flush();
+}
+hashing_istreambuf::hashing_istreambuf(std::istream& source, hasher* h) : BasicBufferedStreamBuf(4096, std::ios_base::in), h(h), source(&source) {
+	if (!h) throw std::invalid_argument("A hasher is required.");
+	h->duplicate();
+}
+hashing_istreambuf::~hashing_istreambuf() {
+	h->release();
+}
+int hashing_istreambuf::readFromDevice(char* buffer, std::streamsize length) {
+	if (!source->good())
+		return -1;
+	source->read(buffer, length);
+	int result = (int)source->gcount();
+	h->update(buffer, result);
+	return result ? result : -1;
+}
+hashing_istream::hashing_istream(std::istream& source, hasher* h) : buf(source, h), basic_istream(&buf) {
+}
+
+void RegisterScriptHasher(asIScriptEngine* engine) {
+	engine->RegisterEnum("hash_algorithm");
+	engine->RegisterEnumValue("hash_algorithm", "HASH_MD5", HASH_MD5);
+	engine->RegisterEnumValue("hash_algorithm", "HASH_SHA1", HASH_SHA1);
+	engine->RegisterEnumValue("hash_algorithm", "HASH_SHA224", HASH_SHA224);
+	engine->RegisterEnumValue("hash_algorithm", "HASH_SHA256", HASH_SHA256);
+	engine->RegisterEnumValue("hash_algorithm", "HASH_SHA384", HASH_SHA384);
+	engine->RegisterEnumValue("hash_algorithm", "HASH_SHA512", HASH_SHA512);
+	engine->RegisterEnumValue("hash_algorithm", "HASH_CRC32", HASH_CRC32);
+	engine->RegisterEnumValue("hash_algorithm", "HASH_ADLER32", HASH_ADLER32);
+	engine->RegisterEnumValue("hash_algorithm", "HASH_CRC32C", HASH_CRC32C);
+	engine->RegisterEnumValue("hash_algorithm", "HASH_XXH64", HASH_XXH64);
+	engine->RegisterObjectType("hasher", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("hasher", asBEHAVE_FACTORY, "hasher@ h(hash_algorithm algorithm, uint64 seed = 0)", asFUNCTION(hasher_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("hasher", asBEHAVE_ADDREF, "void f()", asMETHOD(hasher, duplicate), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("hasher", asBEHAVE_RELEASE, "void f()", asMETHOD(hasher, release), asCALL_THISCALL);
+	engine->RegisterObjectMethod("hasher", "hash_algorithm get_algorithm() const property", asMETHOD(hasher, get_algorithm), asCALL_THISCALL);
+	engine->RegisterObjectMethod("hasher", "uint64 get_bytes_processed() const property", asMETHOD(hasher, get_bytes_processed), asCALL_THISCALL);
+	engine->RegisterObjectMethod("hasher", "uint get_digest_size() const property", asMETHOD(hasher, get_digest_size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("hasher", "uint64 get_value() const property", asMETHOD(hasher, get_value), asCALL_THISCALL);
+	engine->RegisterObjectMethod("hasher", "void update(const string&in data)", asFUNCTION(hasher_update), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("hasher", "string digest(bool binary = false) const", asMETHOD(hasher, digest), asCALL_THISCALL);
+	engine->RegisterObjectMethod("hasher", "string finalize(bool binary = false)", asMETHOD(hasher, finalize), asCALL_THISCALL);
+	engine->RegisterObjectMethod("hasher", "void reset()", asMETHOD(hasher, reset), asCALL_THISCALL);
+}
+
 void RegisterScriptHash(asIScriptEngine* engine) {
 	engine->RegisterGlobalFunction(_O("string string_hash_md5(const string& in data, bool binary = false)"), asFUNCTION(md5), asCALL_CDECL);
 	engine->RegisterGlobalFunction(_O("string string_hash_sha1(const string& in data, bool binary = false)"), asFUNCTION(sha1), asCALL_CDECL);
@@ -192,5 +513,7 @@ void RegisterScriptHash(asIScriptEngine* engine) {
 	engine->RegisterGlobalFunction(_O("string string_hash_sha512(const string& in data, bool binary = false)"), asFUNCTION(sha512), asCALL_CDECL);
 	engine->RegisterGlobalFunction(_O("uint crc32(const string& in data)"), asFUNCTION(crc32), asCALL_CDECL);
 	engine->RegisterGlobalFunction(_O("uint adler32(const string& in data)"), asFUNCTION(adler32), asCALL_CDECL);
+	engine->RegisterGlobalFunction(_O("uint crc32c(const string& in data)"), asFUNCTION(crc32c_string), asCALL_CDECL);
+	engine->RegisterGlobalFunction(_O("uint64 xxhash64(const string& in data, uint64 seed = 0)"), asFUNCTION(xxhash64_string), asCALL_CDECL);
 	engine->RegisterGlobalFunction(_O("uint HOTP(const string& in key, uint64 counter, uint digits = 6)"), asFUNCTION(hotp), asCALL_CDECL);
 }
@@ -11,13 +11,16 @@
 */
 
 #pragma once
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <Poco/BufferedStreamBuf.h>
 #include <Poco/Checksum.h>
 std::string sha256(const std::string& message, bool binary);
+uint32_t crc32c(uint32_t crc, const void* data, size_t length); // Pass the previous result (0 to start) to continue a checksum across calls.
+uint64_t xxhash64(const void* data, size_t length, uint64_t seed = 0);
 
-class asIScriptEngine;
+#include <angelscript.h>
 
 /**
  * A simple istream/ ostream pair that passes data through a checksum before writing or returning it provided by Caturria.
@@ -56,5 +59,73 @@ public:
 	uint32_t get_checksum();
 };
 
+enum hash_algorithm { HASH_MD5, HASH_SHA1, HASH_SHA224, HASH_SHA256, HASH_SHA384, HASH_SHA512, HASH_CRC32, HASH_ADLER32, HASH_CRC32C, HASH_XXH64, HASH_ALGORITHM_COUNT };
+struct xxh64_state {
+	uint64_t v[4];
+	uint64_t total_length;
+	uint8_t mem[32];
+	uint32_t mem_size;
+};
+struct evp_md_ctx_st;
+// An incremental hash of any supported algorithm. Cryptographic digests go through OpenSSL which uses SHA extensions where the CPU has them, while the checksums and xxHash are computed here.
+class hasher {
+	hash_algorithm algorithm;
+	uint64_t seed;
+	uint64_t bytes_processed;
+	evp_md_ctx_st* md;
+	Poco::Checksum checksum;
+	uint32_t crc32c_value;
+	xxh64_state xxh;
+	int refcount;
+public:
+	hasher(hash_algorithm algorithm, uint64_t seed = 0);
+	~hasher();
+	void duplicate() { asAtomicInc(refcount); }
+	void release() { if (asAtomicDec(refcount) < 1) delete this; }
+	hash_algorithm get_algorithm() const { return algorithm; }
+	uint64_t get_bytes_processed() const { return bytes_processed; }
+	unsigned int get_digest_size() const;
+	void update(const void* data, size_t length);
+	void update(const std::string& data) { update(data.data(), data.size()); }
+	// Returns the digest of everything hashed so far without disturbing the state, so more data can still be added afterwards.
+	std::string digest(bool binary = false) const;
+	// For the checksum and xxHash algorithms, the digest as an integer.
+	uint64_t get_value() const;
+	std::string finalize(bool binary = false) { std::string d = digest(binary); reset(); return d; }
+	void reset();
+};
+// Passes data through unchanged while feeding it to a hasher, which the stream holds a reference to.
+class hashing_ostreambuf : public Poco::BasicBufferedStreamBuf<char, std::char_traits<char>> {
+	hasher* h;
+	std::ostream* sink;
+public:
+	hashing_ostreambuf(std::ostream& sink, hasher* h);
+	~hashing_ostreambuf();
+	int writeToDevice(const char* buffer, std::streamsize length);
+	hasher* get_hasher() const { return h; }
+};
+class hashing_ostream : public std::ostream {
+	hashing_ostreambuf buf;
+public:
+	hashing_ostream(std::ostream& sink, hasher* h);
+	~hashing_ostream();
+	hasher* get_hasher() const { return buf.get_hasher(); }
+};
+class hashing_istreambuf : public Poco::BasicBufferedStreamBuf<char, std::char_traits<char>> {
+	hasher* h;
+	std::istream* source;
+public:
+	hashing_istreambuf(std::istream& source, hasher* h);
+	~hashing_istreambuf();
+	int readFromDevice(char* buffer, std::streamsize length);
+	hasher* get_hasher() const { return h; }
+};
+class hashing_istream : public std::istream {
+	hashing_istreambuf buf;
+public:
+	hashing_istream(std::istream& source, hasher* h);
+	hasher* get_hasher() const { return buf.get_hasher(); }
+};
 
+void RegisterScriptHasher(asIScriptEngine* engine); // Called while registering datastreams so that hashing_reader and hashing_writer can refer to the hasher type.
 void RegisterScriptHash(asIScriptEngine* engine);
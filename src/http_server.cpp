@@ -0,0 +1,614 @@
+/* http_server.cpp - native multithreaded HTTP and WebSocket server built on Poco::Net::HTTPServer
+ *
+ * NVGT - NonVisual Gaming Toolkit
+ * Copyright (c) 2022-2025 Sam Tupy
+ * https://nvgt.dev
+ * This software is provided "as-is", without any express or implied warranty. In no event will the authors be held liable for any damages arising from the use of this software.
+ * Permission is granted to anyone to use this software for any purpose, including commercial applications, and to alter it and redistribute it freely, subject to the following restrictions:
+ * 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <Poco/DateTime.h>
+#include <Poco/DateTimeFormatter.h>
+#include <Poco/DateTimeFormat.h>
+#include <Poco/DateTimeParser.h>
+#include <Poco/Event.h>
+#include <Poco/Exception.h>
+#include <Poco/File.h>
+#include <Poco/Mutex.h>
+#include <Poco/Path.h>
+#include <Poco/RefCountedObject.h>
+#include <Poco/RWLock.h>
+#include <Poco/StreamCopier.h>
+#include <Poco/String.h>
+#include <Poco/ThreadPool.h>
+#include <Poco/Timestamp.h>
+#include <Poco/URI.h>
+#include <Poco/Net/HTTPRequestHandler.h>
+#include <Poco/Net/HTTPRequestHandlerFactory.h>
+#include <Poco/Net/HTTPServer.h>
+#include <Poco/Net/HTTPServerParams.h>
+#include <Poco/Net/HTTPServerRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <Poco/Net/NetException.h>
+#include <Poco/Net/ServerSocket.h>
+#include <Poco/Net/WebSocket.h>
+#include "http_server.h"
+#include "nvgt.h" // g_ScriptEngine
+#include "nvgt_plugin.h" // pack_interface
+#include "pocostuff.h" // angelscript_refcounted
+#include "version.h"
+
+using namespace std;
+using namespace Poco;
+using namespace Poco::Net;
+
+static const unordered_map<string, string> g_mime_types = {
+	{"html", "text/html; charset=utf-8"}, {"htm", "text/html; charset=utf-8"}, {"css", "text/css; charset=utf-8"}, {"js", "text/javascript; charset=utf-8"}, {"mjs", "text/javascript; charset=utf-8"},
+	{"json", "application/json"}, {"txt", "text/plain; charset=utf-8"}, {"md", "text/markdown; charset=utf-8"}, {"xml", "application/xml"}, {"csv", "text/csv; charset=utf-8"},
+	{"png", "image/png"}, {"jpg", "image/jpeg"}, {"jpeg", "image/jpeg"}, {"gif", "image/gif"}, {"svg", "image/svg+xml"}, {"ico", "image/x-icon"}, {"webp", "image/webp"},
+	{"wav", "audio/wav"}, {"ogg", "audio/ogg"}, {"opus", "audio/ogg"}, {"mp3", "audio/mpeg"}, {"flac", "audio/flac"},
+	{"wasm", "application/wasm"}, {"zip", "application/zip"}, {"pdf", "application/pdf"}, {"woff2", "font/woff2"},
+};
+static const string& mime_type_for(const string& filename) {
+	static const string fallback = "application/octet-stream";
+	size_t dot = filename.rfind('.');
+	if (dot == string::npos) return fallback;
+	auto it = g_mime_types.find(toLower(filename.substr(dot + 1)));
+	return it != g_mime_types.end()? it->second : fallback;
+}
+// Returns the part of path that follows prefix, or false if prefix doesn't cover path on a segment boundary ("/api" matches "/api" and "/api/x" but not "/apix").
+static bool strip_route_prefix(const string& path, const string& prefix, string& remainder) {
+	if (path.compare(0, prefix.size(), prefix) != 0) return false;
+	if (path.size() > prefix.size() && prefix.back() != '/' && path[prefix.size()] != '/') return false;
+	remainder = path.substr(prefix.size());
+	while (!remainder.empty() && remainder[0] == '/') remainder.erase(0, 1);
+	return true;
+}
+static string normalize_route_prefix(const string& prefix) {
+	string result = prefix.empty() || prefix[0] != '/'? "/" + prefix : prefix;
+	while (result.size() > 1 && result.back() == '/') result.pop_back();
+	return result;
+}
+
+// A request handed to the script. The worker thread that received it waits until the script responds or the server's script_timeout passes, so the script may keep a request around and answer it later.
+class http_server_request : public RefCountedObject {
+	friend class http_server;
+	friend class script_request_handler;
+	mutable FastMutex _mutex;
+	Event _done;
+	HTTPRequest* _request; // angelscript_refcounted so that the script can hold on to them.
+	HTTPResponse* _response;
+	string _path, _query, _body, _response_body;
+	SocketAddress _client_address;
+	bool _responded, _abandoned;
+	// Snapshot of _response taken by respond(), which the worker sends. Script may keep modifying the http_response afterwards, which must not race with the worker reading it.
+	vector<pair<string, string>> _response_headers;
+	HTTPResponse::HTTPStatus _response_status;
+	string _response_reason;
+public:
+	http_server_request(const HTTPServerRequest& request, string&& body) : _done(Event::EVENT_MANUALRESET), _body(move(body)), _client_address(request.clientAddress()), _responded(false), _abandoned(false), _response_status(HTTPResponse::HTTP_OK) {
+		_request = angelscript_refcounted_factory<HTTPRequest, const HTTPRequest&>(request);
+		_response = angelscript_refcounted_factory<HTTPResponse>();
+		URI uri(request.getURI());
+		_path = uri.getPath();
+		_query = uri.getRawQuery();
+	}
+	~http_server_request() {
+		angelscript_refcounted_release<HTTPRequest>(_request);
+		angelscript_refcounted_release<HTTPResponse>(_response);
+	}
+	HTTPRequest* get_request() const {
+		angelscript_refcounted_duplicate<HTTPRequest>(_request);
+		return _request;
+	}
+	HTTPResponse* get_response() const {
+		angelscript_refcounted_duplicate<HTTPResponse>(_response);
+		return _response;
+	}
+	const string& get_method() const { return _request->getMethod(); }
+	const string& get_path() const { return _path; }
+	const string& get_query() const { return _query; }
+	const string& get_body() const { return _body; }
+	const SocketAddress& get_client_address() const { return _client_address; }
+	bool respond(int status, const string& body, const string& content_type) {
+		FastMutex::ScopedLock lock(_mutex);
+		if (_responded || _abandoned) return false;
+		_response->setStatusAndReason(HTTPResponse::HTTPStatus(status));
+		if (!content_type.empty()) _response->setContentType(content_type);
+		else if (!_response->has(HTTPMessage::CONTENT_TYPE) && !body.empty()) _response->setContentType("text/plain; charset=utf-8");
+		_response_body = body;
+		for (const auto& header : *_response) {
+			if (icompare(header.first, HTTPMessage::CONTENT_LENGTH) != 0) _response_headers.emplace_back(header.first, header.second);
+		}
+		_response_status = _response->getStatus();
+		_response_reason = _response->getReason();
+		_responded = true;
+		_done.set();
+		return true;
+	}
+	bool is_pending() const {
+		FastMutex::ScopedLock lock(_mutex);
+		return !_responded && !_abandoned;
+	}
+	// Called by the worker, marks the request as no longer answerable. Returns true if the script responded in time.
+	bool close() {
+		FastMutex::ScopedLock lock(_mutex);
+		if (!_responded) _abandoned = true;
+		return _responded;
+	}
+	void abandon() {
+		FastMutex::ScopedLock lock(_mutex);
+		if (!_responded) _abandoned = true;
+		_done.set();
+	}
+};
+
+class http_server : public RefCountedObject {
+	friend class script_request_handler;
+	friend class websocket_handler;
+	friend class request_handler_factory;
+	struct queued_item {
+		asIScriptFunction* callback;
+		http_server_request* request; // Set for plain requests.
+		WebSocket* websocket; // Set along with websocket_request for upgraded connections.
+		HTTPRequest* websocket_request;
+	};
+	struct mount {
+		string directory;
+		const pack_interface* pack; // Immutable copy, safe to read from worker threads.
+		string pack_prefix;
+	};
+	HTTPServer* _server;
+	ThreadPool* _pool;
+	RWLock _routes_lock;
+	map<string, asIScriptFunction*> _routes, _websocket_routes;
+	map<string, mount> _mounts;
+	FastMutex _queue_mutex;
+	deque<queued_item> _queue;
+	set<http_server_request*> _inflight;
+	atomic<bool> _stopping;
+	atomic<unsigned int> _max_threads, _max_queued, _keepalive_timeout, _max_keepalive_requests, _script_timeout, _max_body_size;
+	atomic<bool> _keepalive;
+	atomic<UInt64> _script_requests, _static_requests, _websocket_connections, _timeouts;
+	UInt16 _port;
+	// Finds the callback registered for the longest prefix of path, returned with a reference for the caller.
+	asIScriptFunction* find_route(const map<string, asIScriptFunction*>& routes, const string& path) {
+		ScopedReadRWLock lock(_routes_lock);
+		string remainder;
+		for (auto it = routes.rbegin(); it != routes.rend(); ++it) {
+			if (!strip_route_prefix(path, it->first, remainder)) continue;
+			it->second->AddRef();
+			return it->second;
+		}
+		return nullptr;
+	}
+	void enqueue(const queued_item& item) {
+		FastMutex::ScopedLock lock(_queue_mutex);
+		_queue.push_back(item);
+	}
+	void release_item(queued_item& item) {
+		if (item.callback) item.callback->Release();
+		if (item.request) item.request->release();
+		if (item.websocket) angelscript_refcounted_release<WebSocket>(item.websocket);
+		if (item.websocket_request) angelscript_refcounted_release<HTTPRequest>(item.websocket_request);
+	}
+	void track(http_server_request* r, bool add) {
+		FastMutex::ScopedLock lock(_queue_mutex);
+		if (add) _inflight.insert(r);
+		else _inflight.erase(r);
+	}
+	bool unmount_locked(const string& key) {
+		auto it = _mounts.find(key);
+		if (it == _mounts.end()) return false;
+		if (it->second.pack) it->second.pack->release();
+		_mounts.erase(it);
+		return true;
+	}
+	void clear_routes(map<string, asIScriptFunction*>& routes) {
+		for (auto& r : routes) r.second->Release();
+		routes.clear();
+	}
+public:
+	http_server() : _server(nullptr), _pool(nullptr), _stopping(false), _max_threads(16), _max_queued(256), _keepalive_timeout(10000), _max_keepalive_requests(0), _script_timeout(10000), _max_body_size(1024 * 1024), _keepalive(true), _script_requests(0), _static_requests(0), _websocket_connections(0), _timeouts(0), _port(0) {}
+	~http_server() {
+		stop();
+		ScopedWriteRWLock lock(_routes_lock);
+		clear_routes(_routes);
+		clear_routes(_websocket_routes);
+		for (auto& m : _mounts) {
+			if (m.second.pack) m.second.pack->release();
+		}
+	}
+	void start(UInt16 port, const string& address);
+	void stop() {
+		if (!_server) return;
+		_stopping = true;
+		_server->stopAll(true);
+		{
+			FastMutex::ScopedLock lock(_queue_mutex);
+			for (http_server_request* r : _inflight) r->abandon();
+			for (queued_item& item : _queue) release_item(item);
+			_queue.clear();
+		}
+		_pool->joinAll();
+		delete _server;
+		delete _pool;
+		_server = nullptr;
+		_pool = nullptr;
+		_port = 0;
+		_stopping = false;
+	}
+	bool is_running() const { return _server != nullptr; }
+	UInt16 get_port() const { return _port; }
+	void route(const string& prefix, asIScriptFunction* callback, bool websocket) {
+		ScopedWriteRWLock lock(_routes_lock);
+		map<string, asIScriptFunction*>& routes = websocket? _websocket_routes : _routes;
+		string key = normalize_route_prefix(prefix);
+		auto it = routes.find(key);
+		if (it != routes.end()) {
+			it->second->Release();
+			routes.erase(it);
+		}
+		if (callback) routes[key] = callback;
+	}
+	void route_requests(const string& prefix, asIScriptFunction* callback) { route(prefix, callback, false); }
+	void route_websockets(const string& prefix, asIScriptFunction* callback) { route(prefix, callback, true); }
+	void mount_directory(const string& prefix, const string& directory) {
+		File dir(directory);
+		if (!dir.exists() || !dir.isDirectory()) throw FileNotFoundException(directory);
+		ScopedWriteRWLock lock(_routes_lock);
+		unmount_locked(normalize_route_prefix(prefix));
+		_mounts[normalize_route_prefix(prefix)] = {Path(directory).absolute().toString(), nullptr, ""};
+	}
+	void mount_pack(const string& prefix, pack_interface* p, const string& pack_prefix) {
+		if (!p) throw InvalidArgumentException("mount_pack requires a pack");
+		if (!p->get_is_active()) {
+			p->release();
+			throw InvalidArgumentException("pack is not open");
+		}
+		const pack_interface* immutable = p->make_immutable();
+		p->release();
+		ScopedWriteRWLock lock(_routes_lock);
+		unmount_locked(normalize_route_prefix(prefix));
+		_mounts[normalize_route_prefix(prefix)] = {"", immutable, pack_prefix};
+	}
+	bool unmount(const string& prefix) {
+		ScopedWriteRWLock lock(_routes_lock);
+		return unmount_locked(normalize_route_prefix(prefix));
+	}
+	HTTPRequestHandler* create_static_handler(const HTTPServerRequest& request, const string& path);
+	// Runs the script handlers for everything that has arrived since the last call, on the calling thread.
+	unsigned int poll(unsigned int max_items) {
+		unsigned int handled = 0;
+		while (max_items == 0 || handled < max_items) {
+			queued_item item;
+			{
+				FastMutex::ScopedLock lock(_queue_mutex);
+				if (_queue.empty()) break;
+				item = _queue.front();
+				_queue.pop_front();
+			}
+			handled++;
+			asIScriptContext* ACtx = asGetActiveContext();
+			bool new_context = ACtx == nullptr || ACtx->PushState() < 0;
+			asIScriptContext* ctx = new_context? g_ScriptEngine->RequestContext() : ACtx;
+			int result = asEXECUTION_ERROR;
+			if (ctx && ctx->Prepare(item.callback) >= 0) {
+				if (item.request) ctx->SetArgObject(0, item.request);
+				else {
+					ctx->SetArgObject(0, item.websocket);
+					ctx->SetArgObject(1, item.websocket_request);
+				}
+				result = ctx->Execute();
+			}
+			if (ctx) new_context? g_ScriptEngine->ReturnContext(ctx) : (void)ctx->PopState();
+			if (item.request && result != asEXECUTION_FINISHED) item.request->respond(HTTPResponse::HTTP_INTERNAL_SERVER_ERROR, "request handler failed", "");
+			release_item(item);
+		}
+		return handled;
+	}
+	unsigned int get_queued_requests() {
+		FastMutex::ScopedLock lock(_queue_mutex);
+		return _queue.size();
+	}
+	int get_current_connections() const { return _server? _server->currentConnections() : 0; }
+	int get_queued_connections() const { return _server? _server->queuedConnections() : 0; }
+	int get_total_connections() const { return _server? _server->totalConnections() : 0; }
+	int get_refused_connections() const { return _server? _server->refusedConnections() : 0; }
+	UInt64 get_script_requests() const { return _script_requests; }
+	UInt64 get_static_requests() const { return _static_requests; }
+	UInt64 get_websocket_connections() const { return _websocket_connections; }
+	UInt64 get_timeouts() const { return _timeouts; }
+	unsigned int get_max_threads() const { return _max_threads; }
+	void set_max_threads(unsigned int value) { _max_threads = value < 1? 1 : value; }
+	unsigned int get_max_queued() const { return _max_queued; }
+	void set_max_queued(unsigned int value) { _max_queued = value; }
+	bool get_keepalive() const { return _keepalive; }
+	void set_keepalive(bool value) { _keepalive = value; }
+	unsigned int get_keepalive_timeout() const { return _keepalive_timeout; }
+	void set_keepalive_timeout(unsigned int value) { _keepalive_timeout = value; }
+	unsigned int get_max_keepalive_requests() const { return _max_keepalive_requests; }
+	void set_max_keepalive_requests(unsigned int value) { _max_keepalive_requests = value; }
+	unsigned int get_script_timeout() const { return _script_timeout; }
+	void set_script_timeout(unsigned int value) { _script_timeout = value; }
+	unsigned int get_max_body_size() const { return _max_body_size; }
+	void set_max_body_size(unsigned int value) { _max_body_size = value; }
+};
+
+static void send_error(HTTPServerResponse& response, HTTPResponse::HTTPStatus status) {
+	response.setStatusAndReason(status);
+	response.setContentType("text/plain; charset=utf-8");
+	const string& reason = HTTPResponse::getReasonForStatus(status);
+	response.setContentLength(reason.size());
+	response.send() << reason;
+}
+
+class error_handler : public HTTPRequestHandler {
+	HTTPResponse::HTTPStatus _status;
+public:
+	error_handler(HTTPResponse::HTTPStatus status) : _status(status) {}
+	void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) override { send_error(response, _status); }
+};
+
+// Serves a file from disk or from a pack without involving the script at all.
+class static_handler : public HTTPRequestHandler {
+	string _filename;
+	unique_ptr<istream> _stream;
+	string _content_type;
+	atomic<UInt64>& _counter;
+public:
+	static_handler(const string& filename, istream* stream, const string& content_type, atomic<UInt64>& counter) : _filename(filename), _stream(stream), _content_type(content_type), _counter(counter) {}
+	void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) override {
+		_counter++;
+		bool head = request.getMethod() == HTTPRequest::HTTP_HEAD;
+		if (!_stream) {
+			File f(_filename);
+			Timestamp modified = f.getLastModified();
+			modified = Timestamp::fromEpochTime(modified.epochTime()); // HTTP dates have a resolution of one second.
+			if (request.has("If-Modified-Since")) {
+				try {
+					int tzd;
+					DateTime since = DateTimeParser::parse(DateTimeFormat::HTTP_FORMAT, request.get("If-Modified-Since"), tzd);
+					if (modified <= since.timestamp()) {
+						response.setStatusAndReason(HTTPResponse::HTTP_NOT_MODIFIED);
+						response.send();
+						return;
+					}
+				} catch (Exception&) {} // An unparsable date just means a full response.
+			}
+			if (head) {
+				response.setContentType(_content_type);
+				response.setContentLength64(f.getSize());
+				response.set("Last-Modified", DateTimeFormatter::format(modified, DateTimeFormat::HTTP_FORMAT));
+				response.send();
+			} else response.sendFile(_filename, _content_type);
+			return;
+		}
+		_stream->seekg(0, ios::end);
+		streamoff size = _stream->tellg();
+		_stream->seekg(0, ios::beg);
+		response.setContentType(_content_type);
+		if (size >= 0) response.setContentLength64(size);
+		else response.setChunkedTransferEncoding(true);
+		ostream& out = response.send();
+		if (!head) StreamCopier::copyStream(*_stream, out, 65536);
+	}
+};
+
+// Passes the request to the script through the server's queue and waits for the answer.
+class script_request_handler : public HTTPRequestHandler {
+	http_server* _server;
+	asIScriptFunction* _callback;
+public:
+	script_request_handler(http_server* server, asIScriptFunction* callback) : _server(server), _callback(callback) {}
+	~script_request_handler() {
+		if (_callback) _callback->Release();
+	}
+	void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) override {
+		unsigned int max_body = _server->_max_body_size;
+		if (request.hasContentLength() && request.getContentLength64() > max_body) {
+			send_error(response, HTTPResponse::HTTP_REQUESTENTITYTOOLARGE);
+			return;
+		}
+		string body;
+		char buffer[16384];
+		istream& in = request.stream();
+		while (in) {
+			in.read(buffer, sizeof(buffer));
+			body.append(buffer, in.gcount());
+			if (body.size() > max_body) {
+				response.setKeepAlive(false); // The rest of the body is never read, so the connection can't be reused.
+				send_error(response, HTTPResponse::HTTP_REQUESTENTITYTOOLARGE);
+				return;
+			}
+		}
+		http_server_request* r = new http_server_request(request, move(body));
+		_server->_script_requests++;
+		_server->track(r, true);
+		r->duplicate(); // For the queue.
+		_server->enqueue({_callback, r, nullptr, nullptr});
+		_callback = nullptr; // The queue owns the callback reference now.
+		if (!_server->_stopping) r->_done.tryWait(_server->_script_timeout);
+		bool responded = r->close();
+		_server->track(r, false);
+		if (!responded) {
+			_server->_timeouts++;
+			r->release();
+			send_error(response, HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+			return;
+		}
+		for (const auto& header : r->_response_headers) response.add(header.first, header.second);
+		response.setStatusAndReason(r->_response_status, r->_response_reason);
+		response.setContentLength64(r->_response_body.size());
+		ostream& out = response.send();
+		if (request.getMethod() != HTTPRequest::HTTP_HEAD) out.write(r->_response_body.data(), r->_response_body.size());
+		r->release();
+	}
+};
+
+// Completes the WebSocket handshake on the worker thread, then hands the connection over to the script. The socket is detached from the HTTP session by Poco, so the worker is free again as soon as the handshake is done.
+class websocket_handler : public HTTPRequestHandler {
+	http_server* _server;
+	asIScriptFunction* _callback;
+public:
+	websocket_handler(http_server* server, asIScriptFunction* callback) : _server(server), _callback(callback) {}
+	~websocket_handler() {
+		if (_callback) _callback->Release();
+	}
+	void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response) override {
+		WebSocket* ws = nullptr;
+		try {
+			WebSocket accepted(request, response);
+			ws = angelscript_refcounted_factory<WebSocket, const WebSocket&>(accepted);
+		} catch (WebSocketException&) {
+			if (!response.sent()) send_error(response, HTTPResponse::HTTP_BAD_REQUEST);
+			return;
+		}
+		_server->_websocket_connections++;
+		_server->enqueue({_callback, nullptr, ws, angelscript_refcounted_factory<HTTPRequest, const HTTPRequest&>(request)});
+		_callback = nullptr;
+	}
+};
+
+class request_handler_factory : public HTTPRequestHandlerFactory {
+	http_server* _server;
+public:
+	request_handler_factory(http_server* server) : _server(server) {}
+	HTTPRequestHandler* createRequestHandler(const HTTPServerRequest& request) override {
+		if (_server->_stopping) return new error_handler(HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+		string path;
+		try {
+			path = URI(request.getURI()).getPath();
+		} catch (SyntaxException&) {
+			return new error_handler(HTTPResponse::HTTP_BAD_REQUEST);
+		}
+		if (path.empty()) path = "/";
+		if (request.has("Upgrade") && icompare(request.get("Upgrade"), "websocket") == 0) {
+			asIScriptFunction* callback = _server->find_route(_server->_websocket_routes, path);
+			if (callback) return new websocket_handler(_server, callback);
+			return new error_handler(HTTPResponse::HTTP_NOT_FOUND);
+		}
+		if (request.getMethod() == HTTPRequest::HTTP_GET || request.getMethod() == HTTPRequest::HTTP_HEAD) {
+			HTTPRequestHandler* handler = _server->create_static_handler(request, path);
+			if (handler) return handler;
+		}
+		asIScriptFunction* callback = _server->find_route(_server->_routes, path);
+		if (callback) return new script_request_handler(_server, callback);
+		return new error_handler(HTTPResponse::HTTP_NOT_FOUND);
+	}
+};
+
+HTTPRequestHandler* http_server::create_static_handler(const HTTPServerRequest& request, const string& path) {
+	ScopedReadRWLock lock(_routes_lock);
+	string remainder;
+	for (auto it = _mounts.rbegin(); it != _mounts.rend(); ++it) {
+		if (!strip_route_prefix(path, it->first, remainder)) continue;
+		// Refuse anything that could climb out of the mounted directory.
+		if (remainder.find('\\') != string::npos || remainder == ".." || remainder.find("../") == 0 || remainder.find("/..") != string::npos) return new error_handler(HTTPResponse::HTTP_FORBIDDEN);
+		const mount& m = it->second;
+		if (m.pack) {
+			string name = m.pack_prefix + (remainder.empty() || remainder.back() == '/'? remainder + "index.html" : remainder);
+			istream* stream = m.pack->get_file(name);
+			if (stream) return new static_handler(name, stream, mime_type_for(name), _static_requests);
+			continue;
+		}
+		Path file_path(m.directory, Path::PATH_NATIVE);
+		file_path.makeDirectory();
+		if (!remainder.empty()) file_path.append(Path(remainder, Path::PATH_UNIX));
+		try {
+			File f(file_path);
+			if (f.exists() && f.isDirectory()) {
+				file_path.makeDirectory();
+				file_path.setFileName("index.html");
+				f = File(file_path);
+			}
+			if (f.exists() && f.isFile()) return new static_handler(file_path.toString(), nullptr, mime_type_for(file_path.getFileName()), _static_requests);
+		} catch (Exception&) {}
+	}
+	return nullptr;
+}
+
+void http_server::start(UInt16 port, const string& address) {
+	if (_server) throw IllegalStateException("http_server is already running");
+	ServerSocket socket(SocketAddress(address, port), 128);
+	HTTPServerParams::Ptr params = new HTTPServerParams();
+	params->setServerName(address);
+	params->setSoftwareVersion("nvgt/" + NVGT_VERSION);
+	params->setMaxThreads(_max_threads);
+	params->setMaxQueued(_max_queued);
+	params->setKeepAlive(_keepalive);
+	params->setKeepAliveTimeout(Timespan(Timespan::TimeDiff(_keepalive_timeout) * 1000));
+	params->setMaxKeepAliveRequests(_max_keepalive_requests);
+	unique_ptr<ThreadPool> pool(new ThreadPool("http_server", 1, _max_threads));
+	_server = new HTTPServer(new request_handler_factory(this), *pool, socket, params);
+	_pool = pool.release();
+	_server->start();
+	_port = socket.address().port();
+}
+
+http_server* http_server_factory() { return new http_server(); }
+void RegisterHTTPServer(asIScriptEngine* engine) {
+	engine->RegisterObjectType("http_server_request", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("http_server_request", asBEHAVE_ADDREF, "void f()", asMETHODPR(http_server_request, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("http_server_request", asBEHAVE_RELEASE, "void f()", asMETHODPR(http_server_request, release, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server_request", "http_request@ get_request() const property", asMETHOD(http_server_request, get_request), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server_request", "http_response@ get_response() const property", asMETHOD(http_server_request, get_response), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server_request", "const string& get_method() const property", asMETHOD(http_server_request, get_method), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server_request", "const string& get_path() const property", asMETHOD(http_server_request, get_path), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server_request", "const string& get_query() const property", asMETHOD(http_server_request, get_query), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server_request", "const string& get_body() const property", asMETHOD(http_server_request, get_body), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server_request", "const socket_address& get_client_address() const property", asMETHOD(http_server_request, get_client_address), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server_request", "bool get_pending() const property", asMETHOD(http_server_request, is_pending), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server_request", "bool respond(int status, const string&in body = \"\", const string&in content_type = \"\")", asMETHOD(http_server_request, respond), asCALL_THISCALL);
+	engine->RegisterFuncdef("void http_server_callback(http_server_request@ request)");
+	engine->RegisterFuncdef("void http_server_websocket_callback(web_socket@ socket, http_request@ request)");
+	engine->RegisterObjectType("http_server", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("http_server", asBEHAVE_FACTORY, "http_server@ f()", asFUNCTION(http_server_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("http_server", asBEHAVE_ADDREF, "void f()", asMETHODPR(http_server, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("http_server", asBEHAVE_RELEASE, "void f()", asMETHODPR(http_server, release, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void start(uint16 port, const string&in address = \"0.0.0.0\")", asMETHOD(http_server, start), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void stop()", asMETHOD(http_server, stop), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "bool get_running() const property", asMETHOD(http_server, is_running), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint16 get_port() const property", asMETHOD(http_server, get_port), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void route(const string&in prefix, http_server_callback@ callback)", asMETHOD(http_server, route_requests), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void route_websockets(const string&in prefix, http_server_websocket_callback@ callback)", asMETHOD(http_server, route_websockets), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void mount_directory(const string&in prefix, const string&in directory)", asMETHOD(http_server, mount_directory), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void mount_pack(const string&in prefix, pack_interface@ pack, const string&in pack_prefix = \"\")", asMETHOD(http_server, mount_pack), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "bool unmount(const string&in prefix)", asMETHOD(http_server, unmount), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint poll(uint max_requests = 0)", asMETHOD(http_server, poll), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint get_queued_requests() property", asMETHOD(http_server, get_queued_requests), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "int get_current_connections() const property", asMETHOD(http_server, get_current_connections), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "int get_queued_connections() const property", asMETHOD(http_server, get_queued_connections), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "int get_total_connections() const property", asMETHOD(http_server, get_total_connections), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "int get_refused_connections() const property", asMETHOD(http_server, get_refused_connections), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint64 get_script_requests() const property", asMETHOD(http_server, get_script_requests), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint64 get_static_requests() const property", asMETHOD(http_server, get_static_requests), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint64 get_websocket_connections() const property", asMETHOD(http_server, get_websocket_connections), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint64 get_timeouts() const property", asMETHOD(http_server, get_timeouts), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint get_max_threads() const property", asMETHOD(http_server, get_max_threads), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void set_max_threads(uint value) property", asMETHOD(http_server, set_max_threads), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint get_max_queued() const property", asMETHOD(http_server, get_max_queued), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void set_max_queued(uint value) property", asMETHOD(http_server, set_max_queued), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "bool get_keepalive() const property", asMETHOD(http_server, get_keepalive), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void set_keepalive(bool value) property", asMETHOD(http_server, set_keepalive), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint get_keepalive_timeout() const property", asMETHOD(http_server, get_keepalive_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void set_keepalive_timeout(uint value) property", asMETHOD(http_server, set_keepalive_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint get_max_keepalive_requests() const property", asMETHOD(http_server, get_max_keepalive_requests), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void set_max_keepalive_requests(uint value) property", asMETHOD(http_server, set_max_keepalive_requests), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint get_script_timeout() const property", asMETHOD(http_server, get_script_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void set_script_timeout(uint value) property", asMETHOD(http_server, set_script_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "uint get_max_body_size() const property", asMETHOD(http_server, get_max_body_size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_server", "void set_max_body_size(uint value) property", asMETHOD(http_server, set_max_body_size), asCALL_THISCALL);
+}
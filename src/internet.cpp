@@ -10,21 +10,31 @@
  * 3. This notice may not be removed or altered from any source distribution.
 */
 
+#include <algorithm>
 #include <atomic>
+#include <deque>
+#include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <obfuscate.h>
+#include <Poco/Condition.h>
+#include <Poco/Event.h>
 #include <Poco/Format.h>
+#include <Poco/Mutex.h>
 #include <Poco/NullStream.h>
 #include <Poco/RefCountedObject.h>
 #include <Poco/Runnable.h>
 #include <Poco/StreamCopier.h>
 #include <Poco/SynchronizedObject.h>
 #include <Poco/Thread.h>
+#include <Poco/Timestamp.h>
 #include <Poco/URI.h>
 #include <Poco/URIStreamOpener.h>
 #include <Poco/UUIDGenerator.h>
 #include <Poco/Net/AcceptCertificateHandler.h>
 #include <Poco/Net/Context.h>
+#include <Poco/Net/DatagramSocket.h>
 #include <Poco/Net/DNS.h>
 #include <Poco/Net/FTPClientSession.h>
 #include <Poco/Net/HTTPClientSession.h>
@@ -37,17 +47,25 @@
 #include <Poco/Net/HTTPSStreamFactory.h>
 #include <Poco/Net/HTTPStreamFactory.h>
 #include <Poco/Net/MessageHeader.h>
+#include <Poco/Net/PollSet.h>
+#include <Poco/Net/ServerSocket.h>
 #include <Poco/Net/SSLManager.h>
 #include <Poco/Net/WebSocket.h>
 #include <scriptarray.h>
 #include <scriptdictionary.h>
 #include <entities.h>
 #include "datastreams.h"
+#include "http_server.h"
 #include "internet.h"
 #include "nvgt.h"
 #include "nvgt_angelscript.h"
 #include "pocostuff.h" // angelscript_refcounted
 #include "version.h"
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
 
 using namespace std;
 using namespace Poco;
@@ -556,6 +574,224 @@ void RegisterWebSocket(asIScriptEngine* engine) {
 	engine->RegisterObjectMethod("web_socket", "void set_max_payload_size(int size) property", asMETHOD(WebSocket, setMaxPayloadSize), asCALL_THISCALL);
 	engine->RegisterObjectMethod("web_socket", "int get_max_payload_size() const property", asMETHOD(WebSocket, getMaxPayloadSize), asCALL_THISCALL);
 }
+template <class T> int datagram_socket_send_to(T& sock, const string& data, const SocketAddress& address, int flags) { return sock.sendTo(data.data(), data.size(), address, flags); }
+template <class T> string datagram_socket_receive_from(T& sock, int length, SocketAddress& address, int flags) {
+	if (length <= 0) return "";
+	string result(length, 0);
+	int recv_len = sock.receiveFrom(result.data(), length, address, flags);
+	result.resize(recv_len > 0? recv_len : 0);
+	return result;
+}
+template <class T> void RegisterDatagramSocket(asIScriptEngine* engine, const std::string& type) {
+	RegisterSocket<T>(engine, type);
+	engine->RegisterObjectBehaviour(type.c_str(), asBEHAVE_FACTORY, format("%s@ f(const spec::ip_address_family)", type).c_str(), asFUNCTION((angelscript_refcounted_factory<T, SocketAddress::Family>)), asCALL_CDECL);
+	engine->RegisterObjectBehaviour(type.c_str(), asBEHAVE_FACTORY, format("%s@ f(const socket_address&in address, bool reuse_address = false, bool reuse_port = false, bool IPv6_only = false)", type).c_str(), asFUNCTION((angelscript_refcounted_factory<T, const SocketAddress&, bool, bool, bool>)), asCALL_CDECL);
+	engine->RegisterObjectMethod(type.c_str(), "void connect(const socket_address&in address)", asMETHOD(T, connect), asCALL_THISCALL);
+	engine->RegisterObjectMethod(type.c_str(), "void bind(const socket_address&in address, bool reuse_address = false, bool reuse_port = false)", asMETHODPR(T, bind, (const SocketAddress&, bool, bool), void), asCALL_THISCALL);
+	engine->RegisterObjectMethod(type.c_str(), "int send_bytes(const string&in data, int flags = 0)", asFUNCTION(socket_send_bytes<T>), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "string receive_bytes(int length, int flags = 0)", asFUNCTION(socket_receive_bytes<T>), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "int send_to(const string&in data, const socket_address&in address, int flags = 0)", asFUNCTION(datagram_socket_send_to<T>), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "string receive_from(int length, socket_address&out address, int flags = 0)", asFUNCTION(datagram_socket_receive_from<T>), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "void set_broadcast(bool flag) property", asMETHOD(T, setBroadcast), asCALL_THISCALL);
+	engine->RegisterObjectMethod(type.c_str(), "bool get_broadcast() const property", asMETHOD(T, getBroadcast), asCALL_THISCALL);
+}
+
+template <class T> StreamSocket* server_socket_accept_connection(T& sock) { return angelscript_refcounted_factory<StreamSocket, const StreamSocket&>(sock.acceptConnection()); }
+template <class T> void RegisterServerSocket(asIScriptEngine* engine, const std::string& type) {
+	RegisterSocket<T>(engine, type);
+	engine->RegisterObjectBehaviour(type.c_str(), asBEHAVE_FACTORY, format("%s@ f(const socket_address&in address, int backlog = 64)", type).c_str(), asFUNCTION((angelscript_refcounted_factory<T, const SocketAddress&, int>)), asCALL_CDECL);
+	engine->RegisterObjectMethod(type.c_str(), "void bind(const socket_address&in address, bool reuse_address = false, bool reuse_port = false)", asMETHODPR(T, bind, (const SocketAddress&, bool, bool), void), asCALL_THISCALL);
+	engine->RegisterObjectMethod(type.c_str(), "void listen(int backlog = 64)", asMETHOD(T, listen), asCALL_THISCALL);
+	engine->RegisterObjectMethod(type.c_str(), "stream_socket@ accept_connection()", asFUNCTION(server_socket_accept_connection<T>), asCALL_CDECL_OBJFIRST);
+}
+
+// Readiness notification for many sockets at once. Scripts register any number of socket, stream_socket, server_socket, datagram_socket or web_socket objects and then ask for only those that are ready, rather than polling every socket in turn each frame. On Linux this talks to epoll directly so that a wait doesn't build a map of every ready socket the way Poco's PollSet does; other platforms use PollSet.
+class socket_selector : public RefCountedObject {
+	struct entry {
+		Socket* object; // The script's own handle, which we hold a reference to. Every registered socket type singly inherits from Socket.
+		int mode;
+	};
+	unordered_map<poco_socket_t, entry> _entries;
+	vector<pair<poco_socket_t, int>> _ready;
+	#ifdef __linux__
+	int _epoll_fd;
+	vector<epoll_event> _events;
+	static UInt32 epoll_events_for(int mode) {
+		UInt32 events = 0;
+		if (mode & Socket::SELECT_READ) events |= EPOLLIN | EPOLLRDHUP;
+		if (mode & Socket::SELECT_WRITE) events |= EPOLLOUT;
+		if (mode & Socket::SELECT_ERROR) events |= EPOLLPRI;
+		return events;
+	}
+	#else
+	PollSet _pollset;
+	#endif
+	static poco_socket_t fd_of(const Socket& sock) {
+		if (sock.isNull()) return POCO_INVALID_SOCKET;
+		return sock.impl()->sockfd();
+	}
+	void forget(unordered_map<poco_socket_t, entry>::iterator it) {
+		#ifdef __linux__
+		epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, it->first, nullptr); // Fails harmlessly if the socket was already closed, which removes it from the epoll set on its own.
+		#else
+		try { _pollset.remove(*it->second.object); } catch (Exception&) {}
+		#endif
+		angelscript_refcounted_release<Socket>(it->second.object);
+		_entries.erase(it);
+	}
+	// Sockets closed by the script while registered are dropped here, before their descriptor can be reused by a new socket.
+	void prune_closed() {
+		for (auto it = _entries.begin(); it != _entries.end();) {
+			if (fd_of(*it->second.object) != it->first) {
+				angelscript_refcounted_release<Socket>(it->second.object);
+				#ifndef __linux__
+				try { _pollset.remove(*it->second.object); } catch (Exception&) {}
+				#endif
+				it = _entries.erase(it);
+			} else ++it;
+		}
+	}
+public:
+	socket_selector() {
+		#ifdef __linux__
+		_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (_epoll_fd < 0) throw IOException("unable to create epoll instance", errno);
+		#endif
+	}
+	~socket_selector() {
+		clear();
+		#ifdef __linux__
+		::close(_epoll_fd);
+		#endif
+	}
+	// Handles are passed as @+, so the engine keeps the caller's reference and add() takes its own.
+	void add(Socket* sock, int mode) {
+		if (!sock) throw InvalidArgumentException("cannot add a null socket to a socket_selector");
+		poco_socket_t fd = fd_of(*sock);
+		if (fd == POCO_INVALID_SOCKET) throw InvalidArgumentException("cannot add a closed or uninitialized socket to a socket_selector");
+		if (!(mode & (Socket::SELECT_READ | Socket::SELECT_WRITE | Socket::SELECT_ERROR))) throw InvalidArgumentException("socket_selector mode must contain at least one of SOCKET_SELECT_READ, SOCKET_SELECT_WRITE or SOCKET_SELECT_ERROR");
+		auto it = _entries.find(fd);
+		if (it != _entries.end() && it->second.object->impl() != sock->impl()) forget(it); // A stale entry whose descriptor has been reused.
+		else if (it != _entries.end()) {
+			update(sock, mode);
+			return;
+		}
+		#ifdef __linux__
+		epoll_event ev = {};
+		ev.events = epoll_events_for(mode);
+		ev.data.fd = fd;
+		if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0 && (errno != EEXIST || epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0)) throw IOException("unable to add socket to epoll instance", errno);
+		#else
+		_pollset.add(*sock, mode);
+		#endif
+		angelscript_refcounted_duplicate<Socket>(sock);
+		_entries[fd] = {sock, mode};
+	}
+	void update(Socket* sock, int mode) {
+		if (!sock) throw InvalidArgumentException("cannot update a null socket in a socket_selector");
+		auto it = _entries.find(fd_of(*sock));
+		if (it == _entries.end() || it->second.object->impl() != sock->impl()) throw InvalidArgumentException("socket is not registered with this socket_selector");
+		#ifdef __linux__
+		epoll_event ev = {};
+		ev.events = epoll_events_for(mode);
+		ev.data.fd = it->first;
+		if (epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, it->first, &ev) < 0) throw IOException("unable to update socket in epoll instance", errno);
+		#else
+		_pollset.update(*sock, mode);
+		#endif
+		if (it->second.object != sock) {
+			// The same connection registered through a different handle; keep whichever one the script gave us last.
+			angelscript_refcounted_duplicate<Socket>(sock);
+			angelscript_refcounted_release<Socket>(it->second.object);
+			it->second.object = sock;
+		}
+		it->second.mode = mode;
+	}
+	bool remove(Socket* sock) {
+		if (!sock) return false;
+		auto it = _entries.find(fd_of(*sock));
+		if (it == _entries.end() || it->second.object->impl() != sock->impl()) return false;
+		forget(it);
+		return true;
+	}
+	bool has(Socket* sock) const {
+		if (!sock) return false;
+		auto it = _entries.find(fd_of(*sock));
+		return it != _entries.end() && it->second.object->impl() == sock->impl();
+	}
+	void clear() {
+		while (!_entries.empty()) forget(_entries.begin());
+		_ready.clear();
+	}
+	unsigned int get_count() const { return _entries.size(); }
+	// Waits up to timeout milliseconds (forever if negative, not at all if 0) and returns the number of ready sockets.
+	unsigned int select(int timeout) {
+		_ready.clear();
+		prune_closed();
+		if (_entries.empty()) {
+			if (timeout > 0) Thread::sleep(timeout);
+			return 0;
+		}
+		#ifdef __linux__
+		_events.resize(_entries.size());
+		int count = epoll_wait(_epoll_fd, _events.data(), _events.size(), timeout < 0? -1 : timeout);
+		if (count < 0) {
+			if (errno == EINTR) return 0;
+			throw IOException("epoll_wait failed", errno);
+		}
+		for (int i = 0; i < count; i++) {
+			const epoll_event& ev = _events[i];
+			int mode = 0;
+			if (ev.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) mode |= Socket::SELECT_READ; // A peer closing the connection shows up as a read of 0 bytes.
+			if (ev.events & EPOLLOUT) mode |= Socket::SELECT_WRITE;
+			if (ev.events & (EPOLLERR | EPOLLPRI)) mode |= Socket::SELECT_ERROR;
+			auto it = _entries.find(ev.data.fd);
+			if (it != _entries.end() && (mode &= it->second.mode | Socket::SELECT_ERROR)) _ready.emplace_back(it->first, mode);
+		}
+		#else
+		PollSet::SocketModeMap ready = _pollset.poll(Timespan(timeout < 0? Timespan::DAYS : Timespan::TimeDiff(timeout) * 1000));
+		for (const auto& r : ready) _ready.emplace_back(fd_of(r.first), r.second);
+		#endif
+		return _ready.size();
+	}
+	unsigned int get_ready_count() const { return _ready.size(); }
+	int get_ready_mode(unsigned int index) const {
+		if (index >= _ready.size()) throw RangeException(format("ready socket index %u out of bounds (%z sockets are ready)", index, _ready.size()));
+		return _ready[index].second;
+	}
+	template <class T> T* get_ready(unsigned int index) const {
+		if (index >= _ready.size()) throw RangeException(format("ready socket index %u out of bounds (%z sockets are ready)", index, _ready.size()));
+		auto it = _entries.find(_ready[index].first);
+		if (it == _entries.end()) return nullptr; // Removed since the select call.
+		T* result = dynamic_cast<T*>(it->second.object);
+		if (result) angelscript_refcounted_duplicate<T>(result);
+		return result;
+	}
+};
+socket_selector* socket_selector_factory() { return new socket_selector(); }
+template <class T> void RegisterSocketSelectorMethods(asIScriptEngine* engine, const std::string& type) {
+	engine->RegisterObjectMethod("socket_selector", format("void add(%s@+ sock, int mode = SOCKET_SELECT_READ)", type).c_str(), asMETHOD(socket_selector, add), asCALL_THISCALL);
+	engine->RegisterObjectMethod("socket_selector", format("void update(%s@+ sock, int mode)", type).c_str(), asMETHOD(socket_selector, update), asCALL_THISCALL);
+	engine->RegisterObjectMethod("socket_selector", format("bool remove(%s@+ sock)", type).c_str(), asMETHOD(socket_selector, remove), asCALL_THISCALL);
+	engine->RegisterObjectMethod("socket_selector", format("bool exists(%s@+ sock) const", type).c_str(), asMETHOD(socket_selector, has), asCALL_THISCALL);
+	engine->RegisterObjectMethod("socket_selector", format("%s@ get_ready_%s(uint index) const", type, type).c_str(), asMETHOD(socket_selector, get_ready<T>), asCALL_THISCALL);
+}
+void RegisterSocketSelector(asIScriptEngine* engine) {
+	engine->RegisterObjectType("socket_selector", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("socket_selector", asBEHAVE_FACTORY, "socket_selector@ f()", asFUNCTION(socket_selector_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("socket_selector", asBEHAVE_ADDREF, "void f()", asMETHODPR(socket_selector, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("socket_selector", asBEHAVE_RELEASE, "void f()", asMETHODPR(socket_selector, release, () const, void), asCALL_THISCALL);
+	RegisterSocketSelectorMethods<Socket>(engine, "socket");
+	RegisterSocketSelectorMethods<StreamSocket>(engine, "stream_socket");
+	RegisterSocketSelectorMethods<ServerSocket>(engine, "server_socket");
+	RegisterSocketSelectorMethods<DatagramSocket>(engine, "datagram_socket");
+	RegisterSocketSelectorMethods<WebSocket>(engine, "web_socket");
+	engine->RegisterObjectMethod("socket_selector", "uint select(int timeout = -1)", asMETHOD(socket_selector, select), asCALL_THISCALL);
+	engine->RegisterObjectMethod("socket_selector", "void clear()", asMETHOD(socket_selector, clear), asCALL_THISCALL);
+	engine->RegisterObjectMethod("socket_selector", "uint get_count() const property", asMETHOD(socket_selector, get_count), asCALL_THISCALL);
+	engine->RegisterObjectMethod("socket_selector", "uint get_ready_count() const property", asMETHOD(socket_selector, get_ready_count), asCALL_THISCALL);
+	engine->RegisterObjectMethod("socket_selector", "int get_ready_mode(uint index) const", asMETHOD(socket_selector, get_ready_mode), asCALL_THISCALL);
+}
 void RegisterDNS(asIScriptEngine* engine) {
 	engine->RegisterObjectType("dns_host_entry", sizeof(HostEntry), asOBJ_VALUE | asGetTypeTraits<HostEntry>());
 	engine->RegisterObjectBehaviour("dns_host_entry", asBEHAVE_CONSTRUCT, "void f()", asFUNCTION(generic_construct<HostEntry>), asCALL_CDECL_OBJFIRST);
@@ -806,6 +1042,470 @@ void RegisterHTTP(asIScriptEngine* engine) {
 	engine->RegisterObjectMethod("http", "void reset(bool configuration = false)", asMETHOD(http, reset), asCALL_THISCALL);
 }
 
+// Pooled asynchronous HTTP. Where an http object owns a thread and a fresh session for every request it makes, an http_pool keeps idle keep-alive sessions per host and works through any number of queued requests on a small, fixed set of I/O threads. Each thread performs one blocking request at a time, so at most io_threads requests are on the wire at once. This suits telemetry, leaderboard uploads and similar traffic that fires many small requests at the same few servers.
+class http_pool_request : public RefCountedObject {
+	friend class http_pool;
+	mutable FastMutex _mutex;
+	Event _done;
+	string _method, _request_body, _response_body, _error;
+	URI _url;
+	NameValueCollection _headers;
+	HTTPResponse _response;
+	asIScriptFunction* _callback;
+	Timestamp _submitted;
+	double _latency, _elapsed;
+	bool _reused_connection;
+	atomic<bool> _complete;
+public:
+	http_pool_request(const string& method, const URI& url, const string& body, const NameValueCollection* headers, asIScriptFunction* callback) : _done(Event::EVENT_MANUALRESET), _method(method), _request_body(body), _url(url), _callback(callback), _latency(0), _elapsed(0), _reused_connection(false), _complete(false) {
+		if (headers) _headers = *headers;
+	}
+	~http_pool_request() {
+		if (_callback) _callback->Release();
+	}
+	bool is_complete() const { return _complete; }
+	bool wait(int timeout) {
+		if (timeout < 0) {
+			_done.wait();
+			return true;
+		}
+		return _done.tryWait(timeout);
+	}
+	string get_method() const {
+		FastMutex::ScopedLock lock(_mutex);
+		return _method; // Becomes GET after a 303 redirect.
+	}
+	URI get_url() const {
+		FastMutex::ScopedLock lock(_mutex);
+		return _url;
+	}
+	int get_status_code() const {
+		FastMutex::ScopedLock lock(_mutex);
+		if (!_complete || !_error.empty()) return 0;
+		return _response.getStatus();
+	}
+	HTTPResponse* get_response_headers() const {
+		FastMutex::ScopedLock lock(_mutex);
+		return angelscript_refcounted_factory<HTTPResponse, const HTTPResponse&>(_response);
+	}
+	string get_response_body() const {
+		FastMutex::ScopedLock lock(_mutex);
+		return _response_body;
+	}
+	string get_error() const {
+		FastMutex::ScopedLock lock(_mutex);
+		return _error;
+	}
+	double get_latency() const {
+		FastMutex::ScopedLock lock(_mutex);
+		return _latency;
+	}
+	double get_elapsed() const {
+		FastMutex::ScopedLock lock(_mutex);
+		return _complete? _elapsed : _submitted.elapsed() / 1000.0;
+	}
+	bool get_reused_connection() const {
+		FastMutex::ScopedLock lock(_mutex);
+		return _reused_connection;
+	}
+};
+
+struct http_pool_host_stats {
+	UInt64 requests, failures, connections_opened, connections_reused;
+	double mean_latency, p99_latency, max_latency; // Milliseconds from sending a request to receiving its response headers.
+};
+
+class http_pool : public RefCountedObject {
+	struct host_entry {
+		vector<pair<HTTPClientSession*, Timestamp>> idle;
+		vector<double> latencies; // Ring of the most recent samples, used for percentiles.
+		unsigned int latency_cursor;
+		double latency_total, latency_max;
+		UInt64 requests, failures, connections_opened, connections_reused;
+		host_entry() : latency_cursor(0), latency_total(0), latency_max(0), requests(0), failures(0), connections_opened(0), connections_reused(0) {}
+	};
+	struct worker : public Runnable {
+		http_pool* owner;
+		Thread thread;
+		worker(http_pool* owner) : owner(owner) {}
+		void run() { owner->worker_loop(); }
+	};
+	static const unsigned int latency_samples = 1024;
+	vector<worker*> _workers;
+	deque<http_pool_request*> _queue, _finished;
+	map<string, host_entry> _hosts;
+	Mutex _queue_mutex;
+	Condition _queue_condition;
+	FastMutex _hosts_mutex, _finished_mutex;
+	string _user_agent;
+	atomic<unsigned int> _active, _max_idle_connections, _max_redirects, _connect_timeout, _send_timeout, _receive_timeout, _keepalive_timeout;
+	atomic<bool> _shutting_down;
+	static string host_key(const URI& url) { return url.getScheme() + "://" + url.getHost() + ":" + to_string(url.getPort()); }
+	HTTPClientSession* acquire_session(const string& key, const URI& url, bool& reused) {
+		{
+			FastMutex::ScopedLock lock(_hosts_mutex);
+			host_entry& h = _hosts[key];
+			Timestamp::TimeDiff max_idle = Timestamp::TimeDiff(_keepalive_timeout) * 1000;
+			while (!h.idle.empty()) {
+				pair<HTTPClientSession*, Timestamp> s = h.idle.back();
+				h.idle.pop_back();
+				if (s.second.isElapsed(max_idle) || !s.first->connected()) {
+					delete s.first;
+					continue;
+				}
+				h.connections_reused++;
+				reused = true;
+				return s.first;
+			}
+			h.connections_opened++;
+		}
+		reused = false;
+		HTTPClientSession* session = url.getScheme() == "http"? new HTTPClientSession(url.getHost(), url.getPort()) : new HTTPSClientSession(url.getHost(), url.getPort());
+		session->setKeepAlive(true);
+		session->setTimeout(Timespan(_connect_timeout * 1000), Timespan(_send_timeout * 1000), Timespan(_receive_timeout * 1000));
+		session->setKeepAliveTimeout(Timespan(_keepalive_timeout * 1000));
+		return session;
+	}
+	void release_session(const string& key, HTTPClientSession* session, bool reusable) {
+		if (reusable && !_shutting_down) {
+			FastMutex::ScopedLock lock(_hosts_mutex);
+			host_entry& h = _hosts[key];
+			if (h.idle.size() < _max_idle_connections) {
+				h.idle.emplace_back(session, Timestamp());
+				return;
+			}
+		}
+		delete session;
+	}
+	void record(const string& key, double latency, bool failed) {
+		FastMutex::ScopedLock lock(_hosts_mutex);
+		host_entry& h = _hosts[key];
+		h.requests++;
+		if (failed) {
+			h.failures++;
+			return;
+		}
+		h.latency_total += latency;
+		if (latency > h.latency_max) h.latency_max = latency;
+		if (h.latencies.size() < latency_samples) h.latencies.push_back(latency);
+		else h.latencies[h.latency_cursor] = latency;
+		h.latency_cursor = (h.latency_cursor + 1) % latency_samples;
+	}
+	http_pool_request* next_request() {
+		Mutex::ScopedLock lock(_queue_mutex);
+		while (_queue.empty() && !_shutting_down) _queue_condition.wait(_queue_mutex);
+		if (_shutting_down) return nullptr;
+		http_pool_request* r = _queue.front();
+		_queue.pop_front();
+		return r;
+	}
+	void worker_loop() {
+		while (http_pool_request* r = next_request()) {
+			try { execute(r); }
+			catch (...) { // execute reports its own errors, this only guarantees that every request gets finished so that wait() returns.
+				FastMutex::ScopedLock lock(r->_mutex);
+				if (r->_error.empty()) r->_error = "unexpected error while executing request";
+			}
+			finish(r);
+		}
+	}
+	static bool is_idempotent(const string& method) {
+		return method == HTTPRequest::HTTP_GET || method == HTTPRequest::HTTP_HEAD || method == HTTPRequest::HTTP_PUT || method == HTTPRequest::HTTP_DELETE || method == HTTPRequest::HTTP_OPTIONS || method == HTTPRequest::HTTP_TRACE;
+	}
+	void execute(http_pool_request* r) {
+		URI url = r->get_url();
+		unsigned int redirects = 0;
+		bool retried = false;
+		while (true) {
+			string key = host_key(url), error;
+			bool reused = false;
+			HTTPClientSession* session = nullptr;
+			try {
+				session = acquire_session(key, url, reused);
+				string path = url.getPathAndQuery();
+				if (path.empty()) path = "/";
+				HTTPRequest req(r->_method, path, HTTPMessage::HTTP_1_1);
+				req.setHost(url.getHost(), url.getPort());
+				req.set("User-Agent", _user_agent);
+				req.setKeepAlive(true);
+				for (const auto& header : r->_headers) req.set(header.first, header.second);
+				if (!r->_request_body.empty() || req.getMethod() == HTTPRequest::HTTP_POST || req.getMethod() == HTTPRequest::HTTP_PUT || req.getMethod() == HTTPRequest::HTTP_PATCH) {
+					req.setContentLength(r->_request_body.size());
+					if (req.getContentType() == HTTPMessage::UNKNOWN_CONTENT_TYPE) req.setContentType("application/x-www-form-urlencoded");
+				}
+				Timestamp sent;
+				session->sendRequest(req) << r->_request_body;
+				HTTPResponse response;
+				istream& istr = session->receiveResponse(response);
+				double latency = sent.elapsed() / 1000.0;
+				string body;
+				if (r->_method != HTTPRequest::HTTP_HEAD) StreamCopier::copyToString(istr, body);
+				release_session(key, session, response.getKeepAlive() && (r->_method == HTTPRequest::HTTP_HEAD || istr.eof()));
+				session = nullptr; // Owned by the idle pool or already deleted, so nothing below may delete it.
+				record(key, latency, false);
+				HTTPResponse::HTTPStatus status = response.getStatus();
+				bool moved = status == HTTPResponse::HTTP_MOVED_PERMANENTLY || status == HTTPResponse::HTTP_FOUND || status == HTTPResponse::HTTP_SEE_OTHER || status == HTTPResponse::HTTP_TEMPORARY_REDIRECT || status == HTTPResponse::HTTP_PERMANENT_REDIRECT;
+				if (moved && response.has("Location") && redirects++ < _max_redirects) {
+					URI target(url);
+					try { target.resolve(response.get("Location")); }
+					catch (Exception&) { target.clear(); }
+					FastMutex::ScopedLock lock(r->_mutex);
+					if ((target.getScheme() != "http" && target.getScheme() != "https") || target.getHost().empty()) {
+						r->_error = "redirected to an invalid or unsupported location: " + response.get("Location");
+						return;
+					}
+					url = target;
+					r->_url = url;
+					if (status == HTTPResponse::HTTP_SEE_OTHER && r->_method != HTTPRequest::HTTP_HEAD) {
+						// 303 means the result lives elsewhere and must be fetched with GET, so the body is not sent again.
+						r->_method = HTTPRequest::HTTP_GET;
+						r->_request_body.clear();
+						r->_headers.erase("Content-Type");
+						r->_headers.erase("Content-Length");
+					}
+					continue;
+				}
+				FastMutex::ScopedLock lock(r->_mutex);
+				r->_response = response;
+				r->_response_body.swap(body);
+				r->_latency = latency;
+				r->_reused_connection = reused;
+				return;
+			} catch (Exception& e) {
+				error = e.displayText();
+			} catch (std::exception& e) {
+				error = e.what();
+			} catch (...) {
+				error = "unknown error";
+			}
+			delete session;
+			// A server is free to drop a keep-alive connection at any moment, so a failure on a reused session is retried once on a fresh one before it is reported. The request may already have been processed though, so only idempotent methods are retried.
+			if (reused && !retried && !_shutting_down && is_idempotent(r->_method)) {
+				retried = true;
+				continue;
+			}
+			record(key, 0, true);
+			FastMutex::ScopedLock lock(r->_mutex);
+			r->_error = error;
+			return;
+		}
+	}
+	void finish(http_pool_request* r) {
+		{
+			FastMutex::ScopedLock lock(r->_mutex);
+			r->_elapsed = r->_submitted.elapsed() / 1000.0;
+		}
+		r->_complete = true;
+		r->_done.set();
+		if (r->_callback) {
+			FastMutex::ScopedLock lock(_finished_mutex);
+			_finished.push_back(r);
+		} else r->release();
+		_active--;
+	}
+public:
+	http_pool(unsigned int io_threads, unsigned int max_idle_connections) : _active(0), _max_idle_connections(max_idle_connections), _max_redirects(5), _connect_timeout(30000), _send_timeout(60000), _receive_timeout(60000), _keepalive_timeout(10000), _shutting_down(false) {
+		set_user_agent();
+		if (io_threads < 1) io_threads = 1;
+		for (unsigned int i = 0; i < io_threads; i++) {
+			worker* w = new worker(this);
+			_workers.push_back(w);
+			w->thread.setName("http_pool");
+			w->thread.start(*w);
+		}
+	}
+	~http_pool() {
+		{
+			Mutex::ScopedLock lock(_queue_mutex);
+			_shutting_down = true;
+		}
+		_queue_condition.broadcast();
+		for (worker* w : _workers) {
+			w->thread.join();
+			delete w;
+		}
+		for (http_pool_request* r : _queue) {
+			{
+				FastMutex::ScopedLock lock(r->_mutex);
+				r->_error = "http_pool destroyed before the request was sent";
+			}
+			r->_complete = true;
+			r->_done.set();
+			r->release();
+		}
+		for (http_pool_request* r : _finished) r->release();
+		for (auto& h : _hosts) {
+			for (auto& s : h.second.idle) delete s.first;
+		}
+	}
+	http_pool_request* request(const string& method, const URI& url, const string& body, const NameValueCollection* headers, asIScriptFunction* callback) {
+		if (url.getScheme() != "http" && url.getScheme() != "https") {
+			if (callback) callback->Release();
+			throw InvalidArgumentException("http_pool only supports http and https urls");
+		}
+		http_pool_request* r = new http_pool_request(method, url, body, headers, callback);
+		r->duplicate(); // One reference for the script, one held until a worker has finished with the request.
+		_active++;
+		{
+			Mutex::ScopedLock lock(_queue_mutex);
+			_queue.push_back(r);
+		}
+		_queue_condition.signal();
+		return r;
+	}
+	http_pool_request* get(const URI& url, const NameValueCollection* headers, asIScriptFunction* callback) { return request(HTTPRequest::HTTP_GET, url, "", headers, callback); }
+	http_pool_request* post(const URI& url, const string& body, const NameValueCollection* headers, asIScriptFunction* callback) { return request(HTTPRequest::HTTP_POST, url, body, headers, callback); }
+	// Completion callbacks always run on the thread that calls poll, so scripts never need to synchronize with the I/O threads.
+	unsigned int poll() {
+		deque<http_pool_request*> ready;
+		{
+			FastMutex::ScopedLock lock(_finished_mutex);
+			ready.swap(_finished);
+		}
+		for (http_pool_request* r : ready) {
+			asIScriptContext* ACtx = asGetActiveContext();
+			bool new_context = ACtx == nullptr || ACtx->PushState() < 0;
+			asIScriptContext* ctx = new_context? g_ScriptEngine->RequestContext() : ACtx;
+			if (ctx && ctx->Prepare(r->_callback) >= 0) {
+				ctx->SetArgObject(0, r);
+				ctx->Execute();
+			}
+			if (ctx) new_context? g_ScriptEngine->ReturnContext(ctx) : (void)ctx->PopState();
+			r->release();
+		}
+		return ready.size();
+	}
+	bool wait(int timeout) {
+		Timestamp start;
+		while (_active > 0) {
+			if (timeout >= 0 && start.isElapsed(Timestamp::TimeDiff(timeout) * 1000)) return false;
+			Thread::sleep(1);
+		}
+		return true;
+	}
+	unsigned int get_pending() const { return _active; }
+	unsigned int get_io_threads() const { return _workers.size(); }
+	CScriptArray* get_hosts() {
+		vector<string> hosts;
+		FastMutex::ScopedLock lock(_hosts_mutex);
+		for (const auto& h : _hosts) hosts.push_back(h.first);
+		return vector_to_scriptarray<string>(hosts, "string");
+	}
+	http_pool_host_stats get_host_stats(const URI& url) {
+		http_pool_host_stats stats = {};
+		FastMutex::ScopedLock lock(_hosts_mutex);
+		auto it = _hosts.find(host_key(url));
+		if (it == _hosts.end()) return stats;
+		const host_entry& h = it->second;
+		stats.requests = h.requests;
+		stats.failures = h.failures;
+		stats.connections_opened = h.connections_opened;
+		stats.connections_reused = h.connections_reused;
+		stats.max_latency = h.latency_max;
+		if (h.requests > h.failures) stats.mean_latency = h.latency_total / (h.requests - h.failures);
+		if (!h.latencies.empty()) {
+			vector<double> sorted = h.latencies;
+			size_t index = min(sorted.size() - 1, size_t(sorted.size() * 0.99));
+			nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+			stats.p99_latency = sorted[index];
+		}
+		return stats;
+	}
+	void reset_stats() {
+		FastMutex::ScopedLock lock(_hosts_mutex);
+		for (auto& h : _hosts) {
+			host_entry& e = h.second;
+			e.latencies.clear();
+			e.latency_cursor = 0;
+			e.latency_total = e.latency_max = 0;
+			e.requests = e.failures = e.connections_opened = e.connections_reused = 0;
+		}
+	}
+	void close_idle_connections() {
+		FastMutex::ScopedLock lock(_hosts_mutex);
+		for (auto& h : _hosts) {
+			for (auto& s : h.second.idle) delete s.first;
+			h.second.idle.clear();
+		}
+	}
+	string get_user_agent() {
+		FastMutex::ScopedLock lock(_hosts_mutex);
+		return _user_agent;
+	}
+	void set_user_agent(const string& agent = "") {
+		FastMutex::ScopedLock lock(_hosts_mutex);
+		if (agent.empty()) _user_agent = "nvgt " + NVGT_VERSION;
+		else _user_agent = agent;
+	}
+	unsigned int get_max_idle_connections() const { return _max_idle_connections; }
+	void set_max_idle_connections(unsigned int count) { _max_idle_connections = count; }
+	unsigned int get_max_redirects() const { return _max_redirects; }
+	void set_max_redirects(unsigned int count) { _max_redirects = count; }
+	unsigned int get_connect_timeout() const { return _connect_timeout; }
+	void set_connect_timeout(unsigned int timeout) { _connect_timeout = timeout; }
+	unsigned int get_send_timeout() const { return _send_timeout; }
+	void set_send_timeout(unsigned int timeout) { _send_timeout = timeout; }
+	unsigned int get_receive_timeout() const { return _receive_timeout; }
+	void set_receive_timeout(unsigned int timeout) { _receive_timeout = timeout; }
+	unsigned int get_keepalive_timeout() const { return _keepalive_timeout; }
+	void set_keepalive_timeout(unsigned int timeout) { _keepalive_timeout = timeout; }
+};
+http_pool* http_pool_factory(unsigned int io_threads, unsigned int max_idle_connections) { return new http_pool(io_threads, max_idle_connections); }
+void RegisterHTTPPool(asIScriptEngine* engine) {
+	engine->RegisterObjectType("http_pool_request", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("http_pool_request", asBEHAVE_ADDREF, "void f()", asMETHODPR(http_pool_request, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("http_pool_request", asBEHAVE_RELEASE, "void f()", asMETHODPR(http_pool_request, release, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool_request", "bool get_complete() const property", asMETHOD(http_pool_request, is_complete), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool_request", "bool wait(int timeout = -1)", asMETHOD(http_pool_request, wait), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool_request", "string get_method() const property", asMETHOD(http_pool_request, get_method), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool_request", "spec::uri get_url() const property", asMETHOD(http_pool_request, get_url), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool_request", "int get_status_code() const property", asMETHOD(http_pool_request, get_status_code), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool_request", "http_response@ get_response_headers() const property", asMETHOD(http_pool_request, get_response_headers), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool_request", "string get_response_body() const property", asMETHOD(http_pool_request, get_response_body), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool_request", "string get_error() const property", asMETHOD(http_pool_request, get_error), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool_request", "double get_latency() const property", asMETHOD(http_pool_request, get_latency), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool_request", "double get_elapsed() const property", asMETHOD(http_pool_request, get_elapsed), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool_request", "bool get_reused_connection() const property", asMETHOD(http_pool_request, get_reused_connection), asCALL_THISCALL);
+	engine->RegisterFuncdef("void http_pool_callback(http_pool_request@ request)");
+	engine->RegisterObjectType("http_pool_host_stats", sizeof(http_pool_host_stats), asOBJ_VALUE | asOBJ_POD | asGetTypeTraits<http_pool_host_stats>());
+	engine->RegisterObjectProperty("http_pool_host_stats", "const uint64 requests", asOFFSET(http_pool_host_stats, requests));
+	engine->RegisterObjectProperty("http_pool_host_stats", "const uint64 failures", asOFFSET(http_pool_host_stats, failures));
+	engine->RegisterObjectProperty("http_pool_host_stats", "const uint64 connections_opened", asOFFSET(http_pool_host_stats, connections_opened));
+	engine->RegisterObjectProperty("http_pool_host_stats", "const uint64 connections_reused", asOFFSET(http_pool_host_stats, connections_reused));
+	engine->RegisterObjectProperty("http_pool_host_stats", "const double mean_latency", asOFFSET(http_pool_host_stats, mean_latency));
+	engine->RegisterObjectProperty("http_pool_host_stats", "const double p99_latency", asOFFSET(http_pool_host_stats, p99_latency));
+	engine->RegisterObjectProperty("http_pool_host_stats", "const double max_latency", asOFFSET(http_pool_host_stats, max_latency));
+	engine->RegisterObjectType("http_pool", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("http_pool", asBEHAVE_FACTORY, "http_pool@ f(uint io_threads = 4, uint max_idle_connections = 4)", asFUNCTION(http_pool_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("http_pool", asBEHAVE_ADDREF, "void f()", asMETHODPR(http_pool, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("http_pool", asBEHAVE_RELEASE, "void f()", asMETHODPR(http_pool, release, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "http_pool_request@ request(const string&in method, const spec::uri&in url, const string&in body = \"\", const name_value_collection@+ headers = null, http_pool_callback@ callback = null)", asMETHOD(http_pool, request), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "http_pool_request@ get(const spec::uri&in url, const name_value_collection@+ headers = null, http_pool_callback@ callback = null)", asMETHOD(http_pool, get), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "http_pool_request@ post(const spec::uri&in url, const string&in body, const name_value_collection@+ headers = null, http_pool_callback@ callback = null)", asMETHOD(http_pool, post), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "uint poll()", asMETHOD(http_pool, poll), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "bool wait(int timeout = -1)", asMETHOD(http_pool, wait), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "uint get_pending() const property", asMETHOD(http_pool, get_pending), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "uint get_io_threads() const property", asMETHOD(http_pool, get_io_threads), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "string[]@ get_hosts()", asMETHOD(http_pool, get_hosts), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "http_pool_host_stats get_host_stats(const spec::uri&in host)", asMETHOD(http_pool, get_host_stats), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "void reset_stats()", asMETHOD(http_pool, reset_stats), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "void close_idle_connections()", asMETHOD(http_pool, close_idle_connections), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "string get_user_agent() property", asMETHOD(http_pool, get_user_agent), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "void set_user_agent(const string&in agent = \"\") property", asMETHOD(http_pool, set_user_agent), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "uint get_max_idle_connections() const property", asMETHOD(http_pool, get_max_idle_connections), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "void set_max_idle_connections(uint count) property", asMETHOD(http_pool, set_max_idle_connections), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "uint get_max_redirects() const property", asMETHOD(http_pool, get_max_redirects), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "void set_max_redirects(uint count) property", asMETHOD(http_pool, set_max_redirects), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "uint get_connect_timeout() const property", asMETHOD(http_pool, get_connect_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "void set_connect_timeout(uint timeout) property", asMETHOD(http_pool, set_connect_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "uint get_send_timeout() const property", asMETHOD(http_pool, get_send_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "void set_send_timeout(uint timeout) property", asMETHOD(http_pool, set_send_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "uint get_receive_timeout() const property", asMETHOD(http_pool, get_receive_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "void set_receive_timeout(uint timeout) property", asMETHOD(http_pool, set_receive_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "uint get_keepalive_timeout() const property", asMETHOD(http_pool, get_keepalive_timeout), asCALL_THISCALL);
+	engine->RegisterObjectMethod("http_pool", "void set_keepalive_timeout(uint timeout) property", asMETHOD(http_pool, set_keepalive_timeout), asCALL_THISCALL);
+}
+
 // NVGT's highest level HTTP.
 string url_request(const string& method, const string& url, const string& data, HTTPResponse* resp) {
 	http h;
@@ -873,9 +1573,14 @@ void RegisterInternet(asIScriptEngine* engine) {
 	RegisterFTPClientSession<FTPClientSession>(engine, "ftp_client");
 	RegisterSocket<Socket>(engine, "socket");
 	RegisterStreamSocket<StreamSocket>(engine, "stream_socket");
+	RegisterDatagramSocket<DatagramSocket>(engine, "datagram_socket");
+	RegisterServerSocket<ServerSocket>(engine, "server_socket");
 	RegisterWebSocket(engine);
+	RegisterSocketSelector(engine);
 	RegisterDNS(engine);
 	RegisterHTTP(engine);
+	RegisterHTTPPool(engine);
+	RegisterHTTPServer(engine);
 	engine->RegisterGlobalFunction("string url_request(const string&in method, const string&in url, const string&in data = \"\", http_response&out response = void)", asFUNCTION(url_request), asCALL_CDECL);
 	engine->RegisterGlobalFunction("string url_get(const string&in url, http_response&out response = void)", asFUNCTION(url_get), asCALL_CDECL);
 	engine->RegisterGlobalFunction("string url_post(const string&in url, const string&in data, http_response&out response = void)", asFUNCTION(url_post), asCALL_CDECL);
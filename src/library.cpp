@@ -54,9 +54,85 @@ static ffi_type* resolve_ffi_type(const std::string& type_str) {
 	return it != g_ffi_types.end() ? it->second : &ffi_type_pointer;
 }
 
+// Strings passed to char* parameters go through as const char*, and strings passed to wchar* parameters are converted to the platform's wchar_t encoding first.
+static library_function::arg_kind resolve_arg_kind(const std::string& type_str) {
+	std::string t = str_trim(type_str);
+	if (t == "char*") return library_function::ARG_CSTRING;
+	if (t == "wchar*") return library_function::ARG_WSTRING;
+	return library_function::ARG_VALUE;
+}
+
+// wchar_t holds UTF-16 on Windows and UTF-32 on other platforms, and Poco's std::wstring overloads convert to whichever of those applies.
+static std::string wide_to_utf8(const wchar_t* ws) {
+	std::string utf8;
+	if (ws) Poco::UnicodeConverter::convert(std::wstring(ws), utf8);
+	return utf8;
+}
+
+// Primitive arguments are converted into the exact type the native function expects, so that for example an int literal can be passed to an int64 or double parameter.
+union ffi_arg_slot {
+	int8_t i8; uint8_t u8; int16_t i16; uint16_t u16; int32_t i32; uint32_t u32; int64_t i64; uint64_t u64;
+	float f; double d; const void* p;
+};
+static void store_primitive(const void* src, int type_id, const ffi_type* type, ffi_arg_slot& slot) {
+	int64_t i = 0;
+	double d = 0;
+	bool floating = false;
+	switch (type_id) {
+	case asTYPEID_BOOL:   i = *(const bool*)src; break;
+	case asTYPEID_INT8:   i = *(const int8_t*)src; break;
+	case asTYPEID_INT16:  i = *(const int16_t*)src; break;
+	case asTYPEID_INT32:  i = *(const int32_t*)src; break;
+	case asTYPEID_INT64:  i = *(const int64_t*)src; break;
+	case asTYPEID_UINT8:  i = *(const uint8_t*)src; break;
+	case asTYPEID_UINT16: i = *(const uint16_t*)src; break;
+	case asTYPEID_UINT32: i = *(const uint32_t*)src; break;
+	case asTYPEID_UINT64: i = (int64_t)*(const uint64_t*)src; break;
+	case asTYPEID_FLOAT:  d = *(const float*)src; floating = true; break;
+	case asTYPEID_DOUBLE: d = *(const double*)src; floating = true; break;
+	default:              i = *(const int32_t*)src; break; // enums
+	}
+	if (floating) i = (int64_t)d;
+	else d = type_id == asTYPEID_UINT64 ? (double)(uint64_t)i : (double)i;
+	switch (type->type) {
+	case FFI_TYPE_FLOAT:   slot.f = (float)d; break;
+	case FFI_TYPE_DOUBLE:  slot.d = d; break;
+	case FFI_TYPE_SINT8:   slot.i8 = (int8_t)i; break;
+	case FFI_TYPE_UINT8:   slot.u8 = (uint8_t)i; break;
+	case FFI_TYPE_SINT16:  slot.i16 = (int16_t)i; break;
+	case FFI_TYPE_UINT16:  slot.u16 = (uint16_t)i; break;
+	case FFI_TYPE_SINT32:  slot.i32 = (int32_t)i; break;
+	case FFI_TYPE_UINT32:  slot.u32 = (uint32_t)i; break;
+	case FFI_TYPE_POINTER: slot.p = (const void*)(uintptr_t)i; break;
+	default:               slot.i64 = i; break;
+	}
+}
+
+// Argument storage is kept per thread and reused between calls, so once the slots have grown to fit a signature, calling through a library_function does not touch the heap.
+struct ffi_call_slots {
+	std::vector<void*> ptrs;
+	std::vector<ffi_arg_slot> values;
+	std::vector<std::wstring> wstrs;
+	bool busy = false;
+};
+static thread_local ffi_call_slots t_call_slots;
+
+static int64_t return_as_int(const library_return_value& retval, const ffi_type* type) {
+	switch (type->type) {
+	case FFI_TYPE_UINT8:  return (uint8_t)retval.i;
+	case FFI_TYPE_SINT8:  return (int8_t)retval.i;
+	case FFI_TYPE_UINT16: return (uint16_t)retval.i;
+	case FFI_TYPE_SINT16: return (int16_t)retval.i;
+	case FFI_TYPE_UINT32: return (uint32_t)retval.i;
+	case FFI_TYPE_SINT32:
+	case FFI_TYPE_INT:    return (int32_t)retval.i;
+	default:              return (int64_t)retval.i;
+	}
+}
+
 // --- library_function ---
 
-library_function::library_function(const std::string& sig, SDL_SharedObject* so) : rtype(&ffi_type_void), func_ptr(nullptr), ref_count(1) {
+library_function::library_function(const std::string& sig, SDL_SharedObject* so) : rtype(&ffi_type_void), rkind(ARG_VALUE), func_ptr(nullptr), ref_count(1) {
 	size_t paren_open = sig.find('(');
 	size_t paren_close = sig.rfind(')');
 	if (paren_open == std::string::npos || paren_close == std::string::npos)
@@ -66,8 +142,9 @@ library_function::library_function(const std::string& sig, SDL_SharedObject* so)
 	size_t last_space = before.rfind(' ');
 	if (last_space == std::string::npos)
 		throw Poco::InvalidArgumentException("invalid signature: cannot separate return type from function name");
-	rtype_string = str_trim(before.substr(0, last_space));
+	std::string rtype_string = str_trim(before.substr(0, last_space));
 	rtype = resolve_ffi_type(rtype_string);
+	rkind = resolve_arg_kind(rtype_string);
 	std::string func_name = str_trim(before.substr(last_space + 1));
 	if (!args_part.empty() && args_part != "void") {
 		std::istringstream ss(args_part);
@@ -75,7 +152,7 @@ library_function::library_function(const std::string& sig, SDL_SharedObject* so)
 		while (std::getline(ss, token, ',')) {
 			std::string arg = str_trim(token);
 			if (!arg.empty()) {
-				arg_type_strings.push_back(arg);
+				arg_kinds.push_back(resolve_arg_kind(arg));
 				arg_types.push_back(resolve_ffi_type(arg));
 			}
 		}
@@ -94,66 +171,63 @@ void library_function::invalidate() { func_ptr = nullptr; error_text = "library
 
 // Reads generic/variadic arguments from gen starting at arg_offset and calls the
 // function via libffi.  AngelScript strings destined for char* args are passed as
-// const char* pointers (kept alive in cstrs); strings destined for wchar* args are
-// UTF-8→UTF-16 converted (kept alive in wstrs/wptrs).  Everything else is passed
-// straight through via GetArgAddress.  Returns a typed poco_shared<Var>.
-poco_shared<Poco::Dynamic::Var>* library_function::invoke(asIScriptGeneric* gen, int arg_offset) {
+// const char* pointers; strings destined for wchar* args are converted to wchar_t strings held
+// in reusable slot buffers.  Primitives are converted into the parameter's exact
+// type, and anything else is passed straight through via GetArgAddress.
+void library_function::call(asIScriptGeneric* gen, int arg_offset, library_return_value& retval) {
 	if (!func_ptr) throw Poco::RuntimeException(error_text);
 	if (!g_StringTypeid) g_StringTypeid = g_ScriptEngine->GetStringFactory();
-	int nffi = (int)arg_types.size();
+	unsigned int nffi = (unsigned int)arg_types.size();
 	int ngen = gen->GetArgCount() - arg_offset;
-	if (ngen < nffi) throw Poco::InvalidArgumentException("expected " + std::to_string(nffi) + " arguments but got " + std::to_string(ngen));
-	std::vector<void*> arg_ptrs;
-	std::vector<const char*> cstrs; // keeps char* values addressable through ffi_call
-	std::vector<std::wstring> wstrs; // keeps wchar_t buffers alive through ffi_call
-	std::vector<const wchar_t*> wptrs; // addressable wchar_t* values into wstrs
-	arg_ptrs.reserve(nffi);
-	cstrs.reserve(nffi);
-	wstrs.reserve(nffi);
-	wptrs.reserve(nffi);
-	for (int i = 0; i < nffi; i++) {
-		int n = arg_offset + i;
+	if (ngen < (int)nffi) throw Poco::InvalidArgumentException("expected " + std::to_string(nffi) + " arguments but got " + std::to_string(ngen));
+	// The native function may call back into the script, which could then make another library call on this same thread.
+	ffi_call_slots nested;
+	ffi_call_slots& slots = t_call_slots.busy ? nested : t_call_slots;
+	if (slots.values.size() < nffi) {
+		slots.values.resize(nffi);
+		slots.ptrs.resize(nffi);
+		slots.wstrs.resize(nffi);
+	}
+	struct busy_guard { bool& busy; ~busy_guard() { busy = false; } } guard{slots.busy};
+	slots.busy = true;
+	for (unsigned int i = 0; i < nffi; i++) {
+		int n = arg_offset + (int)i;
 		int tid = gen->GetArgTypeId(n);
+		void* addr = gen->GetArgAddress(n);
 		if (tid == g_StringTypeid && arg_types[i] == &ffi_type_pointer) {
-			std::string* str = (std::string*)gen->GetArgAddress(n);
-			#ifdef _WIN32
-			if (arg_type_strings[i] == "wchar*") {
-				std::wstring ws;
-				Poco::UnicodeConverter::convert(*str, ws);
-				wstrs.push_back(std::move(ws));
-				wptrs.push_back(wstrs.back().c_str());
-				arg_ptrs.push_back(&wptrs.back());
-			} else
-			#endif
-			{
-				cstrs.push_back(str->c_str());
-				arg_ptrs.push_back(&cstrs.back());
-			}
+			const std::string* str = (const std::string*)addr;
+			if (arg_kinds[i] == ARG_WSTRING) {
+				Poco::UnicodeConverter::convert(*str, slots.wstrs[i]);
+				slots.values[i].p = slots.wstrs[i].c_str();
+			} else slots.values[i].p = str->c_str();
+			slots.ptrs[i] = &slots.values[i];
+		} else if (tid != asTYPEID_VOID && !(tid & asTYPEID_MASK_OBJECT)) {
+			store_primitive(addr, tid, arg_types[i], slots.values[i]);
+			slots.ptrs[i] = &slots.values[i];
 		} else {
 			// GetArgAddress returns a pointer to the argument value — exactly
 			// what ffi_call's avalue[i] expects for all other types.
-			arg_ptrs.push_back(gen->GetArgAddress(n));
+			slots.ptrs[i] = addr;
 		}
 	}
-	union { ffi_arg i; float f; double d; } retval = {};
-	ffi_call(&cif, FFI_FN(func_ptr), &retval, nffi > 0 ? arg_ptrs.data() : nullptr);
+	retval = {};
+	ffi_call(&cif, FFI_FN(func_ptr), &retval, nffi > 0 ? slots.ptrs.data() : nullptr);
+}
+
+// Calls the function and boxes the result in a typed poco_shared<Var>.
+poco_shared<Poco::Dynamic::Var>* library_function::invoke(asIScriptGeneric* gen, int arg_offset) {
+	library_return_value retval;
+	call(gen, arg_offset, retval);
 	auto make_var = [](auto v) {
 		return new poco_shared<Poco::Dynamic::Var>(new Poco::Dynamic::Var(v));
 	};
 	// Pointer returns: char* and wchar* become std::string; other pointers return as uint64.
 	if (rtype == &ffi_type_pointer) {
-		if (rtype_string == "char*") {
+		if (rkind == ARG_CSTRING) {
 			const char* s = reinterpret_cast<const char*>((uintptr_t)retval.i);
 			return make_var(s ? std::string(s) : std::string());
 		}
-		#ifdef _WIN32
-		else if (rtype_string == "wchar*") {
-			const wchar_t* ws = reinterpret_cast<const wchar_t*>((uintptr_t)retval.i);
-			std::string utf8;
-			if (ws) Poco::UnicodeConverter::convert(std::wstring(ws), utf8);
-			return make_var(utf8);
-		}
-		#endif
+		else if (rkind == ARG_WSTRING) return make_var(wide_to_utf8(reinterpret_cast<const wchar_t*>((uintptr_t)retval.i)));
 		return make_var((uint64_t)retval.i);
 	}
 	switch (rtype->type) {
@@ -173,6 +247,43 @@ poco_shared<Poco::Dynamic::Var>* library_function::invoke(asIScriptGeneric* gen,
 	}
 }
 
+// The typed call methods refuse to silently reinterpret a return value of the wrong kind, for example reading a double return through call_int.
+void library_function::check_return(bool floating, const char* method) const {
+	if (rtype->type == FFI_TYPE_VOID) throw Poco::InvalidAccessException(std::string(method) + " used on a function that returns void");
+	bool is_floating = rtype->type == FFI_TYPE_FLOAT || rtype->type == FFI_TYPE_DOUBLE;
+	if (floating != is_floating) throw Poco::InvalidAccessException(std::string(method) + (is_floating ? " used on a function with a floating point return type" : " used on a function with an integer return type"));
+}
+void library_function::call_void(asIScriptGeneric* gen, int arg_offset) {
+	library_return_value retval;
+	call(gen, arg_offset, retval);
+}
+int64_t library_function::call_int(asIScriptGeneric* gen, int arg_offset) {
+	check_return(false, "call_int");
+	library_return_value retval;
+	call(gen, arg_offset, retval);
+	return return_as_int(retval, rtype);
+}
+uint64_t library_function::call_uint(asIScriptGeneric* gen, int arg_offset) {
+	check_return(false, "call_uint");
+	library_return_value retval;
+	call(gen, arg_offset, retval);
+	return (uint64_t)return_as_int(retval, rtype);
+}
+double library_function::call_double(asIScriptGeneric* gen, int arg_offset) {
+	check_return(true, "call_double");
+	library_return_value retval;
+	call(gen, arg_offset, retval);
+	return rtype->type == FFI_TYPE_FLOAT ? retval.f : retval.d;
+}
+std::string library_function::call_string(asIScriptGeneric* gen, int arg_offset) {
+	if (rkind == ARG_VALUE) throw Poco::InvalidAccessException("call_string used on a function that does not return char* or wchar*");
+	library_return_value retval;
+	call(gen, arg_offset, retval);
+	if (rkind == ARG_WSTRING) return wide_to_utf8(reinterpret_cast<const wchar_t*>((uintptr_t)retval.i));
+	const char* s = reinterpret_cast<const char*>((uintptr_t)retval.i);
+	return s ? std::string(s) : std::string();
+}
+
 // --- library ---
 
 void library::add_ref() { asAtomicInc(ref_count); }
@@ -224,6 +335,23 @@ static void library_function_opCall(asIScriptGeneric* gen) {
 	gen->SetReturnObject(self->invoke(gen, 0));
 }
 
+static void library_function_call_void(asIScriptGeneric* gen) {
+	((library_function*)gen->GetObject())->call_void(gen, 0);
+}
+static void library_function_call_int(asIScriptGeneric* gen) {
+	gen->SetReturnQWord((asQWORD)((library_function*)gen->GetObject())->call_int(gen, 0));
+}
+static void library_function_call_uint(asIScriptGeneric* gen) {
+	gen->SetReturnQWord(((library_function*)gen->GetObject())->call_uint(gen, 0));
+}
+static void library_function_call_double(asIScriptGeneric* gen) {
+	gen->SetReturnDouble(((library_function*)gen->GetObject())->call_double(gen, 0));
+}
+static void library_function_call_string(asIScriptGeneric* gen) {
+	std::string result = ((library_function*)gen->GetObject())->call_string(gen, 0);
+	new (gen->GetAddressOfReturnLocation()) std::string(std::move(result));
+}
+
 static void library_call_wrapper(asIScriptGeneric* gen) {
 	library* l = (library*)gen->GetObject();
 	l->call(gen);
@@ -241,6 +369,11 @@ void RegisterScriptLibrary(asIScriptEngine* engine) {
 	engine->RegisterObjectBehaviour(_O("library_function"), asBEHAVE_ADDREF, _O("void f()"), asMETHOD(library_function, add_ref), asCALL_THISCALL);
 	engine->RegisterObjectBehaviour(_O("library_function"), asBEHAVE_RELEASE, _O("void f()"), asMETHOD(library_function, release), asCALL_THISCALL);
 	engine->RegisterObjectMethod(_O("library_function"), _O("var@ opCall(?&in...)"), asFUNCTION(library_function_opCall), asCALL_GENERIC);
+	engine->RegisterObjectMethod(_O("library_function"), _O("void call_void(?&in...)"), asFUNCTION(library_function_call_void), asCALL_GENERIC);
+	engine->RegisterObjectMethod(_O("library_function"), _O("int64 call_int(?&in...)"), asFUNCTION(library_function_call_int), asCALL_GENERIC);
+	engine->RegisterObjectMethod(_O("library_function"), _O("uint64 call_uint(?&in...)"), asFUNCTION(library_function_call_uint), asCALL_GENERIC);
+	engine->RegisterObjectMethod(_O("library_function"), _O("double call_double(?&in...)"), asFUNCTION(library_function_call_double), asCALL_GENERIC);
+	engine->RegisterObjectMethod(_O("library_function"), _O("string call_string(?&in...)"), asFUNCTION(library_function_call_string), asCALL_GENERIC);
 	engine->RegisterObjectMethod(_O("library_function"), _O("bool get_valid() const property"), asMETHOD(library_function, is_valid), asCALL_THISCALL);
 	engine->RegisterObjectMethod(_O("library_function"), _O("string get_error() const property"), asMETHOD(library_function, get_error), asCALL_THISCALL);
 	engine->RegisterObjectType(_O("library"), 0, asOBJ_REF);
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -25,15 +26,22 @@ template <class T> class poco_shared;
 class asIScriptEngine;
 class asIScriptGeneric;
 
+union library_return_value { ffi_arg i; float f; double d; };
+
 class library_function {
+public:
+	enum arg_kind : unsigned char { ARG_VALUE, ARG_CSTRING, ARG_WSTRING };
+private:
 	ffi_cif cif;
 	std::vector<ffi_type*> arg_types;
-	std::vector<std::string> arg_type_strings; // raw per-arg type strings for char*/wchar* detection
+	std::vector<arg_kind> arg_kinds; // resolved once from the signature so calls don't compare type strings
 	ffi_type* rtype;
-	std::string rtype_string; // raw return type string for char*/wchar* detection
+	arg_kind rkind;
 	void* func_ptr;
 	std::string error_text; // set only by invalidate(), checked in invoke()
 	int ref_count;
+	void call(asIScriptGeneric* gen, int arg_offset, library_return_value& retval);
+	void check_return(bool floating, const char* method) const;
 public:
 	library_function(const std::string& sig, SDL_SharedObject* so);
 	void add_ref();
@@ -42,6 +50,12 @@ public:
 	bool is_valid() const { return func_ptr != nullptr; }
 	std::string get_error() const { return error_text; }
 	poco_shared<Poco::Dynamic::Var>* invoke(asIScriptGeneric* gen, int arg_offset);
+	// Typed entry points that hand primitives straight back to the script instead of boxing them in a var.
+	void call_void(asIScriptGeneric* gen, int arg_offset);
+	int64_t call_int(asIScriptGeneric* gen, int arg_offset);
+	uint64_t call_uint(asIScriptGeneric* gen, int arg_offset);
+	double call_double(asIScriptGeneric* gen, int arg_offset);
+	std::string call_string(asIScriptGeneric* gen, int arg_offset);
 };
 
 class library {
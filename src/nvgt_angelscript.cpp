@@ -15,6 +15,8 @@
 #define NOMINMAX
 #include "UI.h"
 #include "network.h"
+#include <atomic>
+#include <cstring>
 #include <exception>
 #include <string>
 #include <unordered_map>
@@ -92,11 +94,16 @@
 #include "contextmgr.h"
 #include "weakref.h"
 #include "anticheat.h"
+#if defined(NVGT_NATIVE_CALLS_ONLY) && !(defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__)))
+	#error "NVGT_NATIVE_CALLS_ONLY is only supported when targeting Linux on x86-64 or ARM64"
+#endif
 #ifndef NVGT_STUB
 	int PragmaCallback(const std::string &pragmaText, CScriptBuilder &builder, void* /*userParam*/);
 #endif
 asIScriptContext* RequestContextCallback(asIScriptEngine *engine, void* /*param*/);
 void ReturnContextCallback(asIScriptEngine *engine, asIScriptContext *ctx, void* /*param*/);
+unsigned int context_pool_prewarm(unsigned int count);
+void context_pool_clear();
 void ExceptionHandlerCallback(asIScriptContext *ctx, void* obj);
 
 using namespace std;
@@ -109,8 +116,6 @@ CContextMgr* g_ctxMgr = nullptr;
 #endif
 int g_bcCompressionLevel = 9;
 string g_last_exception_callstack;
-vector<asIScriptContext*> g_ctxPool;
-Mutex g_ctxPoolMutex;
 vector<string> g_IncludeDirs;
 vector<string> g_IncludeScripts;
 std::string g_CommandLine;
@@ -129,9 +134,78 @@ std::string g_platform = "auto";
 bool g_make_console = false;
 std::unordered_map<std::string, asITypeInfo*> g_TypeInfoCache;
 Timestamp g_script_build_time;
+bool g_native_calling_convention = false;
 unordered_map<string, string> g_system_namespaces;
 vector<string> g_pending_plugins;
 
+// Script contexts are requested and returned constantly from any thread that calls into the script, so rather than having every thread fight over one mutex we keep a few contexts cached per thread and back those caches with a bounded lock-free queue (Dmitry Vyukov's MPMC design) that threads exchange contexts through.
+template <class T, size_t capacity> class lockfree_pool {
+	static_assert((capacity & (capacity - 1)) == 0, "lockfree_pool capacity must be a power of 2");
+	struct cell {
+		std::atomic<size_t> sequence;
+		T data;
+	};
+	cell cells[capacity];
+	alignas(64) std::atomic<size_t> enqueue_pos;
+	alignas(64) std::atomic<size_t> dequeue_pos;
+public:
+	lockfree_pool() : enqueue_pos(0), dequeue_pos(0) {
+		for (size_t i = 0; i < capacity; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	bool push(T data) {
+		cell* c;
+		size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+		while (true) {
+			c = &cells[pos & (capacity - 1)];
+			intptr_t diff = intptr_t(c->sequence.load(std::memory_order_acquire)) - intptr_t(pos);
+			if (diff == 0 && enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			else if (diff < 0) return false; // full
+			else if (diff > 0) pos = enqueue_pos.load(std::memory_order_relaxed);
+		}
+		c->data = data;
+		c->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+	bool pop(T& data) {
+		cell* c;
+		size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+		while (true) {
+			c = &cells[pos & (capacity - 1)];
+			intptr_t diff = intptr_t(c->sequence.load(std::memory_order_acquire)) - intptr_t(pos + 1);
+			if (diff == 0 && dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			else if (diff < 0) return false; // empty
+			else if (diff > 0) pos = dequeue_pos.load(std::memory_order_relaxed);
+		}
+		data = c->data;
+		c->sequence.store(pos + capacity, std::memory_order_release);
+		return true;
+	}
+};
+lockfree_pool<asIScriptContext*, 1024> g_ctxPool;
+std::atomic<UInt64> g_ctxPoolThreadHits(0), g_ctxPoolHits(0), g_ctxPoolMisses(0);
+std::atomic<bool> g_ctxPoolClosed(false); // Set by context_pool_clear at engine shutdown, after which nothing will ever take contexts back out of the global pool.
+// Pushes a context into the global pool, or releases it if the pool is full or already closed.
+void context_pool_give(asIScriptContext* ctx) {
+	if (g_ctxPoolClosed.load() || !g_ctxPool.push(ctx)) {
+		ctx->Release();
+		return;
+	}
+	// context_pool_clear may have drained the pool between our check and the push.
+	if (g_ctxPoolClosed.load()) {
+		while (g_ctxPool.pop(ctx)) ctx->Release();
+	}
+}
+struct context_thread_cache {
+	static const int capacity = 4;
+	asIScriptContext* contexts[capacity];
+	int count = 0;
+	~context_thread_cache() {
+		// The thread is exiting, hand our contexts to threads that are still alive, or release them directly when the engine has already shut down.
+		while (count > 0) context_pool_give(contexts[--count]);
+	}
+};
+thread_local context_thread_cache t_ctxCache;
+
 class NVGTBytecodeStream : public asIBinaryStream {
 	unsigned char* content;
 	z_stream zstr;
@@ -408,6 +482,14 @@ inline void system_namespace(const string& system = "") {
 int PreconfigureEngine(asIScriptEngine* engine) {
 	// This part of engine configuration happens right at program launch, where as everything else is deferred until after the script loads so that the script can influence how the engine is configured. Separation needed because for example a CScriptArray is created during command line argument processing at which time the array addon must have been registered.
 	engine->SetMessageCallback(asFUNCTION(MessageCallback), 0, asCALL_CDECL);
+	// Addons such as the array, string and dictionary pick between native and generic registrations at runtime depending on how the Angelscript library was compiled, the generic variants adding measurable overhead to every call.
+	g_native_calling_convention = strstr(asGetLibraryOptions(), "AS_MAX_PORTABILITY") == nullptr;
+	#ifdef NVGT_NATIVE_CALLS_ONLY
+		if (!g_native_calling_convention) {
+			engine->WriteMessage("nvgt", 0, 0, asMSGTYPE_ERROR, "this build requires native calling conventions, but the linked Angelscript library was compiled with AS_MAX_PORTABILITY");
+			return -1;
+		}
+	#endif
 	engine->SetTranslateAppExceptionCallback(asFUNCTION(TranslateException), 0, asCALL_CDECL);
 	engine->SetEngineProperty(asEP_ALLOW_UNSAFE_REFERENCES, true);
 	engine->SetEngineProperty(asEP_INIT_GLOBAL_VARS_AFTER_BUILD, false);
@@ -684,6 +766,7 @@ int SaveCompiledScript(asIScriptEngine *engine, unsigned char** output) {
 		bw.write7BitEncoded(UInt64(engine->GetEngineProperty(asEEngineProp(i))));
 	bw << Timestamp().raw();
 	bw << Application::instance().config().has("app.no_auto_chdir");
+	bw.write7BitEncoded(UInt32(Application::instance().config().getInt("scripting.context_pool_prewarm", 0)));
 	if (mod->SaveByteCode(&codestream, !g_debug) < 0)
 		return -1;
 	return codestream.get(output);
@@ -776,6 +859,9 @@ int LoadCompiledScript(asIScriptEngine *engine, unsigned char* code, asUINT size
 	bool no_auto_chdir;
 	br >> no_auto_chdir;
 	if (no_auto_chdir) Application::instance().config().setString("app.no_auto_chdir", "");
+	UInt32 context_prewarm;
+	br.read7BitEncoded(context_prewarm);
+	if (context_prewarm) Application::instance().config().setInt("scripting.context_pool_prewarm", context_prewarm);
 	codestream.reset_cursor(); // Angelscript can produce bytecode load failures as a result of user misconfigurations or bugs, and such failures only include an offset of bytes read maintained by Angelscript internally. The solution in such cases is to breakpoint NVGTBytecodeStream::Read if cursor is greater than the offset given, then one can get more debug info. For that to work, we make sure that the codestream's variable that tracks number of bytes written does not include the count of those written by engine properties, plugins etc. We could theoretically store such data at the end of the stream instead of the beginning and avoid this, but then we are trusting Angelscript to read exactly the number of bytes it's written, and since I don't know how much of a gamble that is, I opted for this instead.
 	if (mod->LoadByteCode(&codestream, &g_debug) < 0)
 		return -1;
@@ -860,6 +946,7 @@ int ExecuteScript(asIScriptEngine *engine, const string &scriptFile) {
 	}
 	ShowAngelscriptMessages(); // Display any warnings or extra info if the user has asked for it.
 	g_initialising_globals = false;
+	context_pool_prewarm(Application::instance().config().getInt("scripting.context_pool_prewarm", 0));
 	ctx = g_ctxMgr->AddContext(engine, func, true);
 	#ifndef NVGT_STUB
 	if (g_dbg) {
@@ -901,11 +988,13 @@ int ExecuteScript(asIScriptEngine *engine, const string &scriptFile) {
 			g_ctxMgr->DoneWithContext(ctx);
 		}
 	}
+	task_scheduler_shutdown();
+	physics_shutdown();
 	if (g_ctxMgr) {
 		delete g_ctxMgr;
 		g_ctxMgr = 0;
 	}
-	g_ctxPool.clear();
+	context_pool_clear();
 	mod->Discard();
 	engine->GarbageCollect();
 	return retcode;
@@ -1073,29 +1162,55 @@ void asDebuggerAddFileBreakpoint(const std::string &file, int line) {}
 void asDebuggerAddFuncBreakpoint(const std::string &func) {}
 #endif
 
+asIScriptContext* create_pooled_context(asIScriptEngine* engine) {
+	asIScriptContext* ctx = engine->CreateContext();
+	if (!ctx) return nullptr;
+	ctx->SetExceptionCallback(asFUNCTION(ExceptionHandlerCallback), NULL, asCALL_CDECL);
+	ctx->SetLineCallback(asFUNCTION(nvgt_line_callback), NULL, asCALL_CDECL);
+	return ctx;
+}
 asIScriptContext* RequestContextCallback(asIScriptEngine *engine, void* /*param*/) {
 	asIScriptContext *ctx = 0;
-	int pool_size = 0;
-	{
-		ScopedLock<Mutex> l(g_ctxPoolMutex);
-		pool_size = g_ctxPool.size();
-		if (pool_size) {
-			ctx = g_ctxPool.back();
-			g_ctxPool.pop_back();
-		}
+	context_thread_cache& cache = t_ctxCache;
+	if (cache.count > 0) {
+		g_ctxPoolThreadHits.fetch_add(1, std::memory_order_relaxed);
+		return cache.contexts[--cache.count];
 	}
-	if (!pool_size) {
-		ctx = engine->CreateContext();
-		ctx->SetExceptionCallback(asFUNCTION(ExceptionHandlerCallback), NULL, asCALL_CDECL);
-		ctx->SetLineCallback(asFUNCTION(nvgt_line_callback), NULL, asCALL_CDECL);
+	if (g_ctxPool.pop(ctx)) {
+		g_ctxPoolHits.fetch_add(1, std::memory_order_relaxed);
+		return ctx;
 	}
-	return ctx;
+	g_ctxPoolMisses.fetch_add(1, std::memory_order_relaxed);
+	return create_pooled_context(engine);
 }
 void ReturnContextCallback(asIScriptEngine *engine, asIScriptContext *ctx, void* /*param*/) {
 	ctx->Unprepare();
-	ScopedLock<Mutex> l(g_ctxPoolMutex);
-	g_ctxPool.push_back(ctx);
+	context_thread_cache& cache = t_ctxCache;
+	if (cache.count < context_thread_cache::capacity) cache.contexts[cache.count++] = ctx;
+	else context_pool_give(ctx); // Released when the global pool is full, which means many more contexts were created during a burst than are ever likely to be needed again.
+}
+// Creates contexts ahead of time so that the first calls into the script from many threads at once need not create them, returns the number of contexts actually created.
+unsigned int context_pool_prewarm(unsigned int count) {
+	unsigned int created = 0;
+	for (; created < count; created++) {
+		asIScriptContext* ctx = create_pooled_context(g_ScriptEngine);
+		if (!ctx) break;
+		if (!g_ctxPool.push(ctx)) {
+			ctx->Release();
+			break;
+		}
+	}
+	return created;
+}
+void context_pool_clear() {
+	asIScriptContext* ctx;
+	g_ctxPoolClosed.store(true);
+	while (t_ctxCache.count > 0) t_ctxCache.contexts[--t_ctxCache.count]->Release();
+	while (g_ctxPool.pop(ctx)) ctx->Release();
 }
+UInt64 get_context_pool_thread_hits() { return g_ctxPoolThreadHits; }
+UInt64 get_context_pool_hits() { return g_ctxPoolHits; }
+UInt64 get_context_pool_misses() { return g_ctxPoolMisses; }
 void ExceptionHandlerCallback(asIScriptContext *ctx, void* obj) {
 	g_last_exception_callstack = get_call_stack();
 }
@@ -1128,7 +1243,12 @@ void RegisterUnsorted(asIScriptEngine *engine) {
 	engine->RegisterGlobalFunction("void debug_break()", asFUNCTION(asDebugBreak), asCALL_CDECL);
 	engine->RegisterGlobalFunction("void debug_add_file_breakpoint(const string&in, int)", asFUNCTION(asDebuggerAddFileBreakpoint), asCALL_CDECL);
 	engine->RegisterGlobalFunction("void debug_add_func_breakpoint(const string&in)", asFUNCTION(asDebuggerAddFuncBreakpoint), asCALL_CDECL);
+	engine->RegisterGlobalFunction("uint script_context_pool_prewarm(uint count)", asFUNCTION(context_pool_prewarm), asCALL_CDECL);
+	engine->RegisterGlobalFunction("uint64 get_script_context_pool_thread_hits() property", asFUNCTION(get_context_pool_thread_hits), asCALL_CDECL);
+	engine->RegisterGlobalFunction("uint64 get_script_context_pool_hits() property", asFUNCTION(get_context_pool_hits), asCALL_CDECL);
+	engine->RegisterGlobalFunction("uint64 get_script_context_pool_misses() property", asFUNCTION(get_context_pool_misses), asCALL_CDECL);
 	engine->RegisterGlobalProperty("const string[]@ ARGS", &g_command_line_args);
 	engine->RegisterGlobalProperty("const timestamp SCRIPT_BUILD_TIME", &g_script_build_time);
+	engine->RegisterGlobalProperty("const bool SCRIPT_NATIVE_CALLING_CONVENTION", &g_native_calling_convention);
 	//engine->RegisterObjectMethod("dictionary", "bool get(const string&in key, string&out value) const", asFUNCTION(script_dictionary_get_string), asCALL_CDECL_OBJFIRST);
 }
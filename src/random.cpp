@@ -142,6 +142,72 @@ void* rnd_xorshift_choice(CScriptArray* array, rnd_xorshift_t* r) {
 	return array->At(rnd_xorshift_range(r, 0, array->GetSize() - 1));
 }
 
+// Bulk fills into arrays or raw memory, one native call for any number of values.
+static bool random_fill_check(CScriptArray* values) {
+	if (values) return true;
+	asIScriptContext* ctx = asGetActiveContext();
+	if (ctx) ctx->SetException("Cannot fill a null array");
+	return false;
+}
+void random_fill(CScriptArray* values, random_interface* rng) {
+	if (!random_fill_check(values)) return;
+	rng->fill(static_cast<uint32*>(values->GetBuffer()), values->GetSize());
+}
+void random_fill_float(CScriptArray* values, float min, float max, random_interface* rng) {
+	if (!random_fill_check(values)) return;
+	rng->fill_float(static_cast<float*>(values->GetBuffer()), values->GetSize(), min, max);
+}
+void random_fill_range(CScriptArray* values, int min, int max, random_interface* rng) {
+	if (!random_fill_check(values)) return;
+	rng->fill_range(static_cast<int32*>(values->GetBuffer()), values->GetSize(), min, max);
+}
+void random_fill_normal(CScriptArray* values, float mean, float deviation, random_interface* rng) {
+	if (!random_fill_check(values)) return;
+	rng->fill_normal(static_cast<float*>(values->GetBuffer()), values->GetSize(), mean, deviation);
+}
+void random_fill_weighted(CScriptArray* values, CScriptArray* weights, random_interface* rng) {
+	if (!random_fill_check(values) || !random_fill_check(weights)) return;
+	if (!rng->fill_weighted(static_cast<int32*>(values->GetBuffer()), values->GetSize(), static_cast<const float*>(weights->GetBuffer()), weights->GetSize())) {
+		asIScriptContext* ctx = asGetActiveContext();
+		if (ctx) ctx->SetException("At least one weight must be positive");
+	}
+}
+void random_fill_address(asQWORD address, asUINT count, random_interface* rng) {
+	rng->fill(reinterpret_cast<uint32*>(address), count);
+}
+void random_fill_float_address(asQWORD address, asUINT count, float min, float max, random_interface* rng) {
+	rng->fill_float(reinterpret_cast<float*>(address), count, min, max);
+}
+void random_fill_range_address(asQWORD address, asUINT count, int min, int max, random_interface* rng) {
+	rng->fill_range(reinterpret_cast<int32*>(address), count, min, max);
+}
+// The same operations on the default generator.
+void random_fill_default(CScriptArray* values, int min, int max) {
+	random_fill_range(values, min, max, get_default_random());
+}
+void random_fill_float_default(CScriptArray* values, float min, float max) {
+	random_fill_float(values, min, max, get_default_random());
+}
+void random_fill_normal_default(CScriptArray* values, float mean, float deviation) {
+	random_fill_normal(values, mean, deviation, get_default_random());
+}
+void random_fill_weighted_default(CScriptArray* values, CScriptArray* weights) {
+	random_fill_weighted(values, weights, get_default_random());
+}
+// All generator types share these, as they only call virtual methods of random_interface.
+static void RegisterRandomFill(asIScriptEngine* engine, const std::string& type) {
+	engine->RegisterObjectMethod(type.c_str(), _O("void fill(uint[]@ values)"), asFUNCTION(random_fill), asCALL_CDECL_OBJLAST);
+	engine->RegisterObjectMethod(type.c_str(), _O("void fill_float(float[]@ values, float min = 0, float max = 1)"), asFUNCTION(random_fill_float), asCALL_CDECL_OBJLAST);
+	engine->RegisterObjectMethod(type.c_str(), _O("void fill_range(int[]@ values, int min, int max)"), asFUNCTION(random_fill_range), asCALL_CDECL_OBJLAST);
+	engine->RegisterObjectMethod(type.c_str(), _O("void fill_normal(float[]@ values, float mean = 0, float deviation = 1)"), asFUNCTION(random_fill_normal), asCALL_CDECL_OBJLAST);
+	engine->RegisterObjectMethod(type.c_str(), _O("void fill_weighted(int[]@ values, const float[]@ weights)"), asFUNCTION(random_fill_weighted), asCALL_CDECL_OBJLAST);
+	engine->SetDefaultAccessMask(NVGT_SUBSYSTEM_RAW_MEMORY);
+	engine->RegisterObjectMethod(type.c_str(), _O("void fill(uint64 address, uint count)"), asFUNCTION(random_fill_address), asCALL_CDECL_OBJLAST);
+	engine->RegisterObjectMethod(type.c_str(), _O("void fill_float(uint64 address, uint count, float min = 0, float max = 1)"), asFUNCTION(random_fill_float_address), asCALL_CDECL_OBJLAST);
+	engine->RegisterObjectMethod(type.c_str(), _O("void fill_range(uint64 address, uint count, int min, int max)"), asFUNCTION(random_fill_range_address), asCALL_CDECL_OBJLAST);
+	engine->SetDefaultAccessMask(NVGT_SUBSYSTEM_GENERAL);
+}
+
 // Cast function for random generators to the base interface
 template <typename T>
 random_interface* random_cast_to(T* obj) {
@@ -161,7 +227,7 @@ void RegisterScriptRandom(asIScriptEngine* engine) {
 	engine->RegisterGlobalFunction(_O("string random_get_state()"), asFUNCTION(random_get_state), asCALL_CDECL);
 	engine->RegisterGlobalFunction(_O("uint random_seed()"), asFUNCTION(random_seed), asCALL_CDECL);
 	engine->RegisterGlobalFunction(_O("uint64 random_seed64()"), asFUNCTION(random_seed64), asCALL_CDECL);
-	engine->RegisterGlobalFunction(_O("int random(int, int)"), WRAP_FN_PR(random, (int, int), int), asCALL_GENERIC);
+	engine->RegisterGlobalFunction(_O("int random(int, int)"), asFUNCTIONPR(random, (int, int), int), asCALL_CDECL);
 	engine->RegisterGlobalFunction(_O("int64 random64(int64, int64)"), asFUNCTION(random64), asCALL_CDECL);
 	engine->RegisterGlobalFunction(_O("float random_float()"), asFUNCTION(random_float), asCALL_CDECL);
 	engine->RegisterGlobalFunction(_O("bool random_bool(int = 50)"), asFUNCTION(random_bool), asCALL_CDECL);
@@ -187,8 +253,8 @@ void RegisterScriptRandom(asIScriptEngine* engine) {
 	engine->RegisterGlobalFunction(_O("random_interface@ get_default_random()"), asFUNCTION(get_default_random), asCALL_CDECL);
 	engine->RegisterGlobalFunction(_O("void set_default_random(random_interface@)"), asFUNCTION(set_default_random), asCALL_CDECL);
 	engine->RegisterGlobalFunction(_O("void set_default_random(random_generator@)"), asFUNCTION(set_default_random_script), asCALL_CDECL);
-	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random() const"), WRAP_OBJ_FIRST(random_choice), asCALL_GENERIC);
-	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random(random_interface@ rng) const"), WRAP_OBJ_FIRST(random_array_choice), asCALL_GENERIC);
+	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random() const"), asFUNCTION(random_choice), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random(random_interface@ rng) const"), asFUNCTION(random_array_choice), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random(random_generator@ rng) const"), WRAP_OBJ_FIRST(random_script_array_choice), asCALL_GENERIC);
 	engine->RegisterObjectMethod(_O("array<T>"), _O("void shuffle()"), asFUNCTION(random_shuffle), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod(_O("array<T>"), _O("void shuffle(random_interface@ rng)"), asFUNCTION(random_array_shuffle), asCALL_CDECL_OBJFIRST);
@@ -267,8 +333,18 @@ void RegisterScriptRandom(asIScriptEngine* engine) {
 	engine->RegisterObjectMethod(_O("array<T>"), _O("void shuffle(random_gamerand@ generator)"), asFUNCTION(random_array_shuffle), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod(_O("array<T>"), _O("void shuffle(random_xorshift@ generator)"), asFUNCTION(random_array_shuffle), asCALL_CDECL_OBJFIRST);
 	// Keep old array methods for backward compatibility with existing generators
-	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random(const random_pcg&in generator) const"), WRAP_OBJ_FIRST(rnd_pcg_choice), asCALL_GENERIC);
-	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random(const random_well&in generator) const"), WRAP_OBJ_FIRST(rnd_well_choice), asCALL_GENERIC);
-	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random(const random_gamerand&in generator) const"), WRAP_OBJ_FIRST(rnd_gamerand_choice), asCALL_GENERIC);
-	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random(const random_xorshift&in generator) const"), WRAP_OBJ_FIRST(rnd_xorshift_choice), asCALL_GENERIC);
+	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random(const random_pcg&in generator) const"), asFUNCTION(rnd_pcg_choice), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random(const random_well&in generator) const"), asFUNCTION(rnd_well_choice), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random(const random_gamerand&in generator) const"), asFUNCTION(rnd_gamerand_choice), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(_O("array<T>"), _O("const T& random(const random_xorshift&in generator) const"), asFUNCTION(rnd_xorshift_choice), asCALL_CDECL_OBJFIRST);
+	// Bulk fills come last, as their signatures instantiate array types that would otherwise miss the array<T> methods above.
+	RegisterRandomFill(engine, "random_interface");
+	RegisterRandomFill(engine, "random_pcg");
+	RegisterRandomFill(engine, "random_well");
+	RegisterRandomFill(engine, "random_gamerand");
+	RegisterRandomFill(engine, "random_xorshift");
+	engine->RegisterGlobalFunction(_O("void random_fill(int[]@ values, int min, int max)"), asFUNCTION(random_fill_default), asCALL_CDECL);
+	engine->RegisterGlobalFunction(_O("void random_fill_float(float[]@ values, float min = 0, float max = 1)"), asFUNCTION(random_fill_float_default), asCALL_CDECL);
+	engine->RegisterGlobalFunction(_O("void random_fill_normal(float[]@ values, float mean = 0, float deviation = 1)"), asFUNCTION(random_fill_normal_default), asCALL_CDECL);
+	engine->RegisterGlobalFunction(_O("void random_fill_weighted(int[]@ values, const float[]@ weights)"), asFUNCTION(random_fill_weighted_default), asCALL_CDECL);
 }
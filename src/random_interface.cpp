@@ -18,6 +18,8 @@
 #include <rng_get_bytes.h>
 #include <scriptarray.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <sstream>
 #include <vector>
@@ -205,6 +207,95 @@ std::string random_interface::next_character(const std::string& min, const std::
 	return std::string(1, static_cast<char>(range(min[0], max[0])));
 }
 
+// Bulk generation
+// Matches the conversion rnd.h uses for nextf(), 23 random mantissa bits under a fixed exponent giving [1, 2) minus 1.
+static inline float32 unit_float(uint32 bits) {
+	bits = (bits >> 9) | 0x3f800000U;
+	float32 f;
+	memcpy(&f, &bits, sizeof(f));
+	return f - 1.0f;
+}
+
+// The bulk functions work through a small stack buffer of raw values at a time, so that generation and conversion each run as their own tight loop without allocating.
+static const size_t fill_chunk_size = 512;
+
+void random_interface::fill(uint32* out, size_t count) {
+	for (size_t i = 0; i < count; i++) out[i] = next();
+}
+
+void random_interface::fill_float(float32* out, size_t count, float32 min, float32 max) {
+	float32 scale = max - min;
+	uint32 bits[fill_chunk_size];
+	for (size_t done = 0; done < count;) {
+		size_t n = std::min(count - done, fill_chunk_size);
+		float32* dest = out + done;
+		if (fill_unit_bits(bits, n)) {
+			for (size_t i = 0; i < n; i++) dest[i] = unit_float(bits[i]) * scale + min;
+		} else {
+			for (size_t i = 0; i < n; i++) dest[i] = nextf() * scale + min;
+		}
+		done += n;
+	}
+}
+
+void random_interface::fill_range(int32* out, size_t count, int32 min, int32 max) {
+	// Same arithmetic as rnd.h's range functions, including returning min without consuming a value when the range is empty.
+	int32 range = static_cast<int32>(static_cast<uint32>(max) - static_cast<uint32>(min) + 1U);
+	if (range <= 0) {
+		std::fill(out, out + count, min);
+		return;
+	}
+	uint32 bits[fill_chunk_size];
+	for (size_t done = 0; done < count;) {
+		size_t n = std::min(count - done, fill_chunk_size);
+		int32* dest = out + done;
+		if (fill_unit_bits(bits, n)) {
+			for (size_t i = 0; i < n; i++) dest[i] = min + static_cast<int32>(unit_float(bits[i]) * range);
+		} else {
+			for (size_t i = 0; i < n; i++) dest[i] = this->range(min, max);
+		}
+		done += n;
+	}
+}
+
+void random_interface::fill_normal(float32* out, size_t count, float32 mean, float32 deviation) {
+	// Box-Muller transform, each pair of uniform values produces a pair of outputs. An odd count still consumes the whole last pair.
+	float32 uniform[fill_chunk_size];
+	for (size_t done = 0; done < count;) {
+		size_t pairs = std::min((count - done + 1) / 2, fill_chunk_size / 2);
+		fill_float(uniform, pairs * 2);
+		for (size_t p = 0; p < pairs; p++) {
+			double radius = std::sqrt(-2.0 * std::log(1.0 - uniform[p * 2]));
+			double angle = 6.283185307179586 * uniform[p * 2 + 1];
+			out[done++] = static_cast<float32>(mean + deviation * radius * std::cos(angle));
+			if (done < count) out[done++] = static_cast<float32>(mean + deviation * radius * std::sin(angle));
+		}
+	}
+}
+
+bool random_interface::fill_weighted(int32* out, size_t count, const float32* weights, size_t weight_count) {
+	// Each output is the index of a weight, chosen with probability proportional to it. Zero, negative and non-finite weights are never chosen.
+	std::vector<double> cumulative(weight_count);
+	double total = 0;
+	for (size_t i = 0; i < weight_count; i++) {
+		if (weights[i] > 0 && std::isfinite(weights[i])) total += weights[i];
+		cumulative[i] = total;
+	}
+	if (total <= 0) return false;
+	float32 uniform[fill_chunk_size];
+	for (size_t done = 0; done < count;) {
+		size_t n = std::min(count - done, fill_chunk_size);
+		fill_float(uniform, n);
+		for (size_t i = 0; i < n; i++) {
+			// The first cumulative value above the target is always a positive weight, as zero weights share their predecessor's value and the target is below the total.
+			size_t index = std::upper_bound(cumulative.begin(), cumulative.end(), uniform[i] * total) - cumulative.begin();
+			out[done + i] = static_cast<int32>(index);
+		}
+		done += n;
+	}
+	return true;
+}
+
 // PCG implementation
 random_pcg::random_pcg() : ref_count(1) {
 	seed(random_seed());
@@ -218,6 +309,40 @@ uint32 random_pcg::next() {
 	return rnd_pcg_next(&gen);
 }
 
+// PCG's state is a plain LCG, so it can be advanced 8 positions at once with a combined multiplier and increment. Running 8 such lanes side by side yields exactly the sequential output without each value waiting on the previous multiply, and leaves the compiler free to vectorize the loop.
+static inline uint32 pcg_output(uint64 state) {
+	uint32 xorshifted = static_cast<uint32>(((state >> 18) ^ state) >> 27);
+	uint32 rot = static_cast<uint32>(state >> 59);
+	return (xorshifted >> rot) | (xorshifted << ((-static_cast<int32>(rot)) & 31));
+}
+
+void random_pcg::fill(uint32* out, size_t count) {
+	const uint64 multiplier = 0x5851f42d4c957f2dULL, increment = gen.state[1];
+	size_t i = 0;
+	if (count >= 64) {
+		uint64 lanes[8], lane_multiplier = 1, lane_increment = 0;
+		lanes[0] = gen.state[0];
+		for (int l = 1; l < 8; l++) lanes[l] = lanes[l - 1] * multiplier + increment;
+		for (int l = 0; l < 8; l++) {
+			lane_increment = lane_increment * multiplier + increment;
+			lane_multiplier *= multiplier;
+		}
+		for (; i + 8 <= count; i += 8) {
+			for (int l = 0; l < 8; l++) {
+				out[i + l] = pcg_output(lanes[l]);
+				lanes[l] = lanes[l] * lane_multiplier + lane_increment;
+			}
+		}
+		gen.state[0] = lanes[0];
+	}
+	for (; i < count; i++) out[i] = rnd_pcg_next(&gen);
+}
+
+bool random_pcg::fill_unit_bits(uint32* out, size_t count) {
+	fill(out, count);
+	return true;
+}
+
 float32 random_pcg::nextf() {
 	return rnd_pcg_nextf(&gen);
 }
@@ -270,6 +395,15 @@ uint32 random_well::next() {
 	return rnd_well_next(&gen);
 }
 
+void random_well::fill(uint32* out, size_t count) {
+	for (size_t i = 0; i < count; i++) out[i] = rnd_well_next(&gen);
+}
+
+bool random_well::fill_unit_bits(uint32* out, size_t count) {
+	fill(out, count);
+	return true;
+}
+
 float32 random_well::nextf() {
 	return rnd_well_nextf(&gen);
 }
@@ -323,6 +457,15 @@ uint32 random_gamerand::next() {
 	return rnd_gamerand_next(&gen);
 }
 
+void random_gamerand::fill(uint32* out, size_t count) {
+	for (size_t i = 0; i < count; i++) out[i] = rnd_gamerand_next(&gen);
+}
+
+bool random_gamerand::fill_unit_bits(uint32* out, size_t count) {
+	fill(out, count);
+	return true;
+}
+
 float32 random_gamerand::nextf() {
 	return rnd_gamerand_nextf(&gen);
 }
@@ -378,6 +521,16 @@ uint32 random_xorshift::next() {
 	return static_cast<uint32>(rnd_xorshift_next(&gen));
 }
 
+void random_xorshift::fill(uint32* out, size_t count) {
+	for (size_t i = 0; i < count; i++) out[i] = static_cast<uint32>(rnd_xorshift_next(&gen));
+}
+
+bool random_xorshift::fill_unit_bits(uint32* out, size_t count) {
+	// nextf() is derived from the upper half of each 64 bit value where next() returns the lower half.
+	for (size_t i = 0; i < count; i++) out[i] = static_cast<uint32>(rnd_xorshift_next(&gen) >> 32);
+	return true;
+}
+
 int64 random_xorshift::next64() {
 	return static_cast<int64>(rnd_xorshift_next(&gen));
 }
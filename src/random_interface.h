@@ -14,6 +14,7 @@
 
 #include <rnd.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -57,6 +58,17 @@ public:
 	// Utility functions (with default implementations)
 	virtual bool next_bool(int32 percent = 50);
 	virtual std::string next_character(const std::string& min, const std::string& max);
+
+	// Bulk generation into preallocated memory. These produce exactly the values that the same number of next(), nextf() or range() calls would and leave the generator in the same state afterwards, so a seeded sequence comes out the same however it is consumed. fill_normal consumes two nextf() values per pair of outputs and fill_weighted one per output.
+	virtual void fill(uint32* out, size_t count);
+	void fill_float(float32* out, size_t count, float32 min = 0.0f, float32 max = 1.0f);
+	void fill_range(int32* out, size_t count, int32 min, int32 max);
+	void fill_normal(float32* out, size_t count, float32 mean = 0.0f, float32 deviation = 1.0f);
+	bool fill_weighted(int32* out, size_t count, const float32* weights, size_t weight_count); // Returns false if no weight is positive.
+
+protected:
+	// Generators implemented in C++ override this to write the raw values that nextf() and range() are derived from, which the bulk functions then convert in a separate loop that the compiler can vectorize. Returning false makes them call nextf() or range() once per value instead.
+	virtual bool fill_unit_bits(uint32* out, size_t count) { return false; }
 };
 
 class script_random_wrapper;
@@ -71,6 +83,7 @@ public:
 	random_pcg();
 	random_pcg(uint32 s);
 	uint32 next() override;
+	void fill(uint32* out, size_t count) override;
 	float32 nextf() override;
 	int32 range(int32 min, int32 max) override;
 	void seed(uint32 s) override;
@@ -78,6 +91,9 @@ public:
 	bool set_state(const std::string& state) override;
 	void add_ref() override;
 	void release() override;
+
+protected:
+	bool fill_unit_bits(uint32* out, size_t count) override;
 };
 
 class random_well : public random_interface {
@@ -89,6 +105,7 @@ public:
 	random_well();
 	random_well(uint32 s);
 	uint32 next() override;
+	void fill(uint32* out, size_t count) override;
 	float32 nextf() override;
 	int32 range(int32 min, int32 max) override;
 	void seed(uint32 s) override;
@@ -96,6 +113,9 @@ public:
 	bool set_state(const std::string& state) override;
 	void add_ref() override;
 	void release() override;
+
+protected:
+	bool fill_unit_bits(uint32* out, size_t count) override;
 };
 
 class random_gamerand : public random_interface {
@@ -107,6 +127,7 @@ public:
 	random_gamerand();
 	random_gamerand(uint32 s);
 	uint32 next() override;
+	void fill(uint32* out, size_t count) override;
 	float32 nextf() override;
 	int32 range(int32 min, int32 max) override;
 	void seed(uint32 s) override;
@@ -114,6 +135,9 @@ public:
 	bool set_state(const std::string& state) override;
 	void add_ref() override;
 	void release() override;
+
+protected:
+	bool fill_unit_bits(uint32* out, size_t count) override;
 };
 
 class random_xorshift : public random_interface {
@@ -125,6 +149,7 @@ public:
 	random_xorshift();
 	random_xorshift(uint64 s);
 	uint32 next() override;
+	void fill(uint32* out, size_t count) override;
 	int64 next64() override;
 	float32 nextf() override;
 	int32 range(int32 min, int32 max) override;
@@ -135,6 +160,9 @@ public:
 	bool set_state(const std::string& state) override;
 	void add_ref() override;
 	void release() override;
+
+protected:
+	bool fill_unit_bits(uint32* out, size_t count) override;
 };
 
 extern random_xorshift* g_random_xorshift;
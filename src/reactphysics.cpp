@@ -10,8 +10,15 @@
  * 3. This notice may not be removed or altered from any source distribution.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <angelscript.h>
 #include <reactphysics3d/reactphysics3d.h>
@@ -188,6 +195,294 @@ void world_test_collision(PhysicsWorld& world, asIScriptFunction* callback) {
 	world.testCollision(cb);
 }
 
+// Batched queries, which answer many questions about the world in one call and report the results in flat arrays instead of calling into script for every hit.
+class closest_hit_callback : public RaycastCallback {
+public:
+	Body* body;
+	Vector3 point;
+	Vector3 normal;
+	decimal fraction;
+	closest_hit_callback() : body(nullptr), fraction(-1) {}
+	decimal notifyRaycastHit(const RaycastInfo& info) override {
+		body = info.body;
+		point = info.worldPoint;
+		normal = info.worldNormal;
+		fraction = info.hitFraction;
+		return info.hitFraction; // Clip the ray here so that only closer hits get reported from now on.
+	}
+};
+
+unsigned int world_raycast_batch(PhysicsWorld& world, CScriptArray* rays, CScriptArray* bodies, CScriptArray* points, CScriptArray* normals, CScriptArray* fractions, unsigned short bits) {
+	if (!rays) throw runtime_error("raycast_batch requires an array of rays");
+	unsigned int count = rays->GetSize();
+	if (bodies) bodies->Resize(count);
+	if (points) points->Resize(count);
+	if (normals) normals->Resize(count);
+	if (fractions) fractions->Resize(count);
+	vector<closest_hit_callback> hits(count);
+	// Rays are cast one after another, raycasting allocates its traversal stack and triangle callbacks from the world's shared memory manager so it cannot safely run on several threads at once.
+	for (unsigned int i = 0; i < count; i++) world.raycast(*static_cast<const Ray*>(rays->At(i)), &hits[i], bits);
+	unsigned int hit_count = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		const closest_hit_callback& hit = hits[i];
+		if (hit.body) hit_count++;
+		if (bodies) bodies->SetValue(i, (void*)&hit.body);
+		if (points) *static_cast<Vector3*>(points->At(i)) = hit.point;
+		if (normals) *static_cast<Vector3*>(normals->At(i)) = hit.normal;
+		if (fractions) *static_cast<float*>(fractions->At(i)) = hit.fraction;
+	}
+	return hit_count;
+}
+
+class overlap_collector : public OverlapCallback {
+public:
+	Body* query;
+	unordered_set<Body*> found;
+	vector<Body*> results;
+	overlap_collector(Body* query) : query(query) {}
+	void onOverlap(OverlapCallback::CallbackData& data) override {
+		for (unsigned int i = 0; i < data.getNbOverlappingPairs(); i++) {
+			OverlapCallback::OverlapPair pair = data.getOverlappingPair(i);
+			Body* other = pair.getBody1() == query? pair.getBody2() : pair.getBody1();
+			if (found.insert(other).second) results.push_back(other);
+		}
+	}
+};
+
+unsigned int world_test_overlap_batch(PhysicsWorld& world, CScriptArray* queries, CScriptArray* overlapping, CScriptArray* offsets) {
+	if (!queries || !overlapping || !offsets) throw runtime_error("test_overlap_batch requires query, result and offset arrays");
+	unsigned int count = queries->GetSize();
+	// Unlike raycasts, overlap tests run the narrow phase using state owned by the world, so these are always performed on the calling thread.
+	vector<Body*> results;
+	offsets->Resize(count + 1);
+	for (unsigned int i = 0; i < count; i++) {
+		*static_cast<unsigned int*>(offsets->At(i)) = results.size();
+		Body* body = *static_cast<Body**>(queries->At(i));
+		if (!body) continue;
+		overlap_collector cb(body);
+		world.testOverlap(body, cb);
+		results.insert(results.end(), cb.results.begin(), cb.results.end());
+	}
+	*static_cast<unsigned int*>(offsets->At(count)) = results.size();
+	overlapping->Resize(results.size());
+	for (unsigned int i = 0; i < results.size(); i++) overlapping->SetValue(i, (void*)&results[i]);
+	return results.size();
+}
+
+// Optional background simulation, where a world steps itself at a fixed rate on its own thread. After every step the transforms of all rigid bodies are published into a pair of snapshots, which the script interpolates between so that motion stays smooth regardless of how the script's frame rate relates to the physics rate. Forces and velocity changes are queued and applied on the physics thread before the next step. Body properties take the simulation lock themselves, while world level calls made from script must hold it.
+class physics_stepper {
+	struct body_command {
+		RigidBody* body;
+		function<void(RigidBody*)> apply;
+	};
+	typedef unordered_map<Body*, Transform> transform_snapshot;
+	PhysicsWorld* world;
+	decimal time_step;
+	std::thread thread;
+	atomic<bool> running;
+	atomic<unsigned long long> steps;
+	mutex commands_mtx;
+	vector<body_command> commands;
+	mutable mutex snapshot_mtx;
+	transform_snapshot previous, current, next;
+	chrono::steady_clock::time_point last_step;
+	void publish() {
+		next.clear();
+		for (uint32 i = 0; i < world->getNbRigidBodies(); i++) {
+			RigidBody* body = world->getRigidBody(i);
+			next.emplace(body, body->getTransform());
+		}
+		unique_lock<mutex> lock(snapshot_mtx);
+		previous.swap(current);
+		current.swap(next); // next now holds the oldest snapshot and gets reused on the following step.
+		last_step = chrono::steady_clock::now();
+	}
+	void run() {
+		vector<body_command> pending;
+		chrono::steady_clock::duration interval = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(time_step));
+		chrono::steady_clock::time_point deadline = chrono::steady_clock::now();
+		while (running.load()) {
+			{
+				unique_lock<mutex> lock(commands_mtx);
+				pending.swap(commands);
+			}
+			{
+				lock_guard<recursive_mutex> lock(world_mtx);
+				for (body_command& c : pending) c.apply(c.body);
+				world->update(time_step);
+				publish();
+			}
+			pending.clear();
+			steps++;
+			deadline += interval;
+			chrono::steady_clock::time_point now = chrono::steady_clock::now();
+			if (now > deadline + interval * 4) deadline = now; // We fell far behind, perhaps the process was suspended; drop the missed steps instead of trying to catch up all at once.
+			else this_thread::sleep_until(deadline);
+		}
+	}
+public:
+	recursive_mutex world_mtx; // Held by the physics thread for the duration of each step.
+	physics_stepper(PhysicsWorld* world, decimal time_step) : world(world), time_step(time_step), running(true), steps(0) {
+		publish();
+		previous = current;
+		thread = std::thread(&physics_stepper::run, this);
+	}
+	~physics_stepper() {
+		running.store(false);
+		if (thread.joinable()) thread.join();
+	}
+	decimal get_time_step() const { return time_step; }
+	unsigned long long get_steps() const { return steps.load(); }
+	void queue(RigidBody* body, function<void(RigidBody*)> apply) {
+		unique_lock<mutex> lock(commands_mtx);
+		commands.push_back({body, std::move(apply)});
+	}
+	void forget(RigidBody* body) {
+		unique_lock<mutex> lock(commands_mtx);
+		commands.erase(remove_if(commands.begin(), commands.end(), [body](const body_command& c) { return c.body == body; }), commands.end());
+	}
+	decimal get_alpha() const {
+		unique_lock<mutex> lock(snapshot_mtx);
+		double elapsed = chrono::duration<double>(chrono::steady_clock::now() - last_step).count();
+		return decimal(clamp(elapsed / time_step, 0.0, 1.0));
+	}
+	bool get_transform(const Body* body, Transform& out) const {
+		unique_lock<mutex> lock(snapshot_mtx);
+		auto cur = current.find(const_cast<Body*>(body));
+		if (cur == current.end()) return false;
+		auto prev = previous.find(const_cast<Body*>(body));
+		double elapsed = chrono::duration<double>(chrono::steady_clock::now() - last_step).count();
+		decimal alpha = decimal(clamp(elapsed / time_step, 0.0, 1.0));
+		out = prev == previous.end()? cur->second : Transform::interpolateTransforms(prev->second, cur->second, alpha);
+		return true;
+	}
+};
+unordered_map<PhysicsWorld*, physics_stepper*> g_physics_steppers;
+unordered_map<const Body*, physics_stepper*> g_physics_stepped_bodies; // Lets body accessors find the simulation lock of the world they belong to.
+
+physics_stepper* world_get_stepper(const PhysicsWorld* world) {
+	auto it = g_physics_steppers.find(const_cast<PhysicsWorld*>(world));
+	return it == g_physics_steppers.end()? nullptr : it->second;
+}
+physics_stepper* body_get_stepper(const Body* body) {
+	if (g_physics_steppers.empty()) return nullptr;
+	auto it = g_physics_stepped_bodies.find(body);
+	return it == g_physics_stepped_bodies.end()? nullptr : it->second;
+}
+
+bool world_start_background_simulation(PhysicsWorld* world, decimal time_step) {
+	if (time_step <= 0) throw runtime_error("time step must be greater than 0");
+	if (world_get_stepper(world)) return false;
+	// Event listener callbacks would execute script code on the physics thread.
+	if (g_physics_event_listeners.contains(world)) throw runtime_error("cannot simulate in the background while collision callbacks are set");
+	physics_stepper* stepper = new physics_stepper(world, time_step);
+	g_physics_steppers[world] = stepper;
+	for (uint32 i = 0; i < world->getNbRigidBodies(); i++) g_physics_stepped_bodies[world->getRigidBody(i)] = stepper;
+	return true;
+}
+
+bool world_stop_background_simulation(PhysicsWorld* world) {
+	physics_stepper* stepper = world_get_stepper(world);
+	if (!stepper) return false;
+	delete stepper;
+	g_physics_steppers.erase(world);
+	for (uint32 i = 0; i < world->getNbRigidBodies(); i++) g_physics_stepped_bodies.erase(world->getRigidBody(i));
+	return true;
+}
+
+// Stops every background simulation, must happen before the engine exits so that no physics thread is still stepping a world while the global PhysicsCommon is being destroyed.
+void physics_shutdown() {
+	for (auto& s : g_physics_steppers) delete s.second;
+	g_physics_steppers.clear();
+	g_physics_stepped_bodies.clear();
+}
+
+// Body properties registered from script read and write component data that the physics thread updates during each step, so while the body's world is simulated in the background those calls happen under the simulation lock. Anything returned by reference is copied while the lock is still held.
+template <auto method> struct stepper_guarded;
+template <class C, typename R, typename... A, R (C::*method)(A...)> struct stepper_guarded<method> {
+	static remove_cvref_t<R> call(C* body, A... args) {
+		physics_stepper* stepper = body_get_stepper(body);
+		if (!stepper) return (body->*method)(args...);
+		lock_guard<recursive_mutex> lock(stepper->world_mtx);
+		return (body->*method)(args...);
+	}
+};
+template <class C, typename R, typename... A, R (C::*method)(A...) const> struct stepper_guarded<method> {
+	static remove_cvref_t<R> call(const C* body, A... args) {
+		physics_stepper* stepper = body_get_stepper(body);
+		if (!stepper) return (body->*method)(args...);
+		lock_guard<recursive_mutex> lock(stepper->world_mtx);
+		return (body->*method)(args...);
+	}
+};
+
+bool world_get_background_simulation(const PhysicsWorld* world) { return world_get_stepper(world) != nullptr; }
+
+bool world_lock_simulation(PhysicsWorld* world) {
+	physics_stepper* stepper = world_get_stepper(world);
+	if (!stepper) return false;
+	stepper->world_mtx.lock();
+	return true;
+}
+
+void world_unlock_simulation(PhysicsWorld* world) {
+	physics_stepper* stepper = world_get_stepper(world);
+	if (stepper) stepper->world_mtx.unlock();
+}
+
+void world_update(PhysicsWorld* world, decimal time_step) {
+	if (world_get_stepper(world)) throw runtime_error("this world is being simulated in the background");
+	world->update(time_step);
+}
+
+RigidBody* world_create_rigid_body(PhysicsWorld* world, const Transform& transform) {
+	physics_stepper* stepper = world_get_stepper(world);
+	if (!stepper) return world->createRigidBody(transform);
+	lock_guard<recursive_mutex> lock(stepper->world_mtx); // The body is created between steps, and shows up in the published transforms after the next one.
+	RigidBody* body = world->createRigidBody(transform);
+	g_physics_stepped_bodies[body] = stepper;
+	return body;
+}
+
+Transform world_get_interpolated_transform(const PhysicsWorld* world, const Body* body) {
+	if (!body) throw runtime_error("body cannot be null");
+	physics_stepper* stepper = world_get_stepper(world);
+	Transform result;
+	if (stepper && stepper->get_transform(body, result)) return result;
+	if (!stepper) return body->getTransform();
+	lock_guard<recursive_mutex> lock(stepper->world_mtx);
+	return body->getTransform();
+}
+
+decimal world_get_interpolation_alpha(const PhysicsWorld* world) {
+	physics_stepper* stepper = world_get_stepper(world);
+	return stepper? stepper->get_alpha() : 1;
+}
+
+decimal world_get_background_time_step(const PhysicsWorld* world) {
+	physics_stepper* stepper = world_get_stepper(world);
+	return stepper? stepper->get_time_step() : 0;
+}
+
+unsigned long long world_get_background_steps(const PhysicsWorld* world) {
+	physics_stepper* stepper = world_get_stepper(world);
+	return stepper? stepper->get_steps() : 0;
+}
+
+// Queued body commands are applied right away when the world isn't being simulated in the background.
+void world_queue_command(PhysicsWorld* world, RigidBody* body, function<void(RigidBody*)> apply) {
+	if (!body) throw runtime_error("body cannot be null");
+	physics_stepper* stepper = world_get_stepper(world);
+	if (stepper) stepper->queue(body, std::move(apply));
+	else apply(body);
+}
+void world_queue_force(PhysicsWorld* world, RigidBody* body, const Vector3& force) { world_queue_command(world, body, [force](RigidBody* b) { b->applyWorldForceAtCenterOfMass(force); }); }
+void world_queue_force_at_point(PhysicsWorld* world, RigidBody* body, const Vector3& force, const Vector3& point) { world_queue_command(world, body, [force, point](RigidBody* b) { b->applyWorldForceAtWorldPosition(force, point); }); }
+void world_queue_torque(PhysicsWorld* world, RigidBody* body, const Vector3& torque) { world_queue_command(world, body, [torque](RigidBody* b) { b->applyWorldTorque(torque); }); }
+void world_queue_linear_velocity(PhysicsWorld* world, RigidBody* body, const Vector3& velocity) { world_queue_command(world, body, [velocity](RigidBody* b) { b->setLinearVelocity(velocity); }); }
+void world_queue_angular_velocity(PhysicsWorld* world, RigidBody* body, const Vector3& velocity) { world_queue_command(world, body, [velocity](RigidBody* b) { b->setAngularVelocity(velocity); }); }
+void world_queue_transform(PhysicsWorld* world, RigidBody* body, const Transform& transform) { world_queue_command(world, body, [transform](RigidBody* b) { b->setTransform(transform); }); }
+
 void world_destroy_listener(PhysicsWorld* world) {
 	if (!g_physics_event_listeners.contains(world)) return;
 	event_listener* l = g_physics_event_listeners[world];
@@ -198,12 +493,14 @@ void world_destroy_listener(PhysicsWorld* world) {
 }
 
 void world_set_callbacks(PhysicsWorld* world, asIScriptFunction* on_contact, asIScriptFunction* on_overlap) {
+	if (world_get_stepper(world)) throw runtime_error("cannot set collision callbacks while the world is simulated in the background");
 	world_destroy_listener(world);
 	g_physics_event_listeners[world] = new event_listener(on_contact, on_overlap);
 	world->setEventListener(g_physics_event_listeners[world]);
 }
 
 void world_destroy(PhysicsWorld* world) {
+	world_stop_background_simulation(world);
 	world_destroy_listener(world);
 	g_physics.destroyPhysicsWorld(world);
 }
@@ -615,6 +912,15 @@ CScriptAny* body_get_user_data(Body* body) {
 
 // Must have this, otherwise we leak memory
 void world_destroy_rigid_body(PhysicsWorld* world, RigidBody* body) {
+	physics_stepper* stepper = world_get_stepper(world);
+	if (!stepper) {
+		body_cleanup_user_data(body);
+		world->destroyRigidBody(body);
+		return;
+	}
+	lock_guard<recursive_mutex> lock(stepper->world_mtx);
+	stepper->forget(body);
+	g_physics_stepped_bodies.erase(body);
 	body_cleanup_user_data(body);
 	world->destroyRigidBody(body);
 }
@@ -733,27 +1039,27 @@ void RegisterPhysicsBody(asIScriptEngine* engine, const string& type) {
 	engine->RegisterObjectBehaviour(type.c_str(), asBEHAVE_ADDREF, "void f()", asFUNCTION(no_refcount), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectBehaviour(type.c_str(), asBEHAVE_RELEASE, "void f()", asFUNCTION(no_refcount), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod(type.c_str(), "physics_entity get_entity() const property", asMETHOD(T, getEntity), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "bool get_is_active() const property", asMETHOD(T, isActive), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "void set_is_active(bool is_active) property", asMETHOD(T, setIsActive), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "const physics_transform& get_transform() const property", asMETHOD(T, getTransform), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "void set_transform(const physics_transform&in transform) property", asMETHOD(T, setTransform), asCALL_THISCALL);
+	engine->RegisterObjectMethod(type.c_str(), "bool get_is_active() const property", asFUNCTION(stepper_guarded<&T::isActive>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "void set_is_active(bool is_active) property", asFUNCTION(stepper_guarded<&T::setIsActive>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "physics_transform get_transform() const property", asFUNCTION(stepper_guarded<&T::getTransform>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "void set_transform(const physics_transform&in transform) property", asFUNCTION(stepper_guarded<&T::setTransform>::call), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod(
 	    type.c_str(),
 	    "physics_collider@ add_collider(physics_collision_shape@ shape, const physics_transform&in transform)",
-	    asMETHOD(T, addCollider),
-	    asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "void remove_collider(physics_collider&in collider)", asMETHOD(T, removeCollider), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "bool test_point_inside(const vector&in point) const", asMETHOD(T, testPointInside), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "bool raycast(const ray& point, raycast_info& raycast_info) const", asMETHOD(T, raycast), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "bool test_aabb_overlap(const aabb&in world_aabb) const", asMETHOD(T, testAABBOverlap), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "aabb get_aabb() const property", asMETHOD(T, getAABB), asCALL_THISCALL);
+	    asFUNCTION(stepper_guarded<&T::addCollider>::call),
+	    asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "void remove_collider(physics_collider&in collider)", asFUNCTION(stepper_guarded<&T::removeCollider>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "bool test_point_inside(const vector&in point) const", asFUNCTION(stepper_guarded<&T::testPointInside>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "bool raycast(const ray& point, raycast_info& raycast_info) const", asFUNCTION(stepper_guarded<&T::raycast>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "bool test_aabb_overlap(const aabb&in world_aabb) const", asFUNCTION(stepper_guarded<&T::testAABBOverlap>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "aabb get_aabb() const property", asFUNCTION(stepper_guarded<&T::getAABB>::call), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod(type.c_str(), "const physics_collider& get_collider(uint index) const", asMETHODPR(T, getCollider, (uint32) const, const Collider*), asCALL_THISCALL);
 	engine->RegisterObjectMethod(type.c_str(), "physics_collider& get_collider(uint index)", asMETHODPR(T, getCollider, (uint32), Collider*), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "uint get_nb_colliders() const property", asMETHOD(T, getNbColliders), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "vector get_world_point(const vector&in local_point) const", asMETHOD(T, getWorldPoint), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "vector get_world_vector(const vector&in local_vector) const", asMETHOD(T, getWorldVector), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "vector get_local_point(const vector&in world_point) const", asMETHOD(T, getLocalPoint), asCALL_THISCALL);
-	engine->RegisterObjectMethod(type.c_str(), "vector get_local_vector(const vector&in world_vector) const", asMETHOD(T, getLocalVector), asCALL_THISCALL);
+	engine->RegisterObjectMethod(type.c_str(), "uint get_nb_colliders() const property", asFUNCTION(stepper_guarded<&T::getNbColliders>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "vector get_world_point(const vector&in local_point) const", asFUNCTION(stepper_guarded<&T::getWorldPoint>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "vector get_world_vector(const vector&in local_vector) const", asFUNCTION(stepper_guarded<&T::getWorldVector>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "vector get_local_point(const vector&in world_point) const", asFUNCTION(stepper_guarded<&T::getLocalPoint>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "vector get_local_vector(const vector&in world_vector) const", asFUNCTION(stepper_guarded<&T::getLocalVector>::call), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod(type.c_str(), "bool get_is_debug_enabled() const property", asMETHOD(T, isDebugEnabled), asCALL_THISCALL);
 	engine->RegisterObjectMethod(type.c_str(), "void set_debug_enabled(bool enabled) property", asMETHOD(T, setIsDebugEnabled), asCALL_THISCALL);
 	engine->RegisterObjectMethod(type.c_str(), "void set_user_data(any@ userData)", asFUNCTION(body_set_user_data), asCALL_CDECL_OBJFIRST);
@@ -1080,33 +1386,33 @@ void RegisterPhysicsEntities(asIScriptEngine* engine) {
 void RegisterPhysicsBodies(asIScriptEngine* engine) {
 	RegisterPhysicsBody<Body>(engine, "physics_body");
 	RegisterPhysicsBody<RigidBody>(engine, "physics_rigid_body");
-	engine->RegisterObjectMethod("physics_rigid_body", "float get_mass() const property", asMETHOD(RigidBody, getMass), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_mass(float mass) property", asMETHOD(RigidBody, setMass), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "vector get_linear_velocity() const property", asMETHOD(RigidBody, getLinearVelocity), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_linear_velocity(const vector&in linear_velocity) property", asMETHOD(RigidBody, setLinearVelocity), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "vector get_angular_velocity() const property", asMETHOD(RigidBody, getAngularVelocity), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_angular_velocity(const vector&in angular_velocity) property", asMETHOD(RigidBody, setAngularVelocity), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "const vector& get_local_inertia_tensor() const property", asMETHOD(RigidBody, getLocalInertiaTensor), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_local_inertia_tensor(const vector&in local_inertia_tensor) property", asMETHOD(RigidBody, setLocalInertiaTensor), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "const vector& get_local_center_of_mass() const property", asMETHOD(RigidBody, getLocalCenterOfMass), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_local_center_of_mass(const vector&in local_center_of_mass) property", asMETHOD(RigidBody, setLocalCenterOfMass), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void update_local_center_of_mass_from_colliders()", asMETHOD(RigidBody, updateLocalCenterOfMassFromColliders), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void update_local_inertia_tensor_from_colliders()", asMETHOD(RigidBody, updateLocalInertiaTensorFromColliders), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void update_mass_from_colliders()", asMETHOD(RigidBody, updateMassFromColliders), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void update_mass_properties_from_colliders()", asMETHOD(RigidBody, updateMassPropertiesFromColliders), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "physics_body_type get_type() const property", asMETHOD(RigidBody, getType), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_type(physics_body_type type) property", asMETHOD(RigidBody, setType), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "bool get_is_gravity_enabled() const property", asMETHOD(RigidBody, isGravityEnabled), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_is_gravity_enabled(bool enabled) property", asMETHOD(RigidBody, enableGravity), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_is_sleeping(bool enabled)", asMETHOD(RigidBody, setIsSleeping), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "float get_linear_damping() const property", asMETHOD(RigidBody, getLinearDamping), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_linear_damping(float linear_damping) property", asMETHOD(RigidBody, setLinearDamping), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "float get_angular_damping() const property", asMETHOD(RigidBody, getAngularDamping), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_angular_damping(float angular_damping) property", asMETHOD(RigidBody, setAngularDamping), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "const vector& get_linear_lock_axis_factor() const property", asMETHOD(RigidBody, getLinearLockAxisFactor), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_linear_lock_axis_factor(const vector&in linear_lock_axis_factor) property", asMETHOD(RigidBody, setLinearLockAxisFactor), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "const vector& get_angular_lock_axis_factor() const property", asMETHOD(RigidBody, getAngularLockAxisFactor), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_rigid_body", "void set_angular_lock_axis_factor(const vector&in angular_lock_axis_factor) property", asMETHOD(RigidBody, setAngularLockAxisFactor), asCALL_THISCALL);
+	engine->RegisterObjectMethod("physics_rigid_body", "float get_mass() const property", asFUNCTION(stepper_guarded<&RigidBody::getMass>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_mass(float mass) property", asFUNCTION(stepper_guarded<&RigidBody::setMass>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "vector get_linear_velocity() const property", asFUNCTION(stepper_guarded<&RigidBody::getLinearVelocity>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_linear_velocity(const vector&in linear_velocity) property", asFUNCTION(stepper_guarded<&RigidBody::setLinearVelocity>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "vector get_angular_velocity() const property", asFUNCTION(stepper_guarded<&RigidBody::getAngularVelocity>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_angular_velocity(const vector&in angular_velocity) property", asFUNCTION(stepper_guarded<&RigidBody::setAngularVelocity>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "vector get_local_inertia_tensor() const property", asFUNCTION(stepper_guarded<&RigidBody::getLocalInertiaTensor>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_local_inertia_tensor(const vector&in local_inertia_tensor) property", asFUNCTION(stepper_guarded<&RigidBody::setLocalInertiaTensor>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "vector get_local_center_of_mass() const property", asFUNCTION(stepper_guarded<&RigidBody::getLocalCenterOfMass>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_local_center_of_mass(const vector&in local_center_of_mass) property", asFUNCTION(stepper_guarded<&RigidBody::setLocalCenterOfMass>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void update_local_center_of_mass_from_colliders()", asFUNCTION(stepper_guarded<&RigidBody::updateLocalCenterOfMassFromColliders>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void update_local_inertia_tensor_from_colliders()", asFUNCTION(stepper_guarded<&RigidBody::updateLocalInertiaTensorFromColliders>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void update_mass_from_colliders()", asFUNCTION(stepper_guarded<&RigidBody::updateMassFromColliders>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void update_mass_properties_from_colliders()", asFUNCTION(stepper_guarded<&RigidBody::updateMassPropertiesFromColliders>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "physics_body_type get_type() const property", asFUNCTION(stepper_guarded<&RigidBody::getType>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_type(physics_body_type type) property", asFUNCTION(stepper_guarded<&RigidBody::setType>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "bool get_is_gravity_enabled() const property", asFUNCTION(stepper_guarded<&RigidBody::isGravityEnabled>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_is_gravity_enabled(bool enabled) property", asFUNCTION(stepper_guarded<&RigidBody::enableGravity>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_is_sleeping(bool enabled)", asFUNCTION(stepper_guarded<&RigidBody::setIsSleeping>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "float get_linear_damping() const property", asFUNCTION(stepper_guarded<&RigidBody::getLinearDamping>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_linear_damping(float linear_damping) property", asFUNCTION(stepper_guarded<&RigidBody::setLinearDamping>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "float get_angular_damping() const property", asFUNCTION(stepper_guarded<&RigidBody::getAngularDamping>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_angular_damping(float angular_damping) property", asFUNCTION(stepper_guarded<&RigidBody::setAngularDamping>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "vector get_linear_lock_axis_factor() const property", asFUNCTION(stepper_guarded<&RigidBody::getLinearLockAxisFactor>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_linear_lock_axis_factor(const vector&in linear_lock_axis_factor) property", asFUNCTION(stepper_guarded<&RigidBody::setLinearLockAxisFactor>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "vector get_angular_lock_axis_factor() const property", asFUNCTION(stepper_guarded<&RigidBody::getAngularLockAxisFactor>::call), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_rigid_body", "void set_angular_lock_axis_factor(const vector&in angular_lock_axis_factor) property", asFUNCTION(stepper_guarded<&RigidBody::setAngularLockAxisFactor>::call), asCALL_CDECL_OBJFIRST);
 }
 
 void RegisterCollisionShapes(asIScriptEngine* engine) {
@@ -1314,6 +1620,8 @@ void RegisterPhysicsWorldAndCallbacks(asIScriptEngine* engine) {
 	engine->RegisterObjectBehaviour("physics_world", asBEHAVE_RELEASE, "void f()", asFUNCTION(no_refcount), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod("physics_world", "bool test_overlap(physics_body@ body1, physics_body@ body2)", asMETHODPR(PhysicsWorld, testOverlap, (Body*, Body*), bool), asCALL_THISCALL);
 	engine->RegisterObjectMethod("physics_world", "void raycast(const ray&in ray, physics_raycast_callback@ callback, uint16 category_mask = 0xffff)", asFUNCTION(world_raycast), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "uint raycast_batch(const ray[]@+ rays, physics_body@[]@+ hit_bodies, vector[]@+ hit_points = null, vector[]@+ hit_normals = null, float[]@+ hit_fractions = null, uint16 category_mask = 0xffff)", asFUNCTION(world_raycast_batch), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "uint test_overlap_batch(const physics_body@[]@+ bodies, physics_body@[]@+ overlapping_bodies, uint[]@+ offsets)", asFUNCTION(world_test_overlap_batch), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod("physics_world", "void test_overlap(physics_body@ body, physics_overlap_callback@ callback)", asFUNCTION(world_test_overlap_body), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod("physics_world", "void test_overlap(physics_overlap_callback@ callback)", asFUNCTION(world_test_overlap), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod("physics_world", "void test_collision(physics_body@ body1, physics_body@ body2, physics_collision_callback@ callback)", asFUNCTION(world_test_collision_bodies), asCALL_CDECL_OBJFIRST);
@@ -1321,13 +1629,28 @@ void RegisterPhysicsWorldAndCallbacks(asIScriptEngine* engine) {
 	engine->RegisterObjectMethod("physics_world", "void test_collision(physics_collision_callback@ callback)", asFUNCTION(world_test_collision), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod("physics_world", "aabb get_world_aabb(const physics_collider@ collider) const", asMETHOD(PhysicsWorld, getWorldAABB), asCALL_THISCALL);
 	engine->RegisterObjectMethod("physics_world", "const string& get_name() const property", asMETHOD(PhysicsWorld, getName), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_world", "void update(float time_step)", asMETHOD(PhysicsWorld, update), asCALL_THISCALL);
+	engine->RegisterObjectMethod("physics_world", "void update(float time_step)", asFUNCTION(world_update), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "bool start_background_simulation(float time_step = 1.0f / 60)", asFUNCTION(world_start_background_simulation), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "bool stop_background_simulation()", asFUNCTION(world_stop_background_simulation), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "bool get_background_simulation() const property", asFUNCTION(world_get_background_simulation), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "float get_background_time_step() const property", asFUNCTION(world_get_background_time_step), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "uint64 get_background_steps() const property", asFUNCTION(world_get_background_steps), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "bool lock_simulation()", asFUNCTION(world_lock_simulation), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "void unlock_simulation()", asFUNCTION(world_unlock_simulation), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "float get_interpolation_alpha() const property", asFUNCTION(world_get_interpolation_alpha), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "physics_transform get_interpolated_transform(const physics_body@ body) const", asFUNCTION(world_get_interpolated_transform), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "void queue_force(physics_rigid_body@ body, const vector&in force)", asFUNCTION(world_queue_force), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "void queue_force(physics_rigid_body@ body, const vector&in force, const vector&in world_point)", asFUNCTION(world_queue_force_at_point), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "void queue_torque(physics_rigid_body@ body, const vector&in torque)", asFUNCTION(world_queue_torque), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "void queue_linear_velocity(physics_rigid_body@ body, const vector&in velocity)", asFUNCTION(world_queue_linear_velocity), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "void queue_angular_velocity(physics_rigid_body@ body, const vector&in velocity)", asFUNCTION(world_queue_angular_velocity), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod("physics_world", "void queue_transform(physics_rigid_body@ body, const physics_transform&in transform)", asFUNCTION(world_queue_transform), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod("physics_world", "uint16 get_nb_iterations_velocity_solver() const property", asMETHOD(PhysicsWorld, getNbIterationsVelocitySolver), asCALL_THISCALL);
 	engine->RegisterObjectMethod("physics_world", "void set_nb_iterations_velocity_solver(uint16 iterations) property", asMETHOD(PhysicsWorld, setNbIterationsVelocitySolver), asCALL_THISCALL);
 	engine->RegisterObjectMethod("physics_world", "uint16 get_nb_iterations_position_solver() const property", asMETHOD(PhysicsWorld, getNbIterationsPositionSolver), asCALL_THISCALL);
 	engine->RegisterObjectMethod("physics_world", "void set_nb_iterations_position_solver(uint16 iterations) property", asMETHOD(PhysicsWorld, setNbIterationsPositionSolver), asCALL_THISCALL);
 	engine->RegisterObjectMethod("physics_world", "void set_contacts_position_correction_technique(physics_contact_position_correction_technique technique) property", asMETHOD(PhysicsWorld, setContactsPositionCorrectionTechnique), asCALL_THISCALL);
-	engine->RegisterObjectMethod("physics_world", "physics_rigid_body@ create_rigid_body(const physics_transform&in transform)", asMETHOD(PhysicsWorld, createRigidBody), asCALL_THISCALL);
+	engine->RegisterObjectMethod("physics_world", "physics_rigid_body@ create_rigid_body(const physics_transform&in transform)", asFUNCTION(world_create_rigid_body), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod("physics_world", "void destroy_rigid_body(physics_rigid_body& body)", asFUNCTION(world_destroy_rigid_body), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod("physics_world", "physics_joint@ create_joint(const physics_joint_info&in joint_info)", asMETHOD(PhysicsWorld, createJoint), asCALL_THISCALL);
 	engine->RegisterObjectMethod("physics_world", "void destroy_joint(physics_joint& joint)", asMETHOD(PhysicsWorld, destroyJoint), asCALL_THISCALL);
@@ -13,3 +13,4 @@
 class asIScriptEngine;
 
 void RegisterReactphysics(asIScriptEngine* engine);
+void physics_shutdown(); // Stops and joins all background simulation threads.
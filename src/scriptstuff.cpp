@@ -43,9 +43,9 @@ Poco::Thread* g_GCThread = nullptr;
 asQWORD g_GCAutoFullTime = ticks();
 unsigned int g_GCAutoFrequency = 300000;
 void garbage_collect(bool full = true) {
-	if (!full && g_GCMode < 3)
+	if (!full && g_GCMode != 3)
 		g_ScriptEngine->GarbageCollect(asGC_ONE_STEP | asGC_DETECT_GARBAGE);
-	else if (full && g_GCMode < 3)
+	else if (full && g_GCMode != 3)
 		g_ScriptEngine->GarbageCollect(asGC_FULL_CYCLE);
 	else if (full && g_GCMode == 3)
 		g_GCAutoFullTime = 0;
@@ -57,6 +57,72 @@ void garbage_collect_action() {
 		g_GCAutoFullTime = ticks();
 	}
 }
+
+// Mode 4 drives Angelscript's incremental collector within a per-frame time budget, so that large object graphs get collected a little at a time rather than in one visible hitch. The budget grows while the number of tracked objects keeps climbing (the collector is falling behind the script's allocation rate) and decays back towards the configured value once it catches up.
+struct garbage_collect_statistics {
+	asQWORD current_size, total_destroyed, total_detected, new_objects, total_new_destroyed;
+	asQWORD cycles, steps, time_spent, idle_time_spent, last_frame_time, budget;
+};
+garbage_collect_statistics g_GCStats = {};
+unsigned int g_GCBudget = 1000; // microseconds per frame
+float g_GCBudgetScale = 1.0f;
+asUINT g_GCLastSize = 0;
+const float g_GCMaxBudgetScale = 4.0f;
+// Runs incremental steps until the budget is exhausted or the collector runs out of work, returns microseconds spent. Detection only steps are cheaper and never call into destructors, so they are what we use to fill idle time between frames.
+unsigned int garbage_collect_steps(unsigned int budget, bool detect_only = false) {
+	auto start = std::chrono::steady_clock::now();
+	asQWORD elapsed = 0;
+	asDWORD flags = asGC_ONE_STEP | asGC_DETECT_GARBAGE | (detect_only ? 0 : asGC_DESTROY_GARBAGE);
+	do {
+		g_GCStats.steps++;
+		if (g_ScriptEngine->GarbageCollect(flags) == 0) {
+			g_GCStats.cycles++;
+			elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+			break; // A cycle just completed, there is nothing worth doing until more objects are created.
+		}
+		elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	} while (elapsed < budget);
+	if (detect_only) g_GCStats.idle_time_spent += elapsed;
+	g_GCStats.time_spent += elapsed;
+	return elapsed;
+}
+unsigned int garbage_collect_incremental(unsigned int budget) {
+	if (!budget) {
+		asUINT size;
+		g_ScriptEngine->GetGCStatistics(&size);
+		if (size > g_GCLastSize) g_GCBudgetScale = std::min(g_GCBudgetScale * 1.5f, g_GCMaxBudgetScale);
+		else g_GCBudgetScale = std::max(g_GCBudgetScale * 0.75f, 1.0f);
+		g_GCLastSize = size;
+		budget = g_GCBudget * g_GCBudgetScale;
+	}
+	g_GCStats.budget = budget;
+	g_GCStats.last_frame_time = garbage_collect_steps(budget);
+	return g_GCStats.last_frame_time;
+}
+// Called from wait() with the number of milliseconds it is about to sleep, we spend up to half of that on detection work and return how long that took so the caller can sleep for less.
+unsigned int garbage_collect_idle(unsigned int ms) {
+	if (g_GCMode != 4 || ms < 2) return 0;
+	return garbage_collect_steps(ms * 500, true) / 1000;
+}
+garbage_collect_statistics get_garbage_collect_statistics() {
+	asUINT current_size, total_destroyed, total_detected, new_objects, total_new_destroyed;
+	g_ScriptEngine->GetGCStatistics(&current_size, &total_destroyed, &total_detected, &new_objects, &total_new_destroyed);
+	g_GCStats.current_size = current_size;
+	g_GCStats.total_destroyed = total_destroyed;
+	g_GCStats.total_detected = total_detected;
+	g_GCStats.new_objects = new_objects;
+	g_GCStats.total_new_destroyed = total_new_destroyed;
+	return g_GCStats;
+}
+void reset_garbage_collect_statistics() {
+	g_GCStats = {};
+}
+unsigned int get_garbage_collect_budget() {
+	return g_GCBudget;
+}
+void set_garbage_collect_budget(unsigned int budget) {
+	g_GCBudget = std::max(budget, 50u);
+}
 void garbage_collect_thread(void* user) {
 	Poco::Thread::sleep(10);
 	while (g_GCMode == 3) {
@@ -70,7 +136,7 @@ int get_garbage_collect_mode() {
 	return g_GCMode;
 }
 bool set_garbage_collect_mode(int m) {
-	if (m < 1 || m > 3) return false;
+	if (m < 1 || m > 4) return false;
 	if (m == 3 && !g_GCThread) {
 		g_GCThread = new Poco::Thread;
 		if (!g_GCThread)
@@ -782,6 +848,23 @@ void RegisterScriptstuff(asIScriptEngine* engine) {
 	engine->RegisterGlobalFunction("int get_garbage_collect_auto_frequency() property", asFUNCTION(get_garbage_collect_auto_frequency), asCALL_CDECL);
 	engine->RegisterGlobalFunction("void set_garbage_collect_auto_frequency(int) property", asFUNCTION(set_garbage_collect_auto_frequency), asCALL_CDECL);
 	engine->RegisterGlobalFunction("void garbage_collect(bool = true)", asFUNCTION(garbage_collect), asCALL_CDECL);
+	engine->RegisterGlobalFunction("uint get_garbage_collect_budget() property", asFUNCTION(get_garbage_collect_budget), asCALL_CDECL);
+	engine->RegisterGlobalFunction("void set_garbage_collect_budget(uint) property", asFUNCTION(set_garbage_collect_budget), asCALL_CDECL);
+	engine->RegisterGlobalFunction("uint garbage_collect_incremental(uint budget = 0)", asFUNCTION(garbage_collect_incremental), asCALL_CDECL);
+	engine->RegisterObjectType("garbage_collect_statistics", sizeof(garbage_collect_statistics), asOBJ_VALUE | asOBJ_POD | asOBJ_APP_CLASS_ALLINTS | asGetTypeTraits<garbage_collect_statistics>());
+	engine->RegisterObjectProperty("garbage_collect_statistics", "const uint64 current_size", asOFFSET(garbage_collect_statistics, current_size));
+	engine->RegisterObjectProperty("garbage_collect_statistics", "const uint64 total_destroyed", asOFFSET(garbage_collect_statistics, total_destroyed));
+	engine->RegisterObjectProperty("garbage_collect_statistics", "const uint64 total_detected", asOFFSET(garbage_collect_statistics, total_detected));
+	engine->RegisterObjectProperty("garbage_collect_statistics", "const uint64 new_objects", asOFFSET(garbage_collect_statistics, new_objects));
+	engine->RegisterObjectProperty("garbage_collect_statistics", "const uint64 total_new_destroyed", asOFFSET(garbage_collect_statistics, total_new_destroyed));
+	engine->RegisterObjectProperty("garbage_collect_statistics", "const uint64 cycles", asOFFSET(garbage_collect_statistics, cycles));
+	engine->RegisterObjectProperty("garbage_collect_statistics", "const uint64 steps", asOFFSET(garbage_collect_statistics, steps));
+	engine->RegisterObjectProperty("garbage_collect_statistics", "const uint64 time_spent", asOFFSET(garbage_collect_statistics, time_spent));
+	engine->RegisterObjectProperty("garbage_collect_statistics", "const uint64 idle_time_spent", asOFFSET(garbage_collect_statistics, idle_time_spent));
+	engine->RegisterObjectProperty("garbage_collect_statistics", "const uint64 last_frame_time", asOFFSET(garbage_collect_statistics, last_frame_time));
+	engine->RegisterObjectProperty("garbage_collect_statistics", "const uint64 budget", asOFFSET(garbage_collect_statistics, budget));
+	engine->RegisterGlobalFunction("garbage_collect_statistics get_garbage_collect_statistics()", asFUNCTION(get_garbage_collect_statistics), asCALL_CDECL);
+	engine->RegisterGlobalFunction("void reset_garbage_collect_statistics()", asFUNCTION(reset_garbage_collect_statistics), asCALL_CDECL);
 	engine->RegisterGlobalFunction("void start_profiling()", asFUNCTION(start_profiling), asCALL_CDECL);
 	engine->RegisterGlobalFunction("void stop_profiling()", asFUNCTION(stop_profiling), asCALL_CDECL);
 	engine->RegisterGlobalFunction("void reset_profiler()", asFUNCTION(reset_profiler), asCALL_CDECL);
@@ -21,6 +21,8 @@ void profiler_callback(asIScriptContext* ctx, void* obj);
 extern int g_GCMode;
 void prepare_profiler();
 void garbage_collect_action();
+unsigned int garbage_collect_incremental(unsigned int budget = 0);
+unsigned int garbage_collect_idle(unsigned int ms);
 extern asIScriptFunction* profiler_last_func;
 extern int profiler_current_line;
 extern const char* profiler_current_section;
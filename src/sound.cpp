@@ -11,6 +11,7 @@
 */
 
 #define NOMINMAX
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <thread>
@@ -685,15 +686,63 @@ audio_data_source* audio_data_source_get(ma_data_source* ptr, audio_engine* engi
 }
 class audio_ring_buffer_impl : public audio_data_source_impl, public virtual audio_ring_buffer {
 	unique_ptr<ma_pcm_rb> rb;
+	// miniaudio's own ring buffer data source pads with silence forever, we wrap it so that an end of stream can be reported once the writer says it's done.
+	struct ring_source {
+		ma_data_source_base base; // Must remain the first member.
+		audio_ring_buffer_impl* owner;
+	} source;
+	atomic<bool> end_of_stream;
+	static ma_result source_read(ma_data_source* ds, void* frames_out, ma_uint64 frame_count, ma_uint64* frames_read) {
+		audio_ring_buffer_impl* self = ((ring_source*)ds)->owner;
+		ma_pcm_rb* rb = &*self->rb;
+		ma_uint32 frame_size = ma_get_bytes_per_frame(rb->format, rb->channels);
+		bool finished = self->end_of_stream.load();
+		ma_uint64 total = 0;
+		while (total < frame_count) {
+			ma_uint32 chunk = ma_uint32(min<ma_uint64>(frame_count - total, 0xffffffff));
+			void* read_ptr;
+			if (ma_pcm_rb_acquire_read(rb, &chunk, &read_ptr) != MA_SUCCESS || !chunk) break;
+			if (frames_out) memcpy((char*)frames_out + total * frame_size, read_ptr, size_t(chunk) * frame_size);
+			ma_pcm_rb_commit_read(rb, chunk);
+			total += chunk;
+		}
+		if (total < frame_count && !finished) {
+			if (frames_out) ma_silence_pcm_frames((char*)frames_out + total * frame_size, frame_count - total, rb->format, rb->channels);
+			total = frame_count;
+		}
+		if (frames_read) *frames_read = total;
+		return total == 0 && frame_count > 0? MA_AT_END : MA_SUCCESS;
+	}
+	static ma_result source_get_data_format(ma_data_source* ds, ma_format* format, ma_uint32* channels, ma_uint32* sample_rate, ma_channel* channel_map, size_t channel_map_cap) {
+		ma_pcm_rb* rb = &*((ring_source*)ds)->owner->rb;
+		if (format) *format = rb->format;
+		if (channels) *channels = rb->channels;
+		if (sample_rate) *sample_rate = ma_pcm_rb_get_sample_rate(rb);
+		ma_channel_map_init_standard(ma_standard_channel_map_default, channel_map, channel_map_cap, rb->channels);
+		return MA_SUCCESS;
+	}
+	inline static ma_data_source_vtable source_vtable = { source_read, nullptr, source_get_data_format, nullptr, nullptr, nullptr, 0 };
 public:
-	audio_ring_buffer_impl(unsigned int channels, unsigned int size, audio_engine * e) : audio_data_source_impl(e, nullptr), rb(make_unique<ma_pcm_rb>()) {
+	audio_ring_buffer_impl(unsigned int channels, unsigned int size, audio_engine * e, unsigned int sample_rate = 0) : audio_data_source_impl(e, nullptr), rb(make_unique<ma_pcm_rb>()), end_of_stream(false) {
 		if (ma_pcm_rb_init(ma_format_f32, channels, size, nullptr, nullptr, &*rb) != MA_SUCCESS) throw std::runtime_error("failed to initialize ring buffer");
-		set_ma_data_source((ma_data_source*)&*rb);
+		if (sample_rate) ma_pcm_rb_set_sample_rate(&*rb, sample_rate);
+		ma_data_source_config cfg = ma_data_source_config_init();
+		cfg.vtable = &source_vtable;
+		source.owner = this;
+		if (ma_data_source_init(&cfg, &source.base) != MA_SUCCESS) {
+			ma_pcm_rb_uninit(&*rb);
+			throw std::runtime_error("failed to initialize ring buffer");
+		}
+		set_ma_data_source((ma_data_source*)&source.base);
 	}
 	~audio_ring_buffer_impl() {
 		if (rb) ma_pcm_rb_uninit(&*rb);
+		ma_data_source_uninit(&source.base);
+	}
+	void reset() override {
+		if (rb) ma_pcm_rb_reset(&*rb);
+		end_of_stream.store(false);
 	}
-	void reset() override { if (rb) ma_pcm_rb_reset(&*rb); }
 	unsigned int get_advised_read_frame_count() const override { return get_available_read(); }
 	unsigned int write(const float* frames_in, unsigned int frame_count) override {
 		if (!rb) return 0;
@@ -715,8 +764,84 @@ public:
 	unsigned int get_available_write() const override { return rb? ma_pcm_rb_available_write(&*rb) : 0; }
 	unsigned int get_channels() const override { return rb? ma_pcm_rb_get_channels(&*rb) : 0; }
 	unsigned int get_sample_rate() const override { return rb? ma_pcm_rb_get_sample_rate(&*rb) : 0; }
+	void set_end_of_stream(bool end) override { end_of_stream.store(end); }
+	bool get_end_of_stream() const override { return end_of_stream.load(); }
+};
+audio_ring_buffer* audio_ring_buffer::create(unsigned int channels, unsigned int size, audio_engine* e, unsigned int sample_rate) { return new audio_ring_buffer_impl(channels, size, e, sample_rate); }
+// A data source playing raw PCM straight out of memory, used for anything we generate ourselves (TTS, tone_synth, script provided samples) so that it doesn't need a round trip through a wav encoder and decoder. The samples can either be owned by the data source or referenced from a caller owned buffer that gets released through a callback once the source is destroyed.
+class pcm_memory_data_source {
+	ma_data_source_base base; // Must remain the first member, miniaudio casts our pointer to this.
+	std::string owned;
+	const unsigned char* data;
+	ma_uint64 frame_count;
+	ma_uint64 cursor;
+	ma_format format;
+	ma_uint32 channels;
+	ma_uint32 sample_rate;
+	ma_uint32 frame_size;
+	std::function<void()> on_release;
+	bool initialized;
+	static ma_result on_read(ma_data_source* ds, void* frames_out, ma_uint64 frame_count, ma_uint64* frames_read) {
+		pcm_memory_data_source* src = (pcm_memory_data_source*)ds;
+		ma_uint64 available = src->frame_count - src->cursor;
+		if (frame_count > available) frame_count = available;
+		if (frames_out && frame_count) memcpy(frames_out, src->data + src->cursor * src->frame_size, size_t(frame_count * src->frame_size));
+		src->cursor += frame_count;
+		if (frames_read) *frames_read = frame_count;
+		return available == 0? MA_AT_END : MA_SUCCESS;
+	}
+	static ma_result on_seek(ma_data_source* ds, ma_uint64 frame_index) {
+		pcm_memory_data_source* src = (pcm_memory_data_source*)ds;
+		if (frame_index > src->frame_count) return MA_BAD_SEEK;
+		src->cursor = frame_index;
+		return MA_SUCCESS;
+	}
+	static ma_result on_get_data_format(ma_data_source* ds, ma_format* format, ma_uint32* channels, ma_uint32* sample_rate, ma_channel* channel_map, size_t channel_map_cap) {
+		pcm_memory_data_source* src = (pcm_memory_data_source*)ds;
+		if (format) *format = src->format;
+		if (channels) *channels = src->channels;
+		if (sample_rate) *sample_rate = src->sample_rate;
+		if (channel_map) ma_channel_map_init_standard(ma_standard_channel_map_default, channel_map, channel_map_cap, src->channels);
+		return MA_SUCCESS;
+	}
+	static ma_result on_get_cursor(ma_data_source* ds, ma_uint64* cursor) {
+		*cursor = ((pcm_memory_data_source*)ds)->cursor;
+		return MA_SUCCESS;
+	}
+	static ma_result on_get_length(ma_data_source* ds, ma_uint64* length) {
+		*length = ((pcm_memory_data_source*)ds)->frame_count;
+		return MA_SUCCESS;
+	}
+	inline static ma_data_source_vtable vtable = {on_read, on_seek, on_get_data_format, on_get_cursor, on_get_length, nullptr, 0};
+	bool init(const void* buffer, ma_uint64 size_in_bytes, ma_format fmt, int samplerate, int nchannels) {
+		if (fmt == ma_format_unknown || fmt >= ma_format_count || samplerate < 1 || nchannels < 1 || !buffer) return false;
+		format = fmt;
+		channels = nchannels;
+		sample_rate = samplerate;
+		frame_size = ma_get_bytes_per_frame(format, channels);
+		data = (const unsigned char*)buffer;
+		frame_count = size_in_bytes / frame_size;
+		ma_data_source_config cfg = ma_data_source_config_init();
+		cfg.vtable = &vtable;
+		initialized = (g_soundsystem_last_error = ma_data_source_init(&cfg, &base)) == MA_SUCCESS;
+		return initialized;
+	}
+public:
+	pcm_memory_data_source() : data(nullptr), frame_count(0), cursor(0), format(ma_format_unknown), channels(0), sample_rate(0), frame_size(0), initialized(false) {}
+	~pcm_memory_data_source() {
+		if (initialized) ma_data_source_uninit(&base);
+		if (on_release) on_release();
+	}
+	bool init_moved(std::string&& buffer, ma_format fmt, int samplerate, int nchannels) {
+		owned = std::move(buffer);
+		return init(owned.data(), owned.size(), fmt, samplerate, nchannels);
+	}
+	bool init_external(const void* buffer, ma_uint64 size_in_bytes, ma_format fmt, int samplerate, int nchannels, std::function<void()> release) {
+		on_release = std::move(release);
+		return init(buffer, size_in_bytes, fmt, samplerate, nchannels);
+	}
+	ma_data_source* get_ma_data_source() { return (ma_data_source*)&base; }
 };
-audio_ring_buffer* audio_ring_buffer::create(unsigned int channels, unsigned int size, audio_engine* e) { return new audio_ring_buffer_impl(channels, size, e); }
 class audio_decoder_impl : public audio_data_source_impl, public virtual audio_decoder {
 	unique_ptr<ma_decoder> decoder;
 	datastream* datastream_ref; // If the user opens a datastream, we must maintain a reference to it encase the user drops their handle.
@@ -1490,12 +1615,13 @@ class sound_impl final : public mixer_impl, public virtual sound {
 		ma_async_notification_callbacks cb;
 		std::atomic_flag *pAtomicFlag;
 	} async_notification_callbacks;
-	std::string pcm_buffer;      // When loading from raw PCM (like TTS) we store the intermediate wav data here so we can take advantage of async loading to return quickly. Makes a substantial difference in the responsiveness of TTS calls.
+	std::string pcm_buffer;      // load_string_async keeps its copy of the encoded data here so that it can be decoded in the background while we return quickly.
 	std::string loaded_filename; // Contains the loaded filename as passed in the load/stream method, used just for convenience.
 	ma_fence fence;
 	async_notification_callbacks notification_callbacks;
 	mutable std::atomic_flag load_completed;
 	unique_ptr<ma_pcm_rb> pcm_stream;
+	unique_ptr<pcm_memory_data_source> pcm_source;
 	bool paused;
 	bool should_autoclose; // If this is true, the release method defers sound destruction until playback has complete.
 	mutable audio_data_source* datasource; // Avoid the need to keep looking up the pointer to the c++ ma_data_source wrapper associated with this sound.
@@ -1599,18 +1725,34 @@ public:
 	bool load_memory(const void *buffer, unsigned int size) override {
 		return load_special("::memory", g_memory_protocol_slot, memory_protocol::directive(buffer, size));
 	}
+	bool load_pcm_source(unique_ptr<pcm_memory_data_source> source) {
+		snd = make_unique<ma_sound>();
+		if ((g_soundsystem_last_error = ma_sound_init_from_data_source(get_engine()->get_ma_engine(), source->get_ma_data_source(), 0, nullptr, &*snd)) != MA_SUCCESS) {
+			snd.reset();
+			return false;
+		}
+		pcm_source = std::move(source);
+		postload(":pcm", false);
+		return true;
+	}
 	bool load_pcm(void *buffer, unsigned int size, ma_format format, int samplerate, int channels) override {
+		if (!buffer) return false;
+		return load_pcm_moved(std::string((const char*)buffer, size), format, samplerate, channels);
+	}
+	bool load_pcm_moved(std::string&& buffer, ma_format format, int samplerate, int channels) override {
 		if (snd)
 			close();
-		pcm_buffer.clear();
-		// At least for now, the strat here is just to write the PCM to wav and then load it the normal way.
-		// Should optimization become necessary (this does result in a couple of copies), a protocol could be written that simulates its input having a RIFF header on it.
-		pcm_buffer.resize(size + 44);
-		if (!pcm_to_wav(buffer, size, format, samplerate, channels, &pcm_buffer[0]))
-			return false;
-		// At this point we can just use the sound service to load this. We use the low level API though because we need to be clear that no filters apply.
-		// Also, our PCM buffer is a permanent class property so we can enjoy the speed of async loading.
-		return load_special(":pcm", g_memory_protocol_slot, memory_protocol::directive(&pcm_buffer[0], pcm_buffer.size()), sound_service::null_filter_slot, nullptr, MA_SOUND_FLAG_DECODE | MA_SOUND_FLAG_ASYNC);
+		unique_ptr<pcm_memory_data_source> source = make_unique<pcm_memory_data_source>();
+		if (!source->init_moved(std::move(buffer), format, samplerate, channels)) return false;
+		return load_pcm_source(std::move(source));
+	}
+	bool load_pcm_external(const void *buffer, unsigned int size, ma_format format, int samplerate, int channels, std::function<void()> release) override {
+		if (snd)
+			close();
+		unique_ptr<pcm_memory_data_source> source = make_unique<pcm_memory_data_source>();
+		// From here on the data source is responsible for invoking the release callback, even if initialization fails.
+		if (!source->init_external(buffer, size, format, samplerate, channels, std::move(release))) return false;
+		return load_pcm_source(std::move(source));
 	}
 	bool load_pcm_script_array(CScriptArray *buffer, int samplerate, int channels) override {
 		if (!buffer)
@@ -1712,6 +1854,7 @@ public:
 		node = nullptr;
 		if (pcm_stream) ma_pcm_rb_uninit(&*pcm_stream);
 		pcm_stream.reset();
+		pcm_source.reset();
 		pcm_buffer.resize(0);
 		loaded_filename.clear();
 		load_completed.clear();
@@ -2139,6 +2282,8 @@ template<class T> inline void RegisterSoundsystemRingBuffer(asIScriptEngine* eng
 	engine->RegisterObjectMethod(type.c_str(), "uint write(const memory_buffer<float>& frames)", asFUNCTION((virtual_call<T, &T::write_script_memory_buffer, unsigned int, script_memory_buffer*>)), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod(type.c_str(), "uint get_available_read() const property", asFUNCTION((virtual_call<T, &T::get_available_read, unsigned int>)), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod(type.c_str(), "uint get_available_write() const property", asFUNCTION((virtual_call<T, &T::get_available_write, unsigned int>)), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "void set_end_of_stream(bool end) property", asFUNCTION((virtual_call<T, &T::set_end_of_stream, void, bool>)), asCALL_CDECL_OBJFIRST);
+	engine->RegisterObjectMethod(type.c_str(), "bool get_end_of_stream() const property", asFUNCTION((virtual_call<T, &T::get_end_of_stream, bool>)), asCALL_CDECL_OBJFIRST);
 	if constexpr (!std::is_same < T, audio_ring_buffer >::value) {
 		engine->RegisterObjectMethod(type.c_str(), "audio_ring_buffer@ opImplCast()", asFUNCTION((op_cast<T, audio_ring_buffer>)), asCALL_CDECL_OBJFIRST);
 		engine->RegisterObjectMethod("audio_ring_buffer", Poco::format("%s@ opCast()", type).c_str(), asFUNCTION((op_cast<audio_ring_buffer, T>)), asCALL_CDECL_OBJFIRST);
@@ -2197,7 +2342,7 @@ void RegisterSoundsystemDataSources(asIScriptEngine* engine) {
 	engine->RegisterObjectMethod("audio_decoder", "bool open(datastream@ stream, uint sample_rate = 0, uint channels = 0)", asFUNCTION((virtual_call < audio_decoder, &audio_decoder::open_stream, bool, datastream*, unsigned int, unsigned int >)), asCALL_CDECL_OBJFIRST);
 	engine->RegisterObjectMethod("audio_decoder", "bool close()", asFUNCTION((virtual_call < audio_decoder, &audio_decoder::close, bool >)), asCALL_CDECL_OBJFIRST);
 	RegisterSoundsystemRingBuffer<audio_ring_buffer>(engine, "audio_ring_buffer");
-	engine->RegisterObjectBehaviour("audio_ring_buffer", asBEHAVE_FACTORY, "audio_ring_buffer@ r(uint channels, uint size, audio_engine@ engine = sound_default_engine)", asFUNCTION(audio_ring_buffer::create), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("audio_ring_buffer", asBEHAVE_FACTORY, "audio_ring_buffer@ r(uint channels, uint size, audio_engine@ engine = sound_default_engine, uint sample_rate = 0)", asFUNCTION(audio_ring_buffer::create), asCALL_CDECL);
 	RegisterSoundsystemRingBuffer<microphone>(engine, "microphone");
 	engine->RegisterObjectBehaviour("microphone", asBEHAVE_FACTORY, "microphone@ m(int device = -1, audio_engine@ engine = sound_default_engine)", asFUNCTION(microphone::create), asCALL_CDECL);
 	engine->RegisterObjectMethod("microphone", "bool set_device(int device)", asFUNCTION((virtual_call < microphone, &microphone::set_device, bool, int>)), asCALL_CDECL_OBJFIRST);
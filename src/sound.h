@@ -13,6 +13,7 @@
 #pragma once
 
 #define NOMINMAX
+#include <functional>
 #include <miniaudio.h>
 #include <reactphysics3d/mathematics/Vector3.h>
 #include "sound_service.h"
@@ -174,7 +175,10 @@ public:
 	virtual unsigned int get_available_write() const = 0;
 	virtual unsigned int get_channels() const override = 0;
 	virtual unsigned int get_sample_rate() const override = 0;
-	static audio_ring_buffer* create(unsigned int channels, unsigned int size, audio_engine* e);
+	// Once the end of stream flag is set, the buffer reports the end of its data to whatever is reading it as soon as it drains rather than padding with silence, so that a sound playing it finishes normally.
+	virtual void set_end_of_stream(bool end) = 0;
+	virtual bool get_end_of_stream() const = 0;
+	static audio_ring_buffer* create(unsigned int channels, unsigned int size, audio_engine* e, unsigned int sample_rate = 0);
 };
 class audio_decoder : public virtual audio_data_source {
 public:
@@ -367,7 +371,10 @@ public:
 	 * Output must be preallocated and must be at least 44 bytes larger than the input buffer.
 	 */
 	static bool pcm_to_wav(const void *buffer, unsigned int size, ma_format format, int samplerate, int channels, void *output);
+	// Raw PCM is played directly from memory without being wrapped in a wav header and decoded again. load_pcm takes one copy of the buffer, load_pcm_moved takes ownership of a string holding the samples, and load_pcm_external references a buffer that must remain valid until the given release callback is invoked when the sound is closed.
 	virtual bool load_pcm(void *buffer, unsigned int size_in_bytes, ma_format format, int samplerate, int channels) = 0;
+	virtual bool load_pcm_moved(std::string&& buffer, ma_format format, int samplerate, int channels) = 0;
+	virtual bool load_pcm_external(const void *buffer, unsigned int size_in_bytes, ma_format format, int samplerate, int channels, std::function<void()> release = nullptr) = 0;
 	virtual bool load_pcm_script_array(CScriptArray *buffer, int samplerate, int channels) = 0;
 	virtual bool load_pcm_script_memory_buffer(script_memory_buffer*buffer, int samplerate, int channels) = 0;
 	virtual bool stream_pcm(const void* data, unsigned int size_in_frames, ma_format format = ma_format_unknown, unsigned int sample_rate = 0, unsigned int channels = 0, unsigned int buffer_size = 0) = 0;
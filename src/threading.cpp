@@ -10,9 +10,14 @@
  * 3. This notice may not be removed or altered from any source distribution.
 */
 
+#include <algorithm>
 #include <atomic>
+#include <deque>
 #include <string>
 #include <type_traits>
+#include <vector>
+#include <Poco/Condition.h>
+#include <Poco/Environment.h>
 #include <Poco/Event.h>
 #include <Poco/Format.h>
 #include <Poco/Mutex.h>
@@ -23,8 +28,10 @@
 #include <Poco/ScopedLock.h>
 #include <Poco/Thread.h>
 #include <Poco/ThreadPool.h>
+#include <Poco/Timestamp.h>
 #include <SDL3/SDL_init.h>
 #include <angelscript.h>
+#include <scriptarray.h>
 #include <scriptdictionary.h>
 #include <scripthelper.h>
 #include <obfuscate.h>
@@ -403,6 +410,432 @@ void scoped_write_rw_lock_destruct(ScopedWriteRWLock* mem) {
 }
 
 
+// Work stealing task scheduler. Each worker thread owns a deque which it pushes to and pops from at the back (so that freshly spawned subtasks run while their data is still hot), while idle workers steal from the front of other workers' deques. Threads which are not workers, usually the main script thread, submit to a shared injection queue and help execute tasks while they wait on a group, meaning that nested parallel_for calls from within a task can never deadlock the scheduler.
+class task_group;
+class task_scheduler;
+struct scheduled_task {
+	asIScriptFunction* func;
+	CScriptDictionary* args;
+	unsigned int range_start, range_end;
+	bool is_range;
+	task_group* group;
+	void (*native)(void*, unsigned int); // Set instead of func for engine side jobs, which are called with native_param and range_start without a script context.
+	void* native_param;
+};
+thread_local task_scheduler* t_task_scheduler = nullptr; // Set on worker threads only.
+thread_local unsigned int t_task_worker = 0;
+task_scheduler* g_task_scheduler_default = nullptr;
+bool g_task_scheduler_default_closed = false; // Set by task_scheduler_shutdown, after which engine side jobs no longer start the default scheduler back up.
+FastMutex g_task_scheduler_default_mutex;
+
+class task_group : public RefCountedObject {
+	task_scheduler* scheduler;
+	mutable FastMutex mtx;
+	unsigned int pending;
+	std::vector<scheduled_task> continuations;
+	std::string exception;
+public:
+	Event done;
+	task_group(task_scheduler* scheduler = nullptr);
+	~task_group();
+	void run(asIScriptFunction* func, CScriptDictionary* args = nullptr);
+	void run_range(asIScriptFunction* func, unsigned int start, unsigned int end);
+	void run_native(void (*job)(void*, unsigned int), void* param, unsigned int index);
+	void then(asIScriptFunction* func, CScriptDictionary* args = nullptr);
+	void task_started(unsigned int count = 1);
+	void task_finished(const std::string& error);
+	void wait();
+	bool try_wait(unsigned int ms);
+	unsigned int get_pending() const {
+		FastMutex::ScopedLock l(mtx);
+		return pending;
+	}
+	bool failed() const {
+		FastMutex::ScopedLock l(mtx);
+		return !exception.empty();
+	}
+	std::string get_exception() const {
+		FastMutex::ScopedLock l(mtx);
+		return exception;
+	}
+};
+
+class task_scheduler : public RefCountedObject {
+	struct worker : public Runnable {
+		task_scheduler* owner;
+		unsigned int index;
+		std::deque<scheduled_task> tasks;
+		SpinlockMutex lock;
+		Thread thread;
+		std::atomic<bool> orphaned; // Set if the scheduler was shut down from a task running on this very worker, which cannot join itself and so must clean up after itself instead.
+		worker(task_scheduler* owner, unsigned int index) : owner(owner), index(index), orphaned(false) {}
+		void run() {
+			t_task_scheduler = owner;
+			t_task_worker = index;
+			owner->worker_loop(this);
+			t_task_scheduler = nullptr;
+			asThreadCleanup();
+			if (orphaned) delete this;
+		}
+	};
+	std::vector<worker*> workers;
+	std::deque<scheduled_task> injected;
+	SpinlockMutex injected_lock;
+	Mutex sleep_mutex;
+	Condition sleep_condition;
+	std::atomic<int> queued, sleeping;
+	std::atomic<bool> stopping;
+	std::atomic<UInt64> executed, stolen;
+	bool pop_local(worker* w, scheduled_task& t) {
+		SpinlockMutex::ScopedLock l(w->lock);
+		if (w->tasks.empty()) return false;
+		t = w->tasks.back();
+		w->tasks.pop_back();
+		return true;
+	}
+	bool pop_injected(scheduled_task& t) {
+		SpinlockMutex::ScopedLock l(injected_lock);
+		if (injected.empty()) return false;
+		t = injected.front();
+		injected.pop_front();
+		return true;
+	}
+	bool steal(unsigned int thief, scheduled_task& t) {
+		unsigned int count = workers.size();
+		for (unsigned int i = 1; i <= count; i++) {
+			worker* victim = workers[(thief + i) % count];
+			if (!victim->lock.tryLock()) continue; // Somebody else is already busy with this deque, move on rather than contending.
+			bool found = !victim->tasks.empty();
+			if (found) {
+				t = victim->tasks.front();
+				victim->tasks.pop_front();
+			}
+			victim->lock.unlock();
+			if (found) {
+				stolen++;
+				return true;
+			}
+		}
+		return false;
+	}
+	bool find_task(scheduled_task& t) {
+		bool found = false;
+		if (t_task_scheduler == this && t_task_worker < workers.size()) found = pop_local(workers[t_task_worker], t) || pop_injected(t) || steal(t_task_worker, t);
+		else found = pop_injected(t) || steal(0, t);
+		if (found) queued--;
+		return found;
+	}
+	void worker_loop(worker* w) {
+		scheduled_task t;
+		while (!stopping) {
+			if (find_task(t)) {
+				execute(t);
+				if (w->orphaned) return; // The scheduler may no longer exist.
+				continue;
+			}
+			bool found = false;
+			for (int spin = 0; spin < 64 && !found && !stopping; spin++) {
+				Thread::yield();
+				found = queued > 0;
+			}
+			if (found) continue;
+			Mutex::ScopedLock l(sleep_mutex);
+			sleeping++; // Announce ourselves before the final check so that a concurrent submit either sees us sleeping or we see its task.
+			if (queued < 1 && !stopping) sleep_condition.tryWait(sleep_mutex, 50);
+			sleeping--;
+		}
+	}
+	void wake_one() {
+		if (sleeping < 1) return;
+		Mutex::ScopedLock l(sleep_mutex);
+		sleep_condition.signal();
+	}
+public:
+	task_scheduler(unsigned int worker_count = 0) : queued(0), sleeping(0), stopping(false), executed(0), stolen(0) {
+		if (!worker_count) worker_count = std::max<int>(1, Environment::processorCount() - 1); // The thread that waits on a group helps to execute tasks, so by default leave one core for it.
+		for (unsigned int i = 0; i < worker_count; i++) workers.push_back(new worker(this, i));
+		for (worker* w : workers) {
+			w->thread.setName(format("task_worker_%u", w->index));
+			w->thread.start(*w);
+		}
+	}
+	~task_scheduler() {
+		shutdown();
+	}
+	void shutdown() {
+		if (stopping.exchange(true)) return;
+		{
+			Mutex::ScopedLock l(sleep_mutex);
+			sleep_condition.broadcast();
+		}
+		worker* self = t_task_scheduler == this ? workers[t_task_worker] : nullptr;
+		for (worker* w : workers) {
+			if (w != self) w->thread.join();
+		}
+		// Any tasks that never got to run must still notify their groups so that nobody waits on them forever.
+		scheduled_task t;
+		while (pop_injected(t)) cancel(t);
+		std::vector<worker*> stopped;
+		stopped.swap(workers);
+		for (worker* w : stopped) {
+			std::deque<scheduled_task> remaining;
+			{
+				SpinlockMutex::ScopedLock l(w->lock);
+				remaining.swap(w->tasks);
+			}
+			for (scheduled_task& wt : remaining) cancel(wt);
+			if (w == self) w->orphaned = true;
+			else delete w;
+		}
+		queued = 0;
+	}
+	void submit(const scheduled_task& t) {
+		if (stopping) {
+			cancel(t);
+			return;
+		}
+		if (t_task_scheduler == this) {
+			worker* w = workers[t_task_worker];
+			SpinlockMutex::ScopedLock l(w->lock);
+			w->tasks.push_back(t);
+		} else {
+			SpinlockMutex::ScopedLock l(injected_lock);
+			injected.push_back(t);
+		}
+		queued++;
+		wake_one();
+	}
+	// Called by threads waiting on a group to make themselves useful, returns false if no work was available.
+	bool run_one() {
+		scheduled_task t;
+		if (!find_task(t)) return false;
+		execute(t);
+		return true;
+	}
+	void execute(scheduled_task& t) {
+		if (t.native) {
+			std::string error;
+			try {
+				t.native(t.native_param, t.range_start);
+			} catch (std::exception& e) {
+				error = e.what();
+			} catch (...) {
+				error = "unknown exception in native task";
+			}
+			executed++;
+			finish(t, error);
+			return;
+		}
+		asIScriptContext* ctx = g_ScriptEngine->RequestContext(); // Served from this thread's own context cache after the first task, see RequestContextCallback.
+		std::string error;
+		if (!ctx) error = "cannot acquire script context for task";
+		else if (ctx->Prepare(t.func) < 0) error = "cannot prepare script context for task";
+		else {
+			if (t.is_range) {
+				ctx->SetArgDWord(0, t.range_start);
+				ctx->SetArgDWord(1, t.range_end);
+			} else ctx->SetArgObject(0, t.args);
+			int result = ctx->Execute();
+			if (result == asEXECUTION_EXCEPTION) error = ctx->GetExceptionString();
+			else if (result == asEXECUTION_ABORTED) error = "task aborted";
+			else if (result == asEXECUTION_SUSPENDED) error = "task suspended";
+		}
+		if (ctx) g_ScriptEngine->ReturnContext(ctx);
+		executed++;
+		finish(t, error);
+	}
+	void cancel(const scheduled_task& t) {
+		finish(t, "task scheduler shut down before the task could run");
+	}
+	void finish(const scheduled_task& t, const std::string& error) {
+		if (t.func) t.func->Release();
+		if (t.args) t.args->Release();
+		task_group* group = t.group;
+		group->task_finished(error);
+		group->release();
+	}
+	unsigned int get_worker_count() const { return workers.size(); }
+	int get_queued() const { return queued; }
+	UInt64 get_executed() const { return executed; }
+	UInt64 get_stolen() const { return stolen; }
+	void parallel_for(unsigned int start, unsigned int end, unsigned int grain, asIScriptFunction* callback);
+};
+
+// Returns the default scheduler with a reference the caller must release, taken under the lock so that task_scheduler_shutdown can't drop the scheduler between the lookup and the duplicate.
+task_scheduler* get_task_scheduler_default() {
+	FastMutex::ScopedLock l(g_task_scheduler_default_mutex);
+	if (!g_task_scheduler_default) g_task_scheduler_default = new task_scheduler();
+	g_task_scheduler_default->duplicate();
+	return g_task_scheduler_default;
+}
+void task_scheduler_shutdown() {
+	FastMutex::ScopedLock l(g_task_scheduler_default_mutex);
+	g_task_scheduler_default_closed = true;
+	if (g_task_scheduler_default) {
+		g_task_scheduler_default->shutdown();
+		g_task_scheduler_default->release();
+		g_task_scheduler_default = nullptr;
+	}
+}
+
+task_group::task_group(task_scheduler* scheduler) : scheduler(scheduler ? scheduler : get_task_scheduler_default()), pending(0), done(Event::EVENT_MANUALRESET) {
+	// Either way we now own a reference, a scheduler passed from script comes with one and the default scheduler is returned with one.
+	done.set();
+}
+task_group::~task_group() {
+	for (scheduled_task& t : continuations) {
+		t.func->Release();
+		if (t.args) t.args->Release();
+	}
+	scheduler->release();
+}
+void task_group::task_started(unsigned int count) {
+	FastMutex::ScopedLock l(mtx);
+	if (pending == 0) done.reset();
+	pending += count;
+}
+void task_group::task_finished(const std::string& error) {
+	std::vector<scheduled_task> ready;
+	{
+		FastMutex::ScopedLock l(mtx);
+		if (!error.empty() && exception.empty()) exception = error;
+		if (pending == 1 && !continuations.empty()) {
+			// Continuations join the group before this task leaves it, so that a waiter never sees the group as complete in between.
+			ready.swap(continuations);
+			pending += ready.size();
+		}
+		if (--pending == 0) done.set();
+	}
+	for (scheduled_task& t : ready) scheduler->submit(t);
+}
+void task_group::run(asIScriptFunction* func, CScriptDictionary* args) {
+	if (!func) {
+		if (args) args->Release();
+		throw InvalidArgumentException("task_group::run requires a callback");
+	}
+	task_started();
+	duplicate();
+	scheduler->submit({func, args, 0, 0, false, this});
+}
+void task_group::run_range(asIScriptFunction* func, unsigned int start, unsigned int end) {
+	func->AddRef();
+	task_started();
+	duplicate();
+	scheduler->submit({func, nullptr, start, end, true, this});
+}
+void task_group::run_native(void (*job)(void*, unsigned int), void* param, unsigned int index) {
+	task_started();
+	duplicate();
+	scheduler->submit({nullptr, nullptr, index, index, false, this, job, param});
+}
+void task_group::then(asIScriptFunction* func, CScriptDictionary* args) {
+	if (!func) {
+		if (args) args->Release();
+		throw InvalidArgumentException("task_group::then requires a callback");
+	}
+	{
+		FastMutex::ScopedLock l(mtx);
+		if (pending > 0) {
+			duplicate();
+			continuations.push_back({func, args, 0, 0, false, this});
+			return;
+		}
+	}
+	run(func, args); // Nothing is outstanding, the continuation can start right away.
+}
+void task_group::wait() {
+	while (get_pending() > 0) {
+		if (!scheduler->run_one()) done.tryWait(1);
+	}
+}
+bool task_group::try_wait(unsigned int ms) {
+	Timestamp start;
+	while (get_pending() > 0) {
+		if (start.isElapsed(Timestamp::TimeDiff(ms) * 1000)) return false;
+		if (!scheduler->run_one()) done.tryWait(1);
+	}
+	return true;
+}
+
+void task_scheduler::parallel_for(unsigned int start, unsigned int end, unsigned int grain, asIScriptFunction* callback) {
+	if (!callback) throw InvalidArgumentException("parallel_for requires a callback");
+	if (end <= start) {
+		callback->Release();
+		return;
+	}
+	unsigned int count = end - start;
+	if (grain == 0) grain = std::max<unsigned int>(1, count / (std::max<unsigned int>(1, workers.size()) * 4)); // Several chunks per worker gives stealing something to balance with.
+	duplicate();
+	task_group* group = new task_group(this);
+	for (unsigned int i = start; i < end; i += std::min(grain, end - i)) group->run_range(callback, i, i + std::min(grain, end - i));
+	callback->Release();
+	group->wait();
+	std::string exception = group->get_exception();
+	group->release();
+	if (!exception.empty()) throw Exception(exception);
+}
+void script_parallel_for(unsigned int start, unsigned int end, unsigned int grain, asIScriptFunction* callback) {
+	task_scheduler* scheduler = get_task_scheduler_default(); // Holds a reference for the duration of the call.
+	try {
+		scheduler->parallel_for(start, end, grain, callback);
+	} catch (...) {
+		scheduler->release();
+		throw;
+	}
+	scheduler->release();
+}
+// Runs the chunks of large array sorts on the default scheduler rather than on threads spawned for every sort, see SetArrayParallelRun. The calling thread runs the first chunk and then helps with the rest while it waits.
+void task_scheduler_run_native(unsigned int count, void (*job)(void*, unsigned int), void* param) {
+	task_scheduler* scheduler = nullptr;
+	{
+		FastMutex::ScopedLock l(g_task_scheduler_default_mutex);
+		if (!g_task_scheduler_default_closed) {
+			if (!g_task_scheduler_default) g_task_scheduler_default = new task_scheduler();
+			scheduler = g_task_scheduler_default;
+			scheduler->duplicate();
+		}
+	}
+	if (!scheduler) {
+		for (unsigned int i = 0; i < count; i++) job(param, i);
+		return;
+	}
+	task_group* group = new task_group(scheduler); // Takes over our reference.
+	for (unsigned int i = 1; i < count; i++) group->run_native(job, param, i);
+	if (count > 0) job(param, 0);
+	group->wait();
+	group->release();
+}
+task_scheduler* task_scheduler_factory(unsigned int worker_count) { return new task_scheduler(worker_count); }
+task_group* task_group_factory(task_scheduler* scheduler) { return new task_group(scheduler); }
+
+void RegisterTaskScheduler(asIScriptEngine* engine) {
+	SetArrayParallelRun(task_scheduler_run_native);
+	engine->RegisterFuncdef(_O("void parallel_for_callback(uint start, uint end)"));
+	engine->RegisterObjectType("task_scheduler", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("task_scheduler", asBEHAVE_FACTORY, "task_scheduler@ s(uint worker_count = 0)", asFUNCTION(task_scheduler_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("task_scheduler", asBEHAVE_ADDREF, "void f()", asMETHODPR(task_scheduler, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("task_scheduler", asBEHAVE_RELEASE, "void f()", asMETHODPR(task_scheduler, release, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_scheduler", "uint get_worker_count() const property", asMETHOD(task_scheduler, get_worker_count), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_scheduler", "int get_queued() const property", asMETHOD(task_scheduler, get_queued), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_scheduler", "uint64 get_tasks_executed() const property", asMETHOD(task_scheduler, get_executed), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_scheduler", "uint64 get_tasks_stolen() const property", asMETHOD(task_scheduler, get_stolen), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_scheduler", "void parallel_for(uint start, uint end, uint grain, parallel_for_callback@ callback)", asMETHOD(task_scheduler, parallel_for), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_scheduler", "void shutdown()", asMETHOD(task_scheduler, shutdown), asCALL_THISCALL);
+	engine->RegisterGlobalFunction(_O("task_scheduler@ get_task_scheduler_default() property"), asFUNCTION(get_task_scheduler_default), asCALL_CDECL);
+	engine->RegisterGlobalFunction(_O("void parallel_for(uint start, uint end, uint grain, parallel_for_callback@ callback)"), asFUNCTION(script_parallel_for), asCALL_CDECL);
+	engine->RegisterObjectType("task_group", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("task_group", asBEHAVE_FACTORY, "task_group@ g(task_scheduler@ scheduler = null)", asFUNCTION(task_group_factory), asCALL_CDECL);
+	engine->RegisterObjectBehaviour("task_group", asBEHAVE_ADDREF, "void f()", asMETHODPR(task_group, duplicate, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectBehaviour("task_group", asBEHAVE_RELEASE, "void f()", asMETHODPR(task_group, release, () const, void), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_group", "void run(thread_callback@ routine, dictionary@ args = null)", asMETHOD(task_group, run), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_group", "void then(thread_callback@ routine, dictionary@ args = null)", asMETHOD(task_group, then), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_group", "void wait()", asMETHOD(task_group, wait), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_group", "bool try_wait(uint ms)", asMETHOD(task_group, try_wait), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_group", "uint get_pending() const property", asMETHOD(task_group, get_pending), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_group", "bool get_failed() const property", asMETHOD(task_group, failed), asCALL_THISCALL);
+	engine->RegisterObjectMethod("task_group", "string get_exception() const property", asMETHOD(task_group, get_exception), asCALL_THISCALL);
+}
+
 template <class T> void RegisterMutexType(asIScriptEngine* engine, const std::string& type) {
 	angelscript_refcounted_register<T>(engine, type.c_str());
 	if constexpr(std::is_same<T, NamedMutex>::value) engine->RegisterObjectBehaviour(type.c_str(), asBEHAVE_FACTORY, format("%s@ m(const string&in)", type).c_str(), asFUNCTION((angelscript_refcounted_factory<T, const std::string&>)), asCALL_CDECL);
@@ -511,5 +944,6 @@ void RegisterThreading(asIScriptEngine* engine) {
 	engine->RegisterObjectMethod("async<T>", "string get_exception() const property", asMETHOD(async_result, get_exception), asCALL_THISCALL);
 	engine->RegisterObjectMethod("async<T>", "void wait()", asMETHOD(Event, wait), asCALL_THISCALL, 0, asOFFSET(async_result, progress), false);
 	engine->RegisterObjectMethod("async<T>", "bool try_wait(uint ms)", asMETHOD(Event, tryWait), asCALL_THISCALL, 0, asOFFSET(async_result, progress), false);
+	RegisterTaskScheduler(engine);
 	RegisterAtomics(engine);
 }
@@ -14,4 +14,5 @@
 
 class asIScriptEngine;
 
+void task_scheduler_shutdown(); // Stops the default task scheduler's workers, must happen before the script module is discarded.
 void RegisterThreading(asIScriptEngine* engine);
@@ -156,19 +156,12 @@ sound* tone_synth::generate_sound() {
 init_sound();
 	int size = el_tonar_output_buffer_size(gen);
 	if (size <= 0) return nullptr;
-	char* buffer = new char[size];
-	if (!buffer) return nullptr;
-	if (!el_tonar_output_buffer(gen, buffer, size)) {
-		delete[] buffer;
-		return nullptr;
-	}
+	std::string buffer(size, '\0');
+	if (!el_tonar_output_buffer(gen, &buffer[0], size)) return nullptr;
 	sound *s = g_audio_engine->new_sound();
-	if (!s) {
-		delete[] buffer;
-		return nullptr;
-	}
-	bool loaded = s->load_pcm(buffer, static_cast<unsigned int>(size), ma_format_s16, gen->sample_rate, gen->channels);
-	delete[] buffer;
+	if (!s) return nullptr;
+	// The sound takes ownership of the rendered samples, no copy or wav conversion is needed.
+	bool loaded = s->load_pcm_moved(std::move(buffer), ma_format_s16, gen->sample_rate, gen->channels);
 	if (!loaded) {
 		s->release(); // Sound object is not passed to the script if load fails, delete it.
 		return nullptr;
@@ -14,7 +14,9 @@
 
 #include <limits>
 #include <algorithm>
+#include <chrono>
 #include <unordered_map>
+#include <unordered_set>
 #include <thread>
 #include <miniaudio.h>
 #include <Poco/FileStream.h>
@@ -29,6 +31,8 @@
 #include "xplatform.h"
 using namespace std;
 
+static const unsigned int tts_stream_buffer_seconds = 10; // Capacity of the ring buffer used when streaming, speak() only waits on playback if synthesis gets this far ahead of it.
+
 // Trim prenormalized TTS based on minimum thresholds in dB. Size is in frames.
 template <class t> static t *tts_trim_internal(t *data, unsigned int* size_in_frames, int channels, float begin_db, float end_db) {
 	t min_begin_sample = ceil(ma_volume_db_to_linear(begin_db) * (double)numeric_limits<t>::max());
@@ -137,7 +141,10 @@ static void register_builtin_engines() {
 }
 
 // tts_voice implementation
-tts_voice::tts_voice(const string &engine_list) : RefCount(1), current_voice_index(-1) {
+// Voices with phrases waiting to be prewarmed, see tts_process_prewarm. Each entry holds a reference to its voice, which is only ever dropped on the voice's own thread.
+static mutex prewarm_voices_mtx;
+static unordered_set<tts_voice*> prewarm_voices;
+tts_voice::tts_voice(const string &engine_list) : RefCount(1), current_voice_index(-1), clear_generation(0), streaming(false), cache_size(0), cache_limit(0), owner_thread(this_thread::get_id()), prewarm_ns_per_char(0), prewarm_last(chrono::steady_clock::now()) {
 	if (engine_registry.empty()) register_builtin_engines();
 	speaking.clear();
 	vector<string> engine_names;
@@ -152,6 +159,10 @@ tts_voice::tts_voice(const string &engine_list) : RefCount(1), current_voice_ind
 	}
 	refresh();
 }
+tts_voice::~tts_voice() {
+	lock_guard<mutex> lock(prewarm_voices_mtx);
+	prewarm_voices.erase(this);
+}
 void tts_voice::AddRef() { asAtomicInc(RefCount); }
 void tts_voice::Release() { if (asAtomicDec(RefCount) < 1) delete this; }
 voice_info *tts_voice::get_voice_info(int voice_index) {
@@ -169,6 +180,17 @@ bool tts_voice::speak(const string &text, bool interrupt) {
 	voice_info *voice = get_voice_info(current_voice_index);
 	if (!voice) return false;
 	if (voice->engine->get_pcm_generation_state() == PCM_PREFERRED) {
+		bool stream = streaming && voice->engine->get_pcm_streaming_supported();
+		if (cache_limit) {
+			// A streamed utterance is never cached, but one that is already cached still plays straight from memory.
+			phraseptr phrase = get_phrase(text, !stream);
+			if (phrase) {
+				soundptr s(new_global_sound());
+				if (!s->load_pcm_external(phrase->pcm.data(), phrase->pcm.size(), phrase->format, phrase->sample_rate, phrase->channels, [phrase]() {})) return false;
+				return schedule(s, interrupt);
+			} else if (!stream) return false;
+		}
+		if (stream) return speak_stream(voice, text, interrupt);
 		tts_audio_data* datablock = nullptr;
 		void *trimmed_data = speak_to_pcm(text, &datablock);
 		if (!trimmed_data || !datablock) return false;
@@ -182,6 +204,69 @@ bool tts_voice::speak(const string &text, bool interrupt) {
 		return schedule(s, interrupt);
 	} else return voice->engine->speak(text, interrupt, false);
 }
+// Plays audio from engines that synthesize incrementally through a ring buffer backed sound, so that playback can start as soon as the first audible chunk arrives instead of after the entire utterance has been rendered. Leading and trailing silence are trimmed on the fly with the same thresholds tts_trim uses: silence is held back until more speech follows it, so whatever remains held when synthesis finishes is simply dropped.
+bool tts_voice::speak_stream(voice_info *voice, const string &text, bool interrupt) {
+	const float threshold = ma_volume_db_to_linear(-60);
+	audio_ring_buffer* rb = nullptr;
+	soundptr s;
+	unsigned int channels = 0, generation = 0;
+	vector<float> frames, held;
+	auto push = [&](const float* data, size_t frame_count) -> bool {
+		while (frame_count) {
+			if (clear_generation.load() != generation) return false; // Discarded by stop() or an interrupting speak call.
+			unsigned int written = rb->write(data, (unsigned int)min<size_t>(frame_count, numeric_limits<unsigned int>::max()));
+			data += size_t(written) * channels;
+			frame_count -= written;
+			if (frame_count) this_thread::sleep_for(chrono::milliseconds(5)); // Synthesis is running far ahead of playback.
+		}
+		return true;
+	};
+	voice->engine->speak_to_pcm_stream(text, [&](const void* data, unsigned int size_in_bytes, unsigned int sample_rate, unsigned int chans, unsigned int bitsize) -> bool {
+		if (!data || !chans || (bitsize != 8 && bitsize != 16) || (channels && chans != channels)) return false;
+		size_t frame_count = size_in_bytes / (bitsize / 8) / chans;
+		if (!frame_count) return true;
+		frames.resize(frame_count * chans);
+		ma_convert_pcm_frames_format(frames.data(), ma_format_f32, data, bitsize == 16? ma_format_s16 : ma_format_u8, frame_count, chans, ma_dither_mode_none);
+		size_t first = 0, last_audible = frame_count;
+		for (size_t i = 0; i < frame_count; i++) {
+			float mean = 0;
+			for (unsigned int c = 0; c < chans; c++) mean += fabs(frames[i * chans + c]);
+			if (mean / chans < threshold) continue;
+			if (last_audible == frame_count && !rb) first = i;
+			last_audible = i;
+		}
+		if (!rb) {
+			if (last_audible == frame_count) return true; // Still in leading silence.
+			channels = chans;
+			try { rb = audio_ring_buffer::create(chans, sample_rate * tts_stream_buffer_seconds, g_audio_engine, sample_rate); }
+			catch (exception&) { return false; }
+			s = soundptr(new_global_sound());
+			if (!s->open(rb)) {
+				rb->release();
+				rb = nullptr;
+				return false;
+			}
+			if (!schedule(s, interrupt)) {
+				s.reset();
+				rb = nullptr;
+				return false;
+			}
+			generation = clear_generation.load();
+		}
+		if (last_audible == frame_count) {
+			held.insert(held.end(), frames.begin() + first * chans, frames.end());
+			return true;
+		}
+		if (!held.empty() && !push(held.data(), held.size() / chans)) return false;
+		held.clear();
+		if (!push(frames.data() + first * chans, last_audible + 1 - first)) return false;
+		held.assign(frames.begin() + (last_audible + 1) * chans, frames.end());
+		return true;
+	});
+	if (!rb) return false;
+	rb->set_end_of_stream(true);
+	return true;
+}
 bool tts_voice::speak_to_file(const string &filename, const string &text) {
 	tts_audio_data* datablock;
 	void *trimmed_data = speak_to_pcm(text, &datablock);
@@ -205,6 +290,14 @@ bool tts_voice::speak_to_file(const string &filename, const string &text) {
 	}
 }
 string tts_voice::speak_to_memory(const string &text) {
+	if (cache_limit) {
+		phraseptr phrase = get_phrase(text);
+		if (!phrase) return "";
+		string output;
+		output.resize(phrase->pcm.size() + 44);
+		if (!sound::pcm_to_wav(phrase->pcm.data(), phrase->pcm.size(), phrase->format, phrase->sample_rate, phrase->channels, &output[0])) return "";
+		return output;
+	}
 	tts_audio_data* datablock;
 	void *trimmed_data = speak_to_pcm(text, &datablock);
 	if (!trimmed_data || !datablock) return "";
@@ -228,6 +321,16 @@ bool tts_voice::speak_wait(const string &text, bool interrupt) {
 	} else return voice->engine->speak(text, interrupt, true);
 }
 sound *tts_voice::speak_to_sound(const string &text) {
+	if (cache_limit) {
+		phraseptr phrase = get_phrase(text);
+		if (!phrase) return nullptr;
+		sound *s = new_global_sound();
+		if (!s->load_pcm_external(phrase->pcm.data(), phrase->pcm.size(), phrase->format, phrase->sample_rate, phrase->channels, [phrase]() {})) {
+			s->release();
+			return nullptr;
+		}
+		return s;
+	}
 	tts_audio_data* datablock;
 	void *trimmed_data = speak_to_pcm(text, &datablock);
 	if (!trimmed_data || !datablock) return nullptr;
@@ -399,6 +502,7 @@ bool tts_voice::schedule(soundptr &s, bool interrupt) {
 	} catch (exception &) { return false; }
 }
 void tts_voice::clear() {
+	clear_generation++;
 	if (!queue.empty() && queue.front()->get_playing()) fade(queue.front());
 	while (!queue.empty()) queue.pop();
 	speaking.clear();
@@ -437,6 +541,155 @@ ma_result tts_voice::job_proc(ma_job *pJob) {
 	return MA_SUCCESS;
 }
 
+tts_voice::phraseptr tts_voice::get_phrase(const string &text, bool synthesize) {
+	voice_info *voice = get_voice_info(current_voice_index);
+	if (!voice || text.empty() || voice->engine->get_pcm_generation_state() == PCM_UNSUPPORTED) return nullptr;
+	tts_engine* engine = voice->engine;
+	string key = Poco::format("%s\x1f%d\x1f%f\x1f%f\x1f%f\x1f", engine->get_engine_name(), voice->engine_voice_index, double(engine->get_rate()), double(engine->get_pitch()), double(engine->get_volume())) + text;
+	phraseptr phrase = cache_lookup(key);
+	if (phrase || !synthesize) return phrase;
+	tts_audio_data* datablock = engine->speak_to_pcm(text);
+	if (!datablock) return nullptr;
+	void* trimmed_data = tts_trim(datablock);
+	if (!trimmed_data) {
+		datablock->free();
+		return nullptr;
+	}
+	shared_ptr<tts_cached_phrase> result = make_shared<tts_cached_phrase>();
+	result->pcm.assign((const char*)trimmed_data, datablock->size_in_bytes);
+	result->format = datablock->bitsize == 16? ma_format_s16 : ma_format_u8;
+	result->sample_rate = datablock->sample_rate;
+	result->channels = datablock->channels;
+	datablock->free();
+	cache_insert(key, result);
+	return result;
+}
+tts_voice::phraseptr tts_voice::cache_lookup(const string &key) {
+	unique_lock<mutex> lock(cache_mtx);
+	auto it = cache_index.find(key);
+	if (it == cache_index.end()) return nullptr;
+	cache.splice(cache.begin(), cache, it->second);
+	return it->second->second;
+}
+void tts_voice::cache_insert(const string &key, const phraseptr &phrase) {
+	unique_lock<mutex> lock(cache_mtx);
+	if (phrase->pcm.size() > cache_limit) return;
+	auto it = cache_index.find(key);
+	if (it != cache_index.end()) {
+		cache_size -= it->second->second->pcm.size();
+		cache.erase(it->second);
+		cache_index.erase(it);
+	}
+	cache.emplace_front(key, phrase);
+	cache_index[key] = cache.begin();
+	cache_size += phrase->pcm.size();
+	cache_trim();
+}
+void tts_voice::cache_trim() {
+	// cache_mtx must be held. Sounds still playing an evicted phrase keep their own reference to it.
+	while (cache_size > cache_limit && !cache.empty()) {
+		cache_size -= cache.back().second->pcm.size();
+		cache_index.erase(cache.back().first);
+		cache.pop_back();
+	}
+}
+void tts_voice::set_cache_limit(unsigned long long bytes) {
+	unique_lock<mutex> lock(cache_mtx);
+	cache_limit = bytes;
+	cache_trim();
+	if (!cache_limit) prewarm_queue.clear();
+}
+unsigned long long tts_voice::get_cache_size() {
+	unique_lock<mutex> lock(cache_mtx);
+	return cache_size;
+}
+unsigned int tts_voice::get_cache_count() {
+	unique_lock<mutex> lock(cache_mtx);
+	return cache.size();
+}
+void tts_voice::clear_cache() {
+	unique_lock<mutex> lock(cache_mtx);
+	cache.clear();
+	cache_index.clear();
+	cache_size = 0;
+}
+bool tts_voice::prewarm(CScriptArray *phrases) {
+	if (!phrases || !cache_limit) return false;
+	{
+		unique_lock<mutex> lock(cache_mtx);
+		for (asUINT i = 0; i < phrases->GetSize(); i++) prewarm_queue.push_back(*(string*)phrases->At(i));
+	}
+	lock_guard<mutex> lock(prewarm_voices_mtx);
+	if (prewarm_voices.insert(this).second) AddRef();
+	return true;
+}
+unsigned int tts_voice::get_prewarm_pending() {
+	unique_lock<mutex> lock(cache_mtx);
+	return prewarm_queue.size();
+}
+void tts_voice::prewarm_phrase(const string &text) {
+	if (get_phrase(text, false)) return; // Already cached, which says nothing about how long synthesis takes.
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	get_phrase(text);
+	prewarm_last = chrono::steady_clock::now();
+	double sample = double(chrono::duration_cast<chrono::nanoseconds>(prewarm_last - start).count()) / max<size_t>(text.size(), 1);
+	prewarm_ns_per_char = prewarm_ns_per_char > 0? prewarm_ns_per_char * 0.75 + sample * 0.25 : sample;
+}
+unsigned int tts_voice::process_prewarm(unsigned int milliseconds) {
+	// Speech engines are generally tied to the thread that created them (SAPI's COM apartment, the JNIEnv cached by the Android engine), so queued phrases are only ever synthesized here.
+	if (this_thread::get_id() != owner_thread) return get_prewarm_pending();
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(milliseconds);
+	do {
+		string text;
+		{
+			unique_lock<mutex> lock(cache_mtx);
+			if (prewarm_queue.empty()) break;
+			text = std::move(prewarm_queue.front());
+			prewarm_queue.pop_front();
+		}
+		prewarm_phrase(text);
+	} while (chrono::steady_clock::now() < deadline);
+	return get_prewarm_pending();
+}
+void tts_voice::prewarm_idle(chrono::steady_clock::time_point deadline) {
+	// Only starts on a phrase when its estimated synthesis time fits before the deadline, so that a short wait() on a frame path isn't stretched. If nothing has fit for a while a phrase is synthesized anyway, otherwise a script that only ever waits a few milliseconds would never see its phrases prewarmed.
+	while (true) {
+		string text;
+		{
+			unique_lock<mutex> lock(cache_mtx);
+			if (prewarm_queue.empty()) return;
+			chrono::steady_clock::time_point now = chrono::steady_clock::now();
+			chrono::nanoseconds estimate(static_cast<long long>(prewarm_ns_per_char * prewarm_queue.front().size()));
+			if (now + estimate > deadline && now - prewarm_last < chrono::milliseconds(250)) return;
+			text = std::move(prewarm_queue.front());
+			prewarm_queue.pop_front();
+		}
+		prewarm_phrase(text);
+	}
+}
+void tts_process_prewarm(unsigned int milliseconds) {
+	// Prewarms phrases for a voice owned by the calling thread in the given amount of idle time, wait() calls this. Entries for voices of this thread are also dropped here once their queue is empty or the queue holds the last reference, so that a voice is only ever destroyed on its own thread.
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(milliseconds);
+	tts_voice* voice = nullptr;
+	vector<tts_voice*> finished;
+	{
+		lock_guard<mutex> lock(prewarm_voices_mtx);
+		for (auto it = prewarm_voices.begin(); it != prewarm_voices.end();) {
+			tts_voice* v = *it;
+			if (!v->is_owner_thread()) ++it;
+			else if (v->RefCount > 1 && v->get_prewarm_pending()) {
+				if (!voice) voice = v; // Stays referenced by its entry, which only this thread can remove.
+				++it;
+			} else {
+				finished.push_back(v);
+				it = prewarm_voices.erase(it);
+			}
+		}
+	}
+	if (voice) voice->prewarm_idle(deadline);
+	for (tts_voice* v : finished) v->Release(); // Outside the lock, as the destructor takes it.
+}
+
 CScriptArray *tts_get_engines() {
 	asIScriptContext *ctx = asGetActiveContext();
 	asIScriptEngine *engine = ctx->GetEngine();
@@ -478,6 +731,16 @@ void RegisterTTSVoice(asIScriptEngine *engine) {
 	engine->RegisterObjectMethod("tts_voice", "string get_voice_name(int index) const", asMETHOD(tts_voice, get_voice_name), asCALL_THISCALL);
 	engine->RegisterObjectMethod("tts_voice", "string get_voice_language(int index) const", asMETHOD(tts_voice, get_voice_language), asCALL_THISCALL);
 	engine->RegisterObjectMethod("tts_voice", "bool set_language(const string& in language)", asMETHOD(tts_voice, set_language), asCALL_THISCALL);
+	engine->RegisterObjectMethod("tts_voice", "bool get_streaming() const property", asMETHOD(tts_voice, get_streaming), asCALL_THISCALL);
+	engine->RegisterObjectMethod("tts_voice", "void set_streaming(bool enabled) property", asMETHOD(tts_voice, set_streaming), asCALL_THISCALL);
+	engine->RegisterObjectMethod("tts_voice", "uint64 get_cache_limit() const property", asMETHOD(tts_voice, get_cache_limit), asCALL_THISCALL);
+	engine->RegisterObjectMethod("tts_voice", "void set_cache_limit(uint64 bytes) property", asMETHOD(tts_voice, set_cache_limit), asCALL_THISCALL);
+	engine->RegisterObjectMethod("tts_voice", "uint64 get_cache_size() const property", asMETHOD(tts_voice, get_cache_size), asCALL_THISCALL);
+	engine->RegisterObjectMethod("tts_voice", "uint get_cache_count() const property", asMETHOD(tts_voice, get_cache_count), asCALL_THISCALL);
+	engine->RegisterObjectMethod("tts_voice", "void clear_cache()", asMETHOD(tts_voice, clear_cache), asCALL_THISCALL);
+	engine->RegisterObjectMethod("tts_voice", "bool prewarm(const array<string>@+ phrases)", asMETHOD(tts_voice, prewarm), asCALL_THISCALL);
+	engine->RegisterObjectMethod("tts_voice", "uint get_prewarm_pending() const property", asMETHOD(tts_voice, get_prewarm_pending), asCALL_THISCALL);
+	engine->RegisterObjectMethod("tts_voice", "uint process_prewarm(uint milliseconds = 0)", asMETHOD(tts_voice, process_prewarm), asCALL_THISCALL);
 	engine->RegisterObjectMethod("tts_voice", "string get_language() const property", asMETHOD(tts_voice, get_language), asCALL_THISCALL);
 	engine->RegisterObjectMethod("tts_voice", "bool get_speaking() const property", asMETHOD(tts_voice, get_speaking), asCALL_THISCALL);
 	engine->RegisterObjectMethod("tts_voice", "int get_voice() const property", asMETHOD(tts_voice, get_current_voice), asCALL_THISCALL);
@@ -17,6 +17,11 @@
 #include <memory>
 #include <functional>
 #include <queue>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <chrono>
+#include <thread>
 #include <mutex>
 #include <atomic>
 #include <sstream>
@@ -41,6 +46,8 @@ struct tts_audio_data {
 	tts_audio_data(tts_engine* eng, void* dat, unsigned int size, unsigned int rate, unsigned int chans, unsigned int bits, void* ctx = nullptr);
 	void free();
 };
+// Receives successive chunks of audio from engines that can synthesize incrementally, the format must not change between chunks of one utterance. Returning false asks the engine to abandon synthesis.
+typedef std::function<bool(const void* data, unsigned int size_in_bytes, unsigned int sample_rate, unsigned int channels, unsigned int bitsize)> tts_pcm_stream_callback;
 
 class tts_engine {
 public:
@@ -50,6 +57,8 @@ public:
 	virtual bool speak(const std::string &text, bool interrupt = false, bool blocking = false) = 0;
 	virtual tts_audio_data* speak_to_pcm(const std::string &text) = 0;
 	virtual void free_pcm(tts_audio_data* data) = 0;
+	virtual bool get_pcm_streaming_supported() = 0;
+	virtual bool speak_to_pcm_stream(const std::string &text, const tts_pcm_stream_callback& callback) = 0;
 	virtual bool is_speaking() = 0;
 	virtual bool stop() = 0;
 	virtual float get_rate() = 0;
@@ -80,6 +89,8 @@ public:
 	virtual bool speak(const std::string &text, bool interrupt = false, bool blocking = false) override { return false; }
 	virtual tts_audio_data* speak_to_pcm(const std::string &text) override { return nullptr; }
 	virtual void free_pcm(tts_audio_data* data) override { if (data->data) free(data->data); delete data; }
+	virtual bool get_pcm_streaming_supported() override { return false; }
+	virtual bool speak_to_pcm_stream(const std::string &text, const tts_pcm_stream_callback& callback) override { return false; }
 	virtual bool is_speaking() override { return false; }
 	virtual bool stop() override { return true; }
 	virtual float get_rate() override { return 0; }
@@ -105,6 +116,14 @@ bool tts_engine_register(const std::string &name, tts_engine_factory factory);
 std::vector<std::string> tts_get_engine_names();
 std::shared_ptr<tts_engine> tts_create_engine(const std::string &name);
 
+// Trimmed speech retained by a tts_voice's phrase cache.
+struct tts_cached_phrase {
+	std::string pcm;
+	ma_format format;
+	unsigned int sample_rate;
+	unsigned int channels;
+};
+
 struct voice_info {
 	tts_engine *engine;
 	int engine_voice_index;
@@ -124,8 +143,29 @@ class tts_voice {
 	std::mutex queue_mtx;
 	sound_queue fade_queue;
 	std::atomic_flag speaking;
+	std::atomic<unsigned int> clear_generation; // Bumped whenever the queue is cleared so that an utterance still being streamed can tell it was discarded.
+	bool streaming;
+	// Optional LRU cache of synthesized phrases keyed by engine, voice, rate, pitch, volume and text, disabled while cache_limit is 0.
+	typedef std::shared_ptr<const tts_cached_phrase> phraseptr;
+	typedef std::list<std::pair<std::string, phraseptr>> phrase_list;
+	phrase_list cache;
+	std::unordered_map<std::string, phrase_list::iterator> cache_index;
+	unsigned long long cache_size, cache_limit;
+	std::mutex cache_mtx;
+	std::deque<std::string> prewarm_queue;
+	std::thread::id owner_thread; // Prewarming only ever synthesizes on the thread that created the voice.
+	double prewarm_ns_per_char; // Running estimate of synthesis cost, used to fit prewarming into the idle time of wait(). Only touched on the owner thread.
+	std::chrono::steady_clock::time_point prewarm_last;
 	voice_info *get_voice_info(int voice_index);
 	void *speak_to_pcm(const std::string &text, tts_audio_data** datablock); // Returns pointer to trimmed sample.
+	bool speak_stream(voice_info *voice, const std::string &text, bool interrupt);
+	phraseptr get_phrase(const std::string &text, bool synthesize = true);
+	phraseptr cache_lookup(const std::string &key);
+	void cache_insert(const std::string &key, const phraseptr &phrase);
+	void cache_trim();
+	void prewarm_phrase(const std::string &text);
+	void prewarm_idle(std::chrono::steady_clock::time_point deadline);
+	friend void tts_process_prewarm(unsigned int milliseconds);
 	bool schedule(soundptr &s, bool interrupt);
 	void clear();
 	bool fade(soundptr &item);
@@ -134,6 +174,7 @@ class tts_voice {
 	static ma_result job_proc(ma_job *pJob);
 public:
 	tts_voice(const std::string &engine_list = "");
+	~tts_voice();
 	void AddRef();
 	void Release();
 	bool speak(const std::string &text, bool interrupt = false);
@@ -156,6 +197,17 @@ public:
 	bool set_voice(int voice);
 	int get_current_voice();
 	bool get_speaking();
+	void set_streaming(bool enabled) { streaming = enabled; }
+	bool get_streaming() { return streaming; }
+	void set_cache_limit(unsigned long long bytes);
+	unsigned long long get_cache_limit() { return cache_limit; }
+	unsigned long long get_cache_size();
+	unsigned int get_cache_count();
+	void clear_cache();
+	bool prewarm(CScriptArray *phrases);
+	unsigned int get_prewarm_pending();
+	unsigned int process_prewarm(unsigned int milliseconds = 0);
+	bool is_owner_thread() const { return std::this_thread::get_id() == owner_thread; }
 	bool refresh();
 	bool stop();
 	std::string get_engine_name();
@@ -178,4 +230,5 @@ bool screen_reader_speak(const std::string& text, bool interrupt);
 bool screen_reader_braille(const std::string& text);
 bool screen_reader_silence();
 
+void tts_process_prewarm(unsigned int milliseconds);
 void RegisterTTSVoice(asIScriptEngine *engine);